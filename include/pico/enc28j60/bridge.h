@@ -0,0 +1,78 @@
+#ifndef ENC28J60_BRIDGE_H
+#define ENC28J60_BRIDGE_H
+
+#include <stdint.h>
+
+#define ENC28J60_BRIDGE_TABLE_SIZE 64  /* MAC learning table entries, power of two */
+#define ENC28J60_BRIDGE_PROBES 4  /* Entries searched per address */
+#define ENC28J60_BRIDGE_BOUNCE_SIZE 64  /* Bytes copied per SPI transaction when forwarding */
+#define ENC28J60_BRIDGE_AGEING_MS 300000  /* Default ageing time, as recommended by IEEE 802.1D */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Learned address. Managed by the library. */
+struct enc28j60_bridge_entry {
+	uint8_t mac_address[6];
+	uint8_t port;  /* Port the address was last seen on, 0xFF if the entry is free */
+	uint32_t seen;  /* Time the address was last seen, in milliseconds since boot */
+};
+
+/*
+ * Layer 2 bridge between two ENC28J60 ports.
+ * Frames are forwarded chip-to-chip through a small bounce buffer, straight from the receive buffer of one port to
+ * the transmit buffer of the other, without passing through lwIP.
+ * Both ports MUST be initialized with enc28j60_init, which leaves the receive filters disabled, so the ports see
+ * every frame on their segments.
+ */
+struct enc28j60_bridge {
+
+	/* The two bridged ports. */
+	struct enc28j60 *ports[2];
+
+	/*
+	 * Time after which a learned address is forgotten, in milliseconds.
+	 * Set to 0 to use ENC28J60_BRIDGE_AGEING_MS.
+	 */
+	uint32_t ageing_ms;
+
+	/* Hashed MAC learning table. Managed by the library, cleared by enc28j60_bridge_init. */
+	struct enc28j60_bridge_entry table[ENC28J60_BRIDGE_TABLE_SIZE];
+
+	/*
+	 * Counters: frames forwarded to a learned port, flooded, filtered (destination on the receiving port) and sent to
+	 * a reserved group address, which are delivered locally only.
+	 */
+	uint32_t forwarded;
+	uint32_t flooded;
+	uint32_t filtered;
+	uint32_t reserved;
+
+};
+
+/* Forget all learned addresses. */
+void enc28j60_bridge_init(struct enc28j60_bridge *bridge);
+
+/*
+ * Bridge the next frame received on a port.
+ * Call instead of enc28j60_receive_init when the port signals a received packet. The source address is learned
+ * and the frame is forwarded to the other port unless its destination was learned on the receiving port.
+ * Frames to the IEEE 802.1D reserved group addresses 01-80-C2-00-00-00 to 0F, such as PAUSE, STP BPDUs and LACP,
+ * are never forwarded.
+ * Frames addressed to one of the ports, broadcast and multicast frames are also delivered locally: they are left
+ * pending with the read position at their start, so they can be read with enc28j60_receive_read (for example by
+ * low_level_input) and MUST then be acknowledged with enc28j60_receive_ack.
+ * Calls for the two ports MUST NOT run concurrently.
+ * \param port index of the receiving port in ports
+ * \return length of the frame if it has to be delivered locally, 0 if it was consumed and acknowledged
+ */
+uint16_t enc28j60_bridge_input(struct enc28j60_bridge *bridge, uint8_t port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
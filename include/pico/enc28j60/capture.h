@@ -0,0 +1,118 @@
+#ifndef ENC28J60_CAPTURE_H
+#define ENC28J60_CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENC28J60_CAPTURE_MATCHES 8  /* Maximum number of byte tests of a filter */
+
+/* Direction flags of captured frames, as in the pcapng epb_flags option */
+#define ENC28J60_CAPTURE_INBOUND 0x01
+#define ENC28J60_CAPTURE_OUTBOUND 0x02
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Filter test: the frame byte at offset, masked with mask, equals value. */
+struct enc28j60_capture_match {
+	uint16_t offset;
+	uint8_t mask;
+	uint8_t value;
+};
+
+/*
+ * Frame capture in pcapng format.
+ * Captured frames are encoded as Enhanced Packet Blocks into a ring buffer in MCU RAM, behind a Section Header and an
+ * Interface Description Block, so the bytes taken from the ring with enc28j60_capture_read form a pcapng stream
+ * that can be written to USB CDC, a UDP socket or a file as it is. The ring has a single producer (the receive and
+ * transmit paths) and a single consumer, which may run on different cores. A frame that does not fit into the ring,
+ * or that arrives while another frame is being captured, is dropped and counted, so the producer never blocks.
+ * Does not depend on the Pico SDK.
+ *
+ * Set as the capture of an instance, it records the frames passing through ethernetif, the VLAN interfaces and the
+ * bridge. VLAN frames are recorded as on the wire, tag included, with the filter seeing the first 16 bytes only.
+ * Bridged frames are recorded with the filter seeing the first 14 bytes only. Frames answered by
+ * enc28j60_offload_input and their replies are not recorded: the replies are built from the receive buffer on the
+ * chip and never pass through MCU RAM. Neither are frames dropped before they are read, such as runts or VLAN frames
+ * with an unknown VID.
+ */
+struct enc28j60_capture {
+
+	/* Ring storage. size MUST be a power of two, large enough for 60 bytes of headers plus the largest block. */
+	uint8_t *buffer;
+	size_t size;
+
+	/* Bytes of every frame kept, 0 for whole frames. */
+	uint16_t snaplen;
+
+	/*
+	 * Filter: a frame is captured when it passes all tests, or fails any of them if exclude is set.
+	 * No tests capture every frame.
+	 */
+	struct enc28j60_capture_match filter[ENC28J60_CAPTURE_MATCHES];
+	uint8_t filter_count;
+	bool exclude;
+
+	/* Counters: frames captured, rejected by the filter and dropped because the ring was full or busy. */
+	uint32_t captured;
+	uint32_t filtered;
+	uint32_t dropped;
+
+	/* Ring positions, counting bytes since enc28j60_capture_init and wrapping with size_t. Managed by the library. */
+	size_t head;
+	size_t tail;
+
+	/* Block being written. Managed by the library. */
+	size_t write;
+	uint32_t remaining;
+	uint32_t padding;
+	uint32_t flags;
+	bool producing;
+
+};
+
+/*
+ * Reset the ring and put the pcapng section and interface headers in front of the stream.
+ * Set buffer, size, snaplen and the filter first.
+ */
+void enc28j60_capture_init(struct enc28j60_capture *capture);
+
+/*
+ * Start capturing a frame.
+ * The filter is applied to the first head_len bytes of the frame, tests beyond them fail.
+ * \param head first bytes of the frame
+ * \param len length of the whole frame
+ * \param timestamp_us capture time in microseconds
+ * \param flags ENC28J60_CAPTURE_INBOUND or ENC28J60_CAPTURE_OUTBOUND
+ * \return true if the frame is captured: pass its bytes to enc28j60_capture_append, then call
+ * enc28j60_capture_commit; false if it was filtered or dropped
+ */
+bool enc28j60_capture_begin(struct enc28j60_capture *capture, const uint8_t *head, size_t head_len, size_t len,
+		uint64_t timestamp_us, uint32_t flags);
+
+/* Append bytes of the frame started with enc28j60_capture_begin. Bytes beyond the snap length are ignored. */
+void enc28j60_capture_append(struct enc28j60_capture *capture, const uint8_t *data, size_t len);
+
+/* Finish the frame and make it visible to enc28j60_capture_read. */
+void enc28j60_capture_commit(struct enc28j60_capture *capture);
+
+/*
+ * Capture a frame held in one buffer.
+ * \return true if the frame was captured
+ */
+bool enc28j60_capture_frame(struct enc28j60_capture *capture, const uint8_t *data, size_t len, uint64_t timestamp_us,
+		uint32_t flags);
+
+/*
+ * Take bytes of the pcapng stream from the ring.
+ * \return number of bytes copied to data, at most len
+ */
+size_t enc28j60_capture_read(struct enc28j60_capture *capture, uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
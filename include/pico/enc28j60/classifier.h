@@ -0,0 +1,101 @@
+#ifndef ENC28J60_CLASSIFIER_H
+#define ENC28J60_CLASSIFIER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENC28J60_CLASSIFIER_RULES 32  /* Maximum number of rules */
+#define ENC28J60_CLASSIFIER_KEYS 8  /* Maximum number of distinct EtherTypes and IP protocols each */
+#define ENC28J60_CLASSIFIER_PEEK 42  /* Bytes read from the start of every frame */
+
+#define ENC28J60_CLASS_DROP 0xFF  /* Class of frames acknowledged without reading their payload */
+
+/* Rule match flags */
+#define ENC28J60_MATCH_UNICAST 0x01  /* Destination is the MAC address of the instance */
+#define ENC28J60_MATCH_OTHER 0x02  /* Destination is another unicast address */
+#define ENC28J60_MATCH_BROADCAST 0x04  /* Destination is the broadcast address */
+#define ENC28J60_MATCH_MULTICAST 0x08  /* Destination is a multicast address */
+#define ENC28J60_MATCH_ETHERTYPE 0x10  /* EtherType equals ethertype */
+#define ENC28J60_MATCH_IP_PROTOCOL 0x20  /* IPv4 protocol equals ip_protocol */
+#define ENC28J60_MATCH_PORT 0x40  /* TCP or UDP destination port is in [port_min, port_max] */
+#define ENC28J60_MATCH_LOCAL_IP 0x80  /* IPv4 destination or ARP target address is the local address */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Classifier rule.
+ * A frame matches when every condition selected by match holds. If none of the destination flags
+ * (ENC28J60_MATCH_{UNICAST,OTHER,BROADCAST,MULTICAST}) is set, any destination matches.
+ */
+struct enc28j60_rule {
+	uint8_t match;  /* Mask built from ENC28J60_MATCH_* */
+	uint16_t ethertype;
+	uint8_t ip_protocol;
+	uint16_t port_min;
+	uint16_t port_max;
+	uint8_t class_id;  /* Class of matching frames, or ENC28J60_CLASS_DROP */
+};
+
+/*
+ * Frame classifier.
+ * Decides on a frame from its first ENC28J60_CLASSIFIER_PEEK bytes, read straight from the receive buffer, so
+ * unwanted frames never cross SPI in full. Rules are compiled into bitmaps of candidate rules per destination type,
+ * EtherType and IP protocol, so a frame is matched by intersecting three masks and checking the remaining
+ * candidates in rule order.
+ */
+struct enc28j60_classifier {
+
+	/* Local IPv4 address for ENC28J60_MATCH_LOCAL_IP, in network byte order. */
+	uint8_t ip_address[4];
+
+	/* Class of frames matching no rule, ENC28J60_CLASS_DROP to drop them. */
+	uint8_t default_class;
+
+	/* Counters of accepted and dropped frames, and of payload bytes not read because of drops. */
+	uint32_t accepted;
+	uint32_t dropped;
+	uint32_t dropped_bytes;
+
+	/* Compiled rules. Managed by enc28j60_classifier_compile. */
+	struct enc28j60_rule rules[ENC28J60_CLASSIFIER_RULES];
+	uint32_t by_destination[4];
+	uint16_t ethertypes[ENC28J60_CLASSIFIER_KEYS];
+	uint32_t by_ethertype[ENC28J60_CLASSIFIER_KEYS];
+	uint32_t any_ethertype;
+	uint8_t ip_protocols[ENC28J60_CLASSIFIER_KEYS];
+	uint32_t by_ip_protocol[ENC28J60_CLASSIFIER_KEYS];
+	uint32_t any_ip_protocol;
+	uint8_t ethertype_count;
+	uint8_t ip_protocol_count;
+
+};
+
+/*
+ * Compile a rule table. Earlier rules take precedence.
+ * ip_address and default_class are not modified.
+ * \return false if there are more than ENC28J60_CLASSIFIER_RULES rules or ENC28J60_CLASSIFIER_KEYS distinct
+ * EtherTypes or IP protocols, true otherwise
+ */
+bool enc28j60_classifier_compile(struct enc28j60_classifier *classifier, const struct enc28j60_rule *rules,
+		size_t count);
+
+/*
+ * Start receiving the next frame and classify it.
+ * Call instead of enc28j60_receive_init. Dropped frames are acknowledged right away. Accepted frames are left
+ * pending with the read position at their start, so they can be read with enc28j60_receive_read (for example by
+ * low_level_read) and MUST then be acknowledged with enc28j60_receive_ack.
+ * \param class_id class of the accepted frame, for example to pick a delivery queue
+ * \return length of the accepted frame, 0 if the frame was dropped
+ */
+uint16_t enc28j60_classify(struct enc28j60_classifier *classifier, struct enc28j60 *self, uint8_t *class_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
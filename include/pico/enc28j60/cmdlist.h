@@ -0,0 +1,157 @@
+#ifndef ENC28J60_CMDLIST_H
+#define ENC28J60_CMDLIST_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENC28J60_CMDLIST_COMMANDS 16  /* Maximum number of commands in a list */
+#define ENC28J60_CMDLIST_BYTES 64  /* Maximum number of bytes clocked by a list (instructions, data and reads) */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Command of a command list. Managed by the library. */
+struct enc28j60_command {
+	uint8_t tx_len;
+	uint8_t rx_len;
+	uint8_t tx_offset;  /* Index of the first word of the command in the stream */
+	uint8_t rx_offset;  /* Index of the first clocked byte of the command in the received bytes */
+};
+
+/*
+ * Command list.
+ * A sequence of SPI commands (instruction, data, expected read length) executed in one go.
+ * With the PIO transport the list is executed by two DMA channels feeding and draining the state machine, which also
+ * times the chip select, so the CPU is not involved per command. With the hardware SPI transport the list is
+ * executed by the CPU in a single critical section.
+ */
+struct enc28j60_cmdlist {
+
+	/* PIO stream: bit count word followed by one word per byte, for every command. Managed by the library. */
+	uint32_t tx[ENC28J60_CMDLIST_COMMANDS + ENC28J60_CMDLIST_BYTES];
+
+	/* Every byte clocked by the list. Read results are gathered from here. Managed by the library. */
+	uint8_t rx[ENC28J60_CMDLIST_BYTES];
+
+	struct enc28j60_command commands[ENC28J60_CMDLIST_COMMANDS];
+	uint8_t count;
+	uint8_t tx_len;
+	uint8_t rx_len;
+
+	/* DMA channels claimed by enc28j60_cmdlist_init. */
+	int tx_channel;
+	int rx_channel;
+
+	/* Bank selected by the list (see enc28j60_cmdlist_select_bank), ENC28J60_BANK_ANY if unchanged. */
+	uint8_t bank;
+
+	/* Instance the list was submitted to, NULL when idle. Managed by the library. */
+	struct enc28j60 *submitted;
+
+};
+
+/* Initialize an empty list and claim two DMA channels for it. */
+void enc28j60_cmdlist_init(struct enc28j60_cmdlist *list);
+
+/* Remove all commands from the list. */
+void enc28j60_cmdlist_clear(struct enc28j60_cmdlist *list);
+
+/*
+ * Append a command to the list.
+ * \param data len bytes sent after the instruction
+ * \param read_len amount of bytes read after data
+ * \return index of the command, to be passed to enc28j60_cmdlist_result, or -1 if the list is full
+ */
+int enc28j60_cmdlist_add(struct enc28j60_cmdlist *list, uint8_t instruction, const uint8_t *data, size_t len,
+		size_t read_len);
+
+/*
+ * Append a bank switch to the list.
+ * The bank of the instance is updated when the list is submitted.
+ * \return index of the last command added, or -1 if the list is full, in which case nothing is added
+ */
+int enc28j60_cmdlist_select_bank(struct enc28j60_cmdlist *list, uint8_t bank);
+
+/*
+ * Start executing the list.
+ * The list runs in a transaction (see enc28j60_transaction_begin) that lasts until enc28j60_cmdlist_wait returns,
+ * so do not call any other enc28j60_* function on the instance in between.
+ */
+void enc28j60_cmdlist_submit(struct enc28j60 *config, struct enc28j60_cmdlist *list);
+
+/* \return true if the submitted list is still executing */
+bool enc28j60_cmdlist_busy(const struct enc28j60_cmdlist *list);
+
+/* Block until the submitted list is executed and release the instance. */
+void enc28j60_cmdlist_wait(struct enc28j60_cmdlist *list);
+
+/* \return read_len bytes read by the command at index (see enc28j60_cmdlist_add) */
+const uint8_t *enc28j60_cmdlist_result(const struct enc28j60_cmdlist *list, int index);
+
+/*
+ * Asynchronous equivalents of the ISR prologue and epilogue and of the receive and transmit setup.
+ * Every *_submit function builds its sequence in the list and submits it, the matching *_complete function waits for
+ * the list and returns the result. The CPU is free in between, but the instance MUST NOT be used until the list is
+ * complete (see enc28j60_cmdlist_submit). The *_batched functions submit and complete in one call.
+ */
+
+/* Asynchronous equivalent of enc28j60_isr_begin followed by enc28j60_interrupt_flags. */
+void enc28j60_isr_begin_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/* \return mask built from ENC28J60_{PKTIF,DMAIF,LINKIF,TXIF,TXERIF,RXERIF} */
+uint8_t enc28j60_isr_begin_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/*
+ * Batched equivalent of enc28j60_isr_begin followed by enc28j60_interrupt_flags.
+ * \return mask built from ENC28J60_{PKTIF,DMAIF,LINKIF,TXIF,TXERIF,RXERIF}
+ */
+uint8_t enc28j60_isr_begin_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/*
+ * Asynchronous equivalent of enc28j60_interrupt_clear followed by enc28j60_isr_end.
+ * \param flags interrupt flags to clear, see enc28j60_interrupt_clear
+ */
+void enc28j60_isr_end_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list, uint8_t flags);
+void enc28j60_isr_end_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/*
+ * Batched equivalent of enc28j60_interrupt_clear followed by enc28j60_isr_end.
+ * \param flags interrupt flags to clear, see enc28j60_interrupt_clear
+ */
+void enc28j60_isr_end_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list, uint8_t flags);
+
+/*
+ * Asynchronous equivalent of enc28j60_transfer_init.
+ * Waits for a transmission started with enc28j60_transfer_start to finish before submitting.
+ */
+void enc28j60_transfer_init_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+void enc28j60_transfer_init_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/* Batched equivalent of enc28j60_transfer_init. */
+void enc28j60_transfer_init_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/* Asynchronous equivalent of enc28j60_receive_init. */
+void enc28j60_receive_init_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/* \return packet size in bytes */
+uint16_t enc28j60_receive_init_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/* Batched equivalent of enc28j60_receive_init. */
+uint16_t enc28j60_receive_init_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/* Asynchronous equivalent of enc28j60_receive_ack. */
+void enc28j60_receive_ack_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+void enc28j60_receive_ack_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+/* Batched equivalent of enc28j60_receive_ack. */
+void enc28j60_receive_ack_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef ENC28J60_DISPATCH_H
+#define ENC28J60_DISPATCH_H
+
+#include <pico/util/queue.h>
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#define ETHERNETIF_DISPATCH_QUEUES 2  /* One queue per RP2040 core */
+
+/* Frame handler, owns p and MUST free it. */
+typedef void (*ethernetif_dispatch_handler_t)(struct pbuf *p, void *context);
+
+/* Queue of one core. */
+struct ethernetif_dispatch_queue {
+
+	/* Handler registered on the core, NULL if none. Frames steered to a queue without handler are dropped. */
+	ethernetif_dispatch_handler_t handler;
+	void *context;
+
+	/* Counters: frames and bytes queued, and frames dropped because the queue was full or had no handler. */
+	u32_t enqueued;
+	u32_t bytes;
+	u32_t dropped;
+
+	/* Counters: frames handled, and time spent in the handler in microseconds. */
+	u32_t handled;
+	u32_t busy_us;
+
+	/* Largest number of frames waiting. */
+	u16_t max_depth;
+
+	/* Managed by the library. */
+	queue_t queue;
+
+};
+
+/*
+ * Receive flow dispatcher.
+ * Received frames are steered to a queue per core by a hash of their flow, so packet parsing and application work
+ * of raw-API applications is spread over both cores. The hash covers the IPv4 addresses, protocol and TCP or UDP
+ * ports, or the MAC addresses and EtherType of other frames, after an 802.1Q tag if present. It is symmetric, so
+ * both directions of a flow end up on the same core. Every flow always goes to the same queue, in receive order.
+ * Handlers free pbufs on their own core, so lwIP MUST be built with SYS_LIGHTWEIGHT_PROT and a sys_arch_protect
+ * that excludes the other core. Handlers MUST NOT call the raw API of lwIP from the core not running it.
+ */
+struct ethernetif_dispatch {
+
+	struct ethernetif_dispatch_queue queues[ETHERNETIF_DISPATCH_QUEUES];
+
+	/* Frames each queue holds, 0 for 16. */
+	u16_t depth;
+
+};
+
+/* Allocate the queues. Call before any other function of the dispatcher. */
+void ethernetif_dispatch_init(struct ethernetif_dispatch *dispatch);
+
+/* Register the handler of the calling core. */
+void ethernetif_dispatch_register(struct ethernetif_dispatch *dispatch, ethernetif_dispatch_handler_t handler,
+		void *context);
+
+/* \return flow hash of an Ethernet frame */
+u32_t ethernetif_dispatch_hash(const struct pbuf *p);
+
+/*
+ * Steer a received frame to the queue of its flow.
+ * Call from the receive path, for example with the pbuf returned by low_level_input. Use a single producer, so
+ * frames of a flow are queued in receive order.
+ * \return true if the frame was queued, false if it was freed
+ */
+bool ethernetif_dispatch_put(struct ethernetif_dispatch *dispatch, struct pbuf *p);
+
+/*
+ * Hand queued frames of the calling core to its handler.
+ * \param budget most frames to handle, 0 for all frames queued
+ * \return number of frames handled
+ */
+u32_t ethernetif_dispatch_poll(struct ethernetif_dispatch *dispatch, u32_t budget);
+
+#endif
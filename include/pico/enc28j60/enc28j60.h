@@ -2,8 +2,13 @@
 #define ENC28J60_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*
  * Extract the value of a status bit from a packet transmit status vector.
  * Will return non-zero value if the bit is set, zero otherwise.
@@ -14,6 +19,43 @@
 
 struct spi_inst;
 struct critical_section;
+struct enc28j60_pio;
+struct enc28j60_cmdlist;
+struct enc28j60_txcache;
+struct enc28j60_capture;
+struct ethernetif_tx_scheduler;
+struct ethernetif_rtos;
+struct ethernetif_vlan;
+
+/* Lock bookkeeping. Managed by the library. */
+struct enc28j60_lock {
+	uint8_t depth;  /* Nesting depth of the owning core */
+	uint8_t core;  /* Core holding the lock */
+	uint32_t start;  /* Time the lock was taken */
+};
+
+/*
+ * SPI bus shared by several ENC28J60 instances.
+ * Instances on the same bus are serialised by its critical section, instances on different buses run in parallel.
+ */
+struct enc28j60_bus {
+
+	/*
+	 * SPI bus (spi0 or spi1).
+	 * The bus MUST be initialized before calling any enc28j60_* function.
+	 */
+	struct spi_inst *spi;
+
+	/*
+	 * Critical section serialising the instances on this bus.
+	 * Set to an initialized critical section object (use critical_section_init) or NULL if all instances are used
+	 * from a single context.
+	 */
+	struct critical_section *critical_section;
+
+	struct enc28j60_lock lock;
+
+};
 
 /* ENC28J60 configuration */
 struct enc28j60 {
@@ -27,6 +69,13 @@ struct enc28j60 {
 	 */
 	struct spi_inst *spi;
 
+	/*
+	 * Shared SPI bus.
+	 * If bus is set to non-NULL value, the spi and critical_section fields are ignored and the ones of the bus are
+	 * used instead. Use this for several ENC28J60 on one SPI bus. Otherwise, remember to set this to NULL.
+	 */
+	struct enc28j60_bus *bus;
+
 	/*
 	 * Chip Select pin.
 	 * This pin MUST be configured as output before calling any enc28j60_* function.
@@ -34,6 +83,15 @@ struct enc28j60 {
 	 */
 	uint8_t cs_pin;
 
+	/*
+	 * PIO transport.
+	 * If pio is set to non-NULL value, SPI commands are executed by a PIO state machine (see pico/enc28j60/pio.h)
+	 * and the spi and cs_pin fields are ignored.
+	 * The transport MUST be initialized with enc28j60_pio_init before calling any enc28j60_* function.
+	 * Otherwise, remember to set this to NULL.
+	 */
+	struct enc28j60_pio *pio;
+
 	/*
 	 * MAC address of the device.
 	 * Example:
@@ -43,29 +101,126 @@ struct enc28j60 {
 	 */
 	uint8_t mac_address[6];
 
+	/*
+	 * Reception buffer size of this instance, see ENC28J60_RCV_BUFFER_SIZE.
+	 * Set to 0 to use ENC28J60_RCV_BUFFER_SIZE.
+	 */
+	uint16_t rx_buffer_size;
+
 	/*
 	 * Critical section for IRQ safe mutual exclusion of the enc28j60 device.
 	 * If critical_section is set to non-NULL value, the critical section is entered (blocking) for the time of
-	 * executing every SPI command.
+	 * executing every SPI command, or once for a whole transaction (see enc28j60_transaction_begin).
 	 * If you use this library in a way that execution of a command can be interrupted (for example: main loop and
 	 * interrupt service routine), then set critical_section to an initialized critical section object (use
 	 * critical_section_init). Otherwise, remember to set this to NULL.
 	 */
 	struct critical_section *critical_section;
 
+	/*
+	 * Preemptible bulk copies.
+	 * If preempt_chunk is set to non-zero value, enc28j60_receive_read and enc28j60_transfer_write copy at most
+	 * preempt_chunk bytes per critical section and release it in between, so long frames do not keep interrupts
+	 * disabled for the whole copy. The buffer pointers are restored before every chunk, so an interrupt service
+	 * routine may access registers between the chunks, but it MUST NOT transmit or receive while the interrupted
+	 * context holds the respective buffer (see enc28j60_buffer_held).
+	 * Set to 0 to copy in one go.
+	 */
+	uint16_t preempt_chunk;
+
+	/*
+	 * Longest time the critical section was held, in microseconds.
+	 * Updated by the library, write 0 to restart the measurement.
+	 */
+	uint32_t max_lock_us;
+
+	/*
+	 * Bytes clocked over SPI by single commands (instructions, arguments and data), not counting command lists.
+	 * Updated by the library, write 0 to restart the measurement.
+	 */
+	uint32_t spi_bytes;
+
 	/*
 	 * Address of the next packet in the receive buffer.
 	 * You shouldn't have to modify this, it is managed by the library.
 	 */
 	uint16_t next_packet;
 
+	/*
+	 * Currently selected register bank.
+	 * Register accessors skip the bank switch when the register is in this bank already.
+	 * Set to 0 by enc28j60_init (bank after reset). You shouldn't have to modify this, it is managed by the library.
+	 */
+	uint8_t bank;
+
+	/*
+	 * Start and read pointer of the packet being received and lock bookkeeping.
+	 * You shouldn't have to modify these, they are managed by the library.
+	 */
+	uint16_t rx_start;
+	uint16_t rx_pointer;
+	uint8_t rx_held;  /* Frames taken with enc28j60_frame_next and not released yet */
+	volatile uint8_t buffers;  /* Buffers held, see enc28j60_buffer_held */
+	uint32_t tx_generation;  /* Incremented whenever the transmit buffer is rewritten from its start */
+
+	/*
+	 * Retransmit cache used by ethernetif (see pico/enc28j60/txcache.h).
+	 * Set to an initialized cache to keep TCP payloads of sent frames in chip SRAM. Otherwise, remember to set this
+	 * to NULL.
+	 */
+	struct enc28j60_txcache *tx_cache;
+
+	/*
+	 * Transmit scheduler used by ethernetif (see pico/enc28j60/ethernetif.h).
+	 * Set to an initialized scheduler to queue outgoing packets by priority. Otherwise, remember to set this to NULL.
+	 */
+	struct ethernetif_tx_scheduler *tx_scheduler;
+
+	/* Driver task serving this instance (see pico/enc28j60/ethernetif_rtos.h). Managed by the library. */
+	struct ethernetif_rtos *rtos;
+
+	/*
+	 * VLAN demultiplexer used by ethernetif (see pico/enc28j60/vlan.h).
+	 * If vlan is set to non-NULL value, enc28j60_init accepts 802.1Q tagged frames of full length and pads short
+	 * tagged frames to 64 bytes. Otherwise, remember to set this to NULL.
+	 */
+	struct ethernetif_vlan *vlan;
+
+	/*
+	 * Frame capture used by ethernetif, the VLAN interfaces and the bridge (see pico/enc28j60/capture.h).
+	 * Set to an initialized capture to record received and sent frames. Otherwise, remember to set this to NULL.
+	 */
+	struct enc28j60_capture *capture;
+
+	/*
+	 * Command list used by ethernetif (see pico/enc28j60/cmdlist.h).
+	 * Set to a list initialized with enc28j60_cmdlist_init to set up every received and sent frame with one
+	 * asynchronous submission, overlapped with the header parsing and bookkeeping of ethernetif. The list is used from
+	 * the receive and transmit paths alike, so they MUST be serialised by critical_section if they run in different
+	 * contexts. Otherwise, remember to set this to NULL.
+	 */
+	struct enc28j60_cmdlist *cmdlist;
+
+	struct enc28j60_lock lock;
+
 };
 
 /* Soft reset, initialize and enable packet reception. */
-void enc28j60_init(const struct enc28j60 *self);
+void enc28j60_init(struct enc28j60 *self);
+
+/*
+ * Wait for a transmission started with enc28j60_transfer_start to finish and claim the transmit buffer as
+ * ENC28J60_BUFFER_TX. Spins rather than sleeps, so it is safe in an interrupt service routine; inside an open
+ * transaction it spins with interrupts disabled, so prefer calling it before enc28j60_transaction_begin.
+ * Senders that write the transmit buffer without enc28j60_transfer_init MUST call it first.
+ */
+void enc28j60_transfer_claim(struct enc28j60 *self);
 
-/* Start the process of transmitting a single packet. */
-void enc28j60_transfer_init(const struct enc28j60 *self);
+/*
+ * Start the process of transmitting a single packet.
+ * Claims the transmit buffer with enc28j60_transfer_claim first.
+ */
+void enc28j60_transfer_init(struct enc28j60 *self);
 
 /*
  * Write data to the transmit buffer of the IC.
@@ -75,20 +230,38 @@ void enc28j60_transfer_init(const struct enc28j60 *self);
  * \param payload pointer to the application buffer
  * \param len length of the data to be written
  */
-void enc28j60_transfer_write(const struct enc28j60 *self, const uint8_t *payload, size_t len);
+void enc28j60_transfer_write(struct enc28j60 *self, const uint8_t *payload, size_t len);
+
+/*
+ * Append data already in the chip SRAM to the transmit buffer.
+ * The data is copied by the DMA copy engine of the IC, so it does not cross SPI.
+ * Can be mixed with enc28j60_transfer_write.
+ * \param source chip SRAM address of the data, for example allocated with enc28j60_sram_alloc
+ * \param len length of the data
+ */
+void enc28j60_transfer_copy(struct enc28j60 *self, uint16_t source, size_t len);
 
 /*
  * Transmits the packet that is currently in the transmit buffer.
  * This function blocks until the packet is transmitted or aborted due to an error.
  */
-void enc28j60_transfer_send(const struct enc28j60 *self);
+void enc28j60_transfer_send(struct enc28j60 *self);
+
+/*
+ * Start transmitting the packet that is currently in the transmit buffer and return right away.
+ * Use enc28j60_transfer_busy to find out when the transmit buffer can be written again.
+ */
+void enc28j60_transfer_start(struct enc28j60 *self);
+
+/* \return true if a packet is being transmitted */
+bool enc28j60_transfer_busy(struct enc28j60 *self);
 
 /*
  * Retrieves the status vector of last transmitted packet.
  * This library provides the ENC28J60_TX_STATUS_BIT macro for convenient access to single bits of the status vector.
  * \param status a seven byte buffer, where the status will be written to
  */
-void enc28j60_transfer_status(const struct enc28j60 *self, uint8_t *status);
+void enc28j60_transfer_status(struct enc28j60 *self, uint8_t *status);
 
 /*
  * Start the process of receiving the next single packet from the receive buffer.
@@ -103,207 +276,435 @@ uint16_t enc28j60_receive_init(struct enc28j60 *self);
  * \param payload a buffer to copy the data to
  * \param len amount of bytes to read
  */
-void enc28j60_receive_read(const struct enc28j60 *self, uint8_t *payload, size_t len);
+void enc28j60_receive_read(struct enc28j60 *self, uint8_t *payload, size_t len);
+
+/*
+ * Move the read position within the packet being received.
+ * The next enc28j60_receive_read continues from offset bytes after the start of the packet, so a packet can be
+ * read again or parts of it skipped.
+ * \param offset position relative to the start of the packet, less than the length returned from
+ * enc28j60_receive_init
+ */
+void enc28j60_receive_seek(struct enc28j60 *self, uint16_t offset);
 
 /* End the packet reception process and free part of the receive buffer of the IC. */
-void enc28j60_receive_ack(const struct enc28j60 *self);
+void enc28j60_receive_ack(struct enc28j60 *self);
+
+/*
+ * Handle of a received frame left in the receive buffer of the IC.
+ * Returned from enc28j60_frame_next, valid until passed to enc28j60_frame_release.
+ */
+struct enc28j60_frame {
+	uint16_t start;  /* Address of the first byte of the frame */
+	uint16_t next;  /* Address of the next frame */
+	uint16_t len;  /* Frame length without CRC, 0 if the frame was received with an error */
+};
+
+/*
+ * Take the next received frame without copying it.
+ * Several frames can be held at once, so the application can parse headers first and copy payloads straight to
+ * their destination later. Do not mix with enc28j60_receive_init and enc28j60_receive_ack while frames are held.
+ * \return false if there is no frame which has not been taken yet
+ */
+bool enc28j60_frame_next(struct enc28j60 *self, struct enc28j60_frame *frame);
+
+/*
+ * Read part of a held frame.
+ * Any part can be read in any order, wrapping around the end of the receive buffer is handled.
+ * \param offset position of the first byte to read, relative to the start of the frame
+ * \param data a buffer to copy len bytes to
+ */
+void enc28j60_frame_read(struct enc28j60 *self, const struct enc28j60_frame *frame, uint16_t offset, uint8_t *data,
+		size_t len);
+
+/*
+ * Release a held frame and free its part of the receive buffer of the IC.
+ * Frames MUST be released in the order they were taken.
+ */
+void enc28j60_frame_release(struct enc28j60 *self, const struct enc28j60_frame *frame);
+
+/*
+ * Number of received frames which have not been taken yet.
+ * The PKTIF interrupt flag stays set while frames are held, so poll this instead of relying on the interrupt.
+ */
+uint8_t enc28j60_frame_pending(struct enc28j60 *self);
 
 /*
  * Enable or disable interrupts on the INT pin of the IC.
  * Interrupts specified in the flags argument will be enabled, the rest of them will be disabled.
  * \param flags mask built from ENC28J60_{PKTIE,DMAIE,LINKIE,TXIE,TXERIE,RXERIE}
  */
-void enc28j60_interrupts(const struct enc28j60 *self, uint8_t flags);
+void enc28j60_interrupts(struct enc28j60 *self, uint8_t flags);
 
 /*
  * Clears the EIE.INTIE bit.
  * Call at the beginning of the interrupt service routine to prevent missing a falling edge.
  */
-void enc28j60_isr_begin(const struct enc28j60 *self);
+void enc28j60_isr_begin(struct enc28j60 *self);
 
 /*
  * Sets the EIE.INTIE bit.
  * Call at the beginning of the interrupt service routine to prevent missing a falling edge.
  */
-void enc28j60_isr_end(const struct enc28j60 *self);
+void enc28j60_isr_end(struct enc28j60 *self);
 
 /*
  * Read the interrupt flags.
  * Call in the interrupt service routine to find out the reason for the interrupt.
  * \return mask built from ENC28J60_{PKTIF,DMAIF,LINKIF,TXIF,TXERIF,RXERIF}
  */
-uint8_t enc28j60_interrupt_flags(const struct enc28j60 *self);
+uint8_t enc28j60_interrupt_flags(struct enc28j60 *self);
 
 /*
  * Clears interrupt flags.
  * \param flags mask built from interrupt flags (see enc28j60_interrupt_flags); if 0 then clears all flags
  */
-void enc28j60_interrupt_clear(const struct enc28j60 *self, uint8_t flags);
+void enc28j60_interrupt_clear(struct enc28j60 *self, uint8_t flags);
 
-/* --- LOW-LEVEL STUFF BELOW --- you probably won't need this */
+/*
+ * Copy a block of chip SRAM with the DMA copy engine of the IC and wait for the copy to finish.
+ * A source block in the receive buffer may wrap around its end.
+ * \param destination chip SRAM address of the copy, outside the receive buffer
+ * \param source chip SRAM address of the data
+ * \param len length of the data, at least 1
+ */
+void enc28j60_dma_copy(struct enc28j60 *self, uint16_t destination, uint16_t source, size_t len);
+
+/*
+ * Find out whether a frame is being written to or read from a buffer of the IC.
+ * ENC28J60_BUFFER_TX is held from enc28j60_transfer_claim or enc28j60_transfer_init until enc28j60_transfer_start or
+ * enc28j60_transfer_send, ENC28J60_BUFFER_RX from enc28j60_receive_init until enc28j60_receive_ack. Only the buffer
+ * pointers are restored between the calls, so an interrupt service routine that transmits or receives MUST check the
+ * buffer first and leave the work for later if the interrupted context holds it.
+ * \param buffer ENC28J60_BUFFER_TX or ENC28J60_BUFFER_RX
+ */
+bool enc28j60_buffer_held(const struct enc28j60 *self, uint8_t buffer);
 
-void enc28j60_read(const struct enc28j60 *config, uint8_t instruction, uint8_t *data, size_t len);
-void enc28j60_write(const struct enc28j60 *config, uint8_t instruction, const uint8_t *data, size_t len);
-uint8_t enc28j60_read_cr8(const struct enc28j60 *config, uint8_t address, bool skip_dummy);
-uint16_t enc28j60_read_cr16(const struct enc28j60 *config, uint8_t address);
-void enc28j60_write_cr8(const struct enc28j60 *config, uint8_t address, uint8_t data);
-void enc28j60_write_cr16(const struct enc28j60 *config, uint8_t address, uint16_t data);
-void enc28j60_bit_set(const struct enc28j60 *config, uint8_t address, uint8_t mask);
-void enc28j60_bit_clear(const struct enc28j60 *config, uint8_t address, uint8_t mask);
-uint8_t enc28j60_switch_bank(const struct enc28j60 *config, uint8_t bank);
-uint16_t enc28j60_read_phy(const struct enc28j60 *config, uint8_t address);
-void enc28j60_write_phy(const struct enc28j60 *config, uint8_t address, uint16_t data);
+/*
+ * Begin a transaction.
+ * The critical section (if any) is entered once and held until the matching enc28j60_transaction_end, so
+ * multi-step operations (bank switch, register writes, buffer access) cannot be interleaved by an interrupt service
+ * routine or the other core. Transactions can be nested.
+ */
+void enc28j60_transaction_begin(struct enc28j60 *self);
 
-extern const uint16_t ENC28J60_RCV_BUFFER_SIZE;  /* Reception buffer size */
+/* End a transaction started with enc28j60_transaction_begin. */
+void enc28j60_transaction_end(struct enc28j60 *self);
+
+/* --- LOW-LEVEL STUFF BELOW --- you probably won't need this */
+
+void enc28j60_read(struct enc28j60 *config, uint8_t instruction, uint8_t *data, size_t len);
+void enc28j60_write(struct enc28j60 *config, uint8_t instruction, const uint8_t *data, size_t len);
+void enc28j60_write_sequence(struct enc28j60 *config, const uint8_t (*commands)[2], size_t count);
+uint8_t enc28j60_read_cr8(struct enc28j60 *config, uint8_t address, bool skip_dummy);
+uint16_t enc28j60_read_cr16(struct enc28j60 *config, uint8_t address);
+void enc28j60_write_cr8(struct enc28j60 *config, uint8_t address, uint8_t data);
+void enc28j60_write_cr16(struct enc28j60 *config, uint8_t address, uint16_t data);
+void enc28j60_bit_set(struct enc28j60 *config, uint8_t address, uint8_t mask);
+void enc28j60_bit_clear(struct enc28j60 *config, uint8_t address, uint8_t mask);
+uint8_t enc28j60_switch_bank(struct enc28j60 *config, uint8_t bank);
+uint16_t enc28j60_read_phy(struct enc28j60 *config, uint8_t address);
+void enc28j60_write_phy(struct enc28j60 *config, uint8_t address, uint16_t data);
+void enc28j60_banked_read(struct enc28j60 *config, uint8_t bank, uint8_t instruction, uint8_t *data, size_t len);
+void enc28j60_banked_write(struct enc28j60 *config, uint8_t bank, const uint8_t (*commands)[2], size_t count);
+
+uint16_t enc28j60_rx_buffer_size(const struct enc28j60 *config);
+
+extern const uint16_t ENC28J60_RCV_BUFFER_SIZE;  /* Default reception buffer size */
+
+/* Buffers, see enc28j60_buffer_held */
+#define ENC28J60_BUFFER_TX 0x01
+#define ENC28J60_BUFFER_RX 0x02
 
 /* Instructions */
-extern const uint8_t ENC28J60_RCR;  /* Read Control Register */
-extern const uint8_t ENC28J60_RBM;  /* Read Buffer Memory */
-extern const uint8_t ENC28J60_WCR;  /* Write Control Register */
-extern const uint8_t ENC28J60_WBM;  /* Write Buffer Memory */
-extern const uint8_t ENC28J60_BFS;  /* Bit Field Set */
-extern const uint8_t ENC28J60_BFC;  /* Bit Field Clear */
-extern const uint8_t ENC28J60_SRC;  /* System Reset Command (Soft Reset) */
+#define ENC28J60_RCR 0x00 /* Read Control Register */
+#define ENC28J60_RBM 0x20 /* Read Buffer Memory */
+#define ENC28J60_WCR 0x40 /* Write Control Register */
+#define ENC28J60_WBM 0x60 /* Write Buffer Memory */
+#define ENC28J60_BFS 0x80 /* Bit Field Set */
+#define ENC28J60_BFC 0xA0 /* Bit Field Clear */
+#define ENC28J60_SRC 0xE0 /* System Reset Command (Soft Reset) */
 
-extern const uint8_t ENC28J60_BM_ARG;  /* RBM/WBM Argument */
-extern const uint8_t ENC28J60_SRC_ARG;  /* SRC Argument */
+#define ENC28J60_BM_ARG 0x1A /* RBM/WBM Argument */
+#define ENC28J60_SRC_ARG 0x1F /* SRC Argument */
 
 /* Common Control Registers */
-extern const uint8_t ENC28J60_EIE;
-extern const uint8_t ENC28J60_EIR;
-extern const uint8_t ENC28J60_ESTAT;
-extern const uint8_t ENC28J60_ECON2;
-extern const uint8_t ENC28J60_ECON1;
+#define ENC28J60_EIE 0x1B
+#define ENC28J60_EIR 0x1C
+#define ENC28J60_ESTAT 0x1D
+#define ENC28J60_ECON2 0x1E
+#define ENC28J60_ECON1 0x1F
 
 /* Bank 0 Control Registers */
-extern const uint8_t ENC28J60_ERDPT;
-extern const uint8_t ENC28J60_EWRPT;
-extern const uint8_t ENC28J60_ETXST;
-extern const uint8_t ENC28J60_ETXND;
-extern const uint8_t ENC28J60_ERXST;
-extern const uint8_t ENC28J60_ERXND;
-extern const uint8_t ENC28J60_ERXRDPT;
-extern const uint8_t ENC28J60_ERXWRPT;
-extern const uint8_t ENC28J60_EDMAST;
-extern const uint8_t ENC28J60_EDMAND;
-extern const uint8_t ENC28J60_EDMADST;
-extern const uint8_t ENC28J60_EDMACS;
+#define ENC28J60_ERDPT 0x00
+#define ENC28J60_EWRPT 0x02
+#define ENC28J60_ETXST 0x04
+#define ENC28J60_ETXND 0x06
+#define ENC28J60_ERXST 0x08
+#define ENC28J60_ERXND 0x0A
+#define ENC28J60_ERXRDPT 0x0C
+#define ENC28J60_ERXWRPT 0x0E
+#define ENC28J60_EDMAST 0x10
+#define ENC28J60_EDMAND 0x12
+#define ENC28J60_EDMADST 0x14
+#define ENC28J60_EDMACS 0x16
 
 /* Bank 1 Control Registers */
-extern const uint8_t ENC28J60_EHT;
-extern const uint8_t ENC28J60_EPMM;
-extern const uint8_t ENC28J60_EPMCS;
-extern const uint8_t ENC28J60_EPMO;
-extern const uint8_t ENC28J60_ERXFCON;
-extern const uint8_t ENC28J60_EPKTCNT;
+#define ENC28J60_EHT 0x00
+#define ENC28J60_EPMM 0x08
+#define ENC28J60_EPMCS 0x10
+#define ENC28J60_EPMO 0x14
+#define ENC28J60_ERXFCON 0x18
+#define ENC28J60_EPKTCNT 0x19
 
 /* Bank 2 Control Registers */
-extern const uint8_t ENC28J60_MACON1;
-extern const uint8_t ENC28J60_MACON3;
-extern const uint8_t ENC28J60_MACON4;
-extern const uint8_t ENC28J60_MABBIPG;
-extern const uint8_t ENC28J60_MAIPG;
-extern const uint8_t ENC28J60_MACLCON1;
-extern const uint8_t ENC28J60_MACLCON2;
-extern const uint8_t ENC28J60_MAMXFL;
-extern const uint8_t ENC28J60_MICMD;
-extern const uint8_t ENC28J60_MIREGADR;
-extern const uint8_t ENC28J60_MIWR;
-extern const uint8_t ENC28J60_MIRD;
+#define ENC28J60_MACON1 0x00
+#define ENC28J60_MACON3 0x02
+#define ENC28J60_MACON4 0x03
+#define ENC28J60_MABBIPG 0x04
+#define ENC28J60_MAIPG 0x06
+#define ENC28J60_MACLCON1 0x08
+#define ENC28J60_MACLCON2 0x09
+#define ENC28J60_MAMXFL 0x0A
+#define ENC28J60_MICMD 0x12
+#define ENC28J60_MIREGADR 0x14
+#define ENC28J60_MIWR 0x16
+#define ENC28J60_MIRD 0x18
 
 /* Bank 3 Control Registers */
-extern const uint8_t ENC28J60_MAADR5;
-extern const uint8_t ENC28J60_MAADR6;
-extern const uint8_t ENC28J60_MAADR3;
-extern const uint8_t ENC28J60_MAADR4;
-extern const uint8_t ENC28J60_MAADR1;
-extern const uint8_t ENC28J60_MAADR2;
-extern const uint8_t ENC28J60_EBSTD;
-extern const uint8_t ENC28J60_EBSTCON;
-extern const uint8_t ENC28J60_EBSTCS;
-extern const uint8_t ENC28J60_MISTAT;
-extern const uint8_t ENC28J60_EREVID;
-extern const uint8_t ENC28J60_ECOCON;
-extern const uint8_t ENC28J60_EFLOCON;
-extern const uint8_t ENC28J60_EPAUS;
+#define ENC28J60_MAADR5 0x00
+#define ENC28J60_MAADR6 0x01
+#define ENC28J60_MAADR3 0x02
+#define ENC28J60_MAADR4 0x03
+#define ENC28J60_MAADR1 0x04
+#define ENC28J60_MAADR2 0x05
+#define ENC28J60_EBSTD 0x06
+#define ENC28J60_EBSTCON 0x07
+#define ENC28J60_EBSTCS 0x08
+#define ENC28J60_MISTAT 0x0A
+#define ENC28J60_EREVID 0x12
+#define ENC28J60_ECOCON 0x15
+#define ENC28J60_EFLOCON 0x17
+#define ENC28J60_EPAUS 0x18
 
 /* PHY Registers */
-extern const uint8_t ENC28J60_PHCON1;
-extern const uint8_t ENC28J60_PHSTAT1;
-extern const uint8_t ENC28J60_PHID1;
-extern const uint8_t ENC28J60_PHID2;
-extern const uint8_t ENC28J60_PHCON2;
-extern const uint8_t ENC28J60_PHSTAT2;
-extern const uint8_t ENC28J60_PHIE;
-extern const uint8_t ENC28J60_PHIR;
-extern const uint8_t ENC28J60_PHLCON;
+#define ENC28J60_PHCON1 0x00
+#define ENC28J60_PHSTAT1 0x01
+#define ENC28J60_PHID1 0x02
+#define ENC28J60_PHID2 0x03
+#define ENC28J60_PHCON2 0x10
+#define ENC28J60_PHSTAT2 0x11
+#define ENC28J60_PHIE 0x12
+#define ENC28J60_PHIR 0x13
+#define ENC28J60_PHLCON 0x14
+
+/*
+ * Register descriptors
+ *
+ * A descriptor carries everything needed to access a control register, so the enc28j60_reg_* accessors below
+ * compile down to constant opcodes and select the right bank on their own.
+ * Bits 0-4: address, bits 5-6: bank,
+ * bit 7: 16-bit register (low byte at address, high byte at address + 1),
+ * bit 8: MAC or MII register (reads return a dummy byte first).
+ * Registers at addresses 0x1B-0x1F are common to all banks.
+ */
+typedef uint16_t enc28j60_reg_t;
+
+#define ENC28J60_REGF_16 0x0080
+#define ENC28J60_REGF_MAC 0x0100
+#define ENC28J60_REG(address, bank, flags) ((enc28j60_reg_t) ((address) | (bank) << 5 | (flags)))
+#define ENC28J60_REG_ADDRESS(reg) ((uint8_t) ((reg) & 0x1F))
+#define ENC28J60_REG_BANK(reg) (ENC28J60_REG_ADDRESS(reg) >= 0x1B ? ENC28J60_BANK_ANY : (uint8_t) ((reg) >> 5 & 0x03))
+#define ENC28J60_BANK_ANY 0xFF
+
+/* Common Control Registers */
+#define ENC28J60_REG_EIE ENC28J60_REG(ENC28J60_EIE, 0, 0)
+#define ENC28J60_REG_EIR ENC28J60_REG(ENC28J60_EIR, 0, 0)
+#define ENC28J60_REG_ESTAT ENC28J60_REG(ENC28J60_ESTAT, 0, 0)
+#define ENC28J60_REG_ECON2 ENC28J60_REG(ENC28J60_ECON2, 0, 0)
+#define ENC28J60_REG_ECON1 ENC28J60_REG(ENC28J60_ECON1, 0, 0)
+
+/* Bank 0 Control Registers */
+#define ENC28J60_REG_ERDPT ENC28J60_REG(ENC28J60_ERDPT, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_EWRPT ENC28J60_REG(ENC28J60_EWRPT, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_ETXST ENC28J60_REG(ENC28J60_ETXST, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_ETXND ENC28J60_REG(ENC28J60_ETXND, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_ERXST ENC28J60_REG(ENC28J60_ERXST, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_ERXND ENC28J60_REG(ENC28J60_ERXND, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_ERXRDPT ENC28J60_REG(ENC28J60_ERXRDPT, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_ERXWRPT ENC28J60_REG(ENC28J60_ERXWRPT, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_EDMAST ENC28J60_REG(ENC28J60_EDMAST, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_EDMAND ENC28J60_REG(ENC28J60_EDMAND, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_EDMADST ENC28J60_REG(ENC28J60_EDMADST, 0, ENC28J60_REGF_16)
+#define ENC28J60_REG_EDMACS ENC28J60_REG(ENC28J60_EDMACS, 0, ENC28J60_REGF_16)
+
+/* Bank 1 Control Registers */
+#define ENC28J60_REG_EPMCS ENC28J60_REG(ENC28J60_EPMCS, 1, ENC28J60_REGF_16)
+#define ENC28J60_REG_EPMO ENC28J60_REG(ENC28J60_EPMO, 1, ENC28J60_REGF_16)
+#define ENC28J60_REG_ERXFCON ENC28J60_REG(ENC28J60_ERXFCON, 1, 0)
+#define ENC28J60_REG_EPKTCNT ENC28J60_REG(ENC28J60_EPKTCNT, 1, 0)
+
+/* Bank 2 Control Registers */
+#define ENC28J60_REG_MACON1 ENC28J60_REG(ENC28J60_MACON1, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MACON3 ENC28J60_REG(ENC28J60_MACON3, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MACON4 ENC28J60_REG(ENC28J60_MACON4, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MABBIPG ENC28J60_REG(ENC28J60_MABBIPG, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MAIPG ENC28J60_REG(ENC28J60_MAIPG, 2, ENC28J60_REGF_MAC | ENC28J60_REGF_16)
+#define ENC28J60_REG_MACLCON1 ENC28J60_REG(ENC28J60_MACLCON1, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MACLCON2 ENC28J60_REG(ENC28J60_MACLCON2, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MAMXFL ENC28J60_REG(ENC28J60_MAMXFL, 2, ENC28J60_REGF_MAC | ENC28J60_REGF_16)
+#define ENC28J60_REG_MICMD ENC28J60_REG(ENC28J60_MICMD, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MIREGADR ENC28J60_REG(ENC28J60_MIREGADR, 2, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MIWR ENC28J60_REG(ENC28J60_MIWR, 2, ENC28J60_REGF_MAC | ENC28J60_REGF_16)
+#define ENC28J60_REG_MIRD ENC28J60_REG(ENC28J60_MIRD, 2, ENC28J60_REGF_MAC | ENC28J60_REGF_16)
+
+/* Bank 3 Control Registers */
+#define ENC28J60_REG_MAADR5 ENC28J60_REG(ENC28J60_MAADR5, 3, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MAADR6 ENC28J60_REG(ENC28J60_MAADR6, 3, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MAADR3 ENC28J60_REG(ENC28J60_MAADR3, 3, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MAADR4 ENC28J60_REG(ENC28J60_MAADR4, 3, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MAADR1 ENC28J60_REG(ENC28J60_MAADR1, 3, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_MAADR2 ENC28J60_REG(ENC28J60_MAADR2, 3, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_EBSTD ENC28J60_REG(ENC28J60_EBSTD, 3, 0)
+#define ENC28J60_REG_EBSTCON ENC28J60_REG(ENC28J60_EBSTCON, 3, 0)
+#define ENC28J60_REG_EBSTCS ENC28J60_REG(ENC28J60_EBSTCS, 3, ENC28J60_REGF_16)
+#define ENC28J60_REG_MISTAT ENC28J60_REG(ENC28J60_MISTAT, 3, ENC28J60_REGF_MAC)
+#define ENC28J60_REG_EREVID ENC28J60_REG(ENC28J60_EREVID, 3, 0)
+#define ENC28J60_REG_ECOCON ENC28J60_REG(ENC28J60_ECOCON, 3, 0)
+#define ENC28J60_REG_EFLOCON ENC28J60_REG(ENC28J60_EFLOCON, 3, 0)
+#define ENC28J60_REG_EPAUS ENC28J60_REG(ENC28J60_EPAUS, 3, ENC28J60_REGF_16)
 
 /* Register Bits */
-extern const uint8_t ENC28J60_UCEN;
-extern const uint8_t ENC28J60_ANDOR;
-extern const uint8_t ENC28J60_CRCEN;
-extern const uint8_t ENC28J60_PMEN;
-extern const uint8_t ENC28J60_MPEN;
-extern const uint8_t ENC28J60_HTEN;
-extern const uint8_t ENC28J60_MCEN;
-extern const uint8_t ENC28J60_BCEN;
-
-extern const uint8_t ENC28J60_TXPAUS;
-extern const uint8_t ENC28J60_RXPAUS;
-extern const uint8_t ENC28J60_PASSALL;
-extern const uint8_t ENC28J60_MARXEN;
-
-extern const uint8_t ENC28J60_PADCFG_64;
-extern const uint8_t ENC28J60_PADCFG_NO;
-extern const uint8_t ENC28J60_PADCFG_VLAN;
-extern const uint8_t ENC28J60_PADCFG_60;
-extern const uint8_t ENC28J60_TXCRCEN;
-extern const uint8_t ENC28J60_PHDREN;
-extern const uint8_t ENC28J60_HFRMEN;
-extern const uint8_t ENC28J60_FRMLNEN;
-extern const uint8_t ENC28J60_FULDPX;
-
-extern const uint16_t ENC28J60_FRCLNK;
-extern const uint16_t ENC28J60_TXDIS;
-extern const uint16_t ENC28J60_JABBER;
-extern const uint16_t ENC28J60_HDLDIS;
-
-extern const uint8_t ENC28J60_INTIE;
-extern const uint8_t ENC28J60_PKTIE;
-extern const uint8_t ENC28J60_DMAIE;
-extern const uint8_t ENC28J60_LINKIE;
-extern const uint8_t ENC28J60_TXIE;
-extern const uint8_t ENC28J60_TXERIE;
-extern const uint8_t ENC28J60_RXERIE;
-
-extern const uint8_t ENC28J60_TXRST;
-extern const uint8_t ENC28J60_RXRST;
-extern const uint8_t ENC28J60_DMAST;
-extern const uint8_t ENC28J60_CSUMEN;
-extern const uint8_t ENC28J60_TXRTS;
-extern const uint8_t ENC28J60_RXEN;
-
-extern const uint8_t ENC28J60_PKTIF;
-extern const uint8_t ENC28J60_DMAIF;
-extern const uint8_t ENC28J60_LINKIF;
-extern const uint8_t ENC28J60_TXIF;
-extern const uint8_t ENC28J60_TXERIF;
-extern const uint8_t ENC28J60_RXERIF;
-
-extern const uint8_t ENC28J60_AUTOINC;
-extern const uint8_t ENC28J60_PKTDEC;
-extern const uint8_t ENC28J60_PWRSV;
-extern const uint8_t ENC28J60_VRPS;
-
-extern const uint8_t ENC28J60_DEFER;
-
-extern const uint8_t ENC28J60_MIIRD;
-
-extern const uint8_t ENC28J60_INT;
-extern const uint8_t ENC28J60_BUFER;
-extern const uint8_t ENC28J60_LATECOL;
-extern const uint8_t ENC28J60_RXBUSY;
-extern const uint8_t ENC28J60_TXABRT;
-extern const uint8_t ENC28J60_CLKRDY;
+#define ENC28J60_UCEN 0x80
+#define ENC28J60_ANDOR 0x40
+#define ENC28J60_CRCEN 0x20
+#define ENC28J60_PMEN 0x10
+#define ENC28J60_MPEN 0x08
+#define ENC28J60_HTEN 0x04
+#define ENC28J60_MCEN 0x02
+#define ENC28J60_BCEN 0x01
+
+#define ENC28J60_TXPAUS 0x08
+#define ENC28J60_RXPAUS 0x04
+#define ENC28J60_PASSALL 0x02
+#define ENC28J60_MARXEN 0x01
+
+#define ENC28J60_PADCFG_64 0xE0
+#define ENC28J60_PADCFG_NO 0xC0
+#define ENC28J60_PADCFG_VLAN 0xA0
+#define ENC28J60_PADCFG_60 0x20
+#define ENC28J60_TXCRCEN 0x10
+#define ENC28J60_PHDREN 0x08
+#define ENC28J60_HFRMEN 0x04
+#define ENC28J60_FRMLNEN 0x02
+#define ENC28J60_FULDPX 0x01
+
+#define ENC28J60_PRST 0x8000
+#define ENC28J60_PLOOPBK 0x4000
+#define ENC28J60_PPWRSV 0x0800
+#define ENC28J60_PDPXMD 0x0100
+
+#define ENC28J60_FRCLNK 0x0400
+#define ENC28J60_TXDIS 0x0200
+#define ENC28J60_JABBER 0x0400
+#define ENC28J60_HDLDIS 0x0100
+
+#define ENC28J60_INTIE 0x80
+#define ENC28J60_PKTIE 0x40
+#define ENC28J60_DMAIE 0x20
+#define ENC28J60_LINKIE 0x10
+#define ENC28J60_TXIE 0x08
+#define ENC28J60_TXERIE 0x02
+#define ENC28J60_RXERIE 0x01
+
+#define ENC28J60_TXRST 0x80
+#define ENC28J60_RXRST 0x40
+#define ENC28J60_DMAST 0x20
+#define ENC28J60_CSUMEN 0x10
+#define ENC28J60_TXRTS 0x08
+#define ENC28J60_RXEN 0x04
+
+#define ENC28J60_PKTIF 0x40
+#define ENC28J60_DMAIF 0x20
+#define ENC28J60_LINKIF 0x10
+#define ENC28J60_TXIF 0x08
+#define ENC28J60_TXERIF 0x02
+#define ENC28J60_RXERIF 0x01
+
+#define ENC28J60_AUTOINC 0x80
+#define ENC28J60_PKTDEC 0x40
+#define ENC28J60_PWRSV 0x20
+#define ENC28J60_VRPS 0x08
+
+#define ENC28J60_DEFER 0x40
+
+#define ENC28J60_MIIRD 0x01
+
+#define ENC28J60_BUSY 0x01
+
+#define ENC28J60_INT 0x80
+#define ENC28J60_BUFER 0x40
+#define ENC28J60_LATECOL 0x10
+#define ENC28J60_RXBUSY 0x04
+#define ENC28J60_TXABRT 0x02
+#define ENC28J60_CLKRDY 0x01
+
+/* --- Banked register accessors --- */
+
+/*
+ * Read a control register described by a register descriptor (ENC28J60_REG_*).
+ * The bank is selected automatically, 16-bit registers are read as a whole and the dummy byte of MAC and MII
+ * registers is skipped.
+ */
+static inline uint16_t
+enc28j60_reg_read(struct enc28j60 *self, enc28j60_reg_t reg)
+{
+	uint8_t data[2];
+	size_t len = (reg & ENC28J60_REGF_MAC) ? 2 : 1;
+
+	enc28j60_banked_read(self, ENC28J60_REG_BANK(reg), ENC28J60_RCR | ENC28J60_REG_ADDRESS(reg), data, len);
+	uint16_t value = data[len - 1];
+	if (reg & ENC28J60_REGF_16) {
+		enc28j60_banked_read(self, ENC28J60_REG_BANK(reg), ENC28J60_RCR | (ENC28J60_REG_ADDRESS(reg) + 1), data,
+				len);
+		value |= (uint16_t) data[len - 1] << 8;
+	}
+
+	return value;
+}
+
+/*
+ * Write a control register described by a register descriptor (ENC28J60_REG_*).
+ * 16-bit registers are written low byte first, as required for MIWR.
+ */
+static inline void
+enc28j60_reg_write(struct enc28j60 *self, enc28j60_reg_t reg, uint16_t value)
+{
+	const uint8_t commands[][2] = {
+		{ (uint8_t) (ENC28J60_WCR | ENC28J60_REG_ADDRESS(reg)), (uint8_t) (value & 0xFF) },
+		{ (uint8_t) (ENC28J60_WCR | (ENC28J60_REG_ADDRESS(reg) + 1)), (uint8_t) (value >> 8) },
+	};
+	enc28j60_banked_write(self, ENC28J60_REG_BANK(reg), commands, (reg & ENC28J60_REGF_16) ? 2 : 1);
+}
+
+/* Set bits of a control register. ETH registers only, MAC and MII registers do not support BFS. */
+static inline void
+enc28j60_reg_set(struct enc28j60 *self, enc28j60_reg_t reg, uint8_t mask)
+{
+	const uint8_t commands[][2] = { { (uint8_t) (ENC28J60_BFS | ENC28J60_REG_ADDRESS(reg)), mask } };
+	enc28j60_banked_write(self, ENC28J60_REG_BANK(reg), commands, 1);
+}
+
+/* Clear bits of a control register. ETH registers only, MAC and MII registers do not support BFC. */
+static inline void
+enc28j60_reg_clear(struct enc28j60 *self, enc28j60_reg_t reg, uint8_t mask)
+{
+	const uint8_t commands[][2] = { { (uint8_t) (ENC28J60_BFC | ENC28J60_REG_ADDRESS(reg)), mask } };
+	enc28j60_banked_write(self, ENC28J60_REG_BANK(reg), commands, 1);
+}
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -0,0 +1,409 @@
+#ifndef ENC28J60_HPP
+#define ENC28J60_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/sram.h>
+
+/*
+ * Header-only C++ driver with static dispatch of the bus, chip select and locking.
+ *
+ * The template parameters are policies, so every board variant gets its own specialisation and the hot paths inline
+ * down to straight-line SPI code without runtime checks or indirection through struct enc28j60.
+ * Policies for the RP2040 live in pico/enc28j60/policies.hpp. This header does not depend on the Pico SDK, so the
+ * driver can be instantiated on a host with a mock SPI policy for unit tests and benchmarks.
+ *
+ * Spi policy:
+ *   static void transfer(const uint8_t *tx, uint8_t *rx, size_t len);
+ *   Clocks len bytes. tx == nullptr sends zeros, rx == nullptr discards the received bytes.
+ *
+ * Cs policy:
+ *   static void select();
+ *   static void deselect();
+ *
+ * Lock policy:
+ *   struct Guard; entering the lock in its constructor and leaving it in its destructor.
+ *
+ * Config policy:
+ *   static constexpr uint16_t rx_buffer_size;  receive buffer size, see ENC28J60_RCV_BUFFER_SIZE
+ *   static void delay_us(uint32_t us);
+ */
+
+namespace pico {
+namespace enc28j60 {
+
+template <typename Spi, typename Cs, typename Lock, typename Config>
+class Enc28j60 {
+public:
+
+	/* MAC address of the device, see struct enc28j60. */
+	uint8_t mac_address[6];
+
+	/* Address of the next packet in the receive buffer. Managed by the driver. */
+	uint16_t next_packet = 0;
+
+	explicit Enc28j60(const uint8_t (&mac)[6])
+	{
+		for (size_t i = 0; i < 6; i++) {
+			mac_address[i] = mac[i];
+		}
+	}
+
+	static_assert(Config::rx_buffer_size % 2 == 0, "receive buffer size should be even");
+	static_assert(Config::rx_buffer_size <= ENC28J60_SRAM_END - ENC28J60_TX_SPACE, "transmit buffer must hold a full frame");
+
+	/* Soft reset, initialize and enable packet reception. */
+	void
+	init()
+	{
+		command(ENC28J60_SRC | ENC28J60_SRC_ARG, nullptr, 0);
+		bank = 0;
+		Config::delay_us(1000); /* Errata issue 2 */
+
+		/* LED setup */
+		write_phy(ENC28J60_PHLCON, 0x3476);
+
+		/* MAC setup */
+		reg_write<ENC28J60_REG_ERXST>(0); /* Start receive buffer in 0 as per errata issue 5 */
+		reg_write<ENC28J60_REG_ERXND>(Config::rx_buffer_size - 1);
+		reg_write<ENC28J60_REG_ERXRDPT>(0);
+
+		reg_write<ENC28J60_REG_MACON1>(ENC28J60_MARXEN);
+		reg_write<ENC28J60_REG_MACON3>(ENC28J60_PADCFG_60 | ENC28J60_TXCRCEN | ENC28J60_FRMLNEN);
+		reg_write<ENC28J60_REG_MACON4>(ENC28J60_DEFER);
+		reg_write<ENC28J60_REG_MAMXFL>(1518);
+		reg_write<ENC28J60_REG_MABBIPG>(0x12);
+		reg_write<ENC28J60_REG_MAIPG>(0x0C12);
+
+		reg_write<ENC28J60_REG_MAADR1>(mac_address[0]);
+		reg_write<ENC28J60_REG_MAADR2>(mac_address[1]);
+		reg_write<ENC28J60_REG_MAADR3>(mac_address[2]);
+		reg_write<ENC28J60_REG_MAADR4>(mac_address[3]);
+		reg_write<ENC28J60_REG_MAADR5>(mac_address[4]);
+		reg_write<ENC28J60_REG_MAADR6>(mac_address[5]);
+
+		/* PHY setup */
+		write_phy(ENC28J60_PHCON2, ENC28J60_HDLDIS); /* Disable loopback as per errata issue 9 */
+
+		/* Disable all filters */
+		reg_write<ENC28J60_REG_ERXFCON>(0);
+
+		/* Enable reception */
+		reg_set<ENC28J60_REG_ECON1>(ENC28J60_RXEN);
+	}
+
+	/* Start the process of transmitting a single packet, see enc28j60_transfer_init. */
+	void
+	transfer_init()
+	{
+		reg_write<ENC28J60_REG_ETXST>(Config::rx_buffer_size);
+		reg_write<ENC28J60_REG_ETXND>(Config::rx_buffer_size);
+		reg_write<ENC28J60_REG_EWRPT>(Config::rx_buffer_size);
+
+		const uint8_t control = 0;
+		tx_end = Config::rx_buffer_size;
+		locked_command(ENC28J60_WBM | ENC28J60_BM_ARG, &control, 1);
+	}
+
+	/* Append data to the transmit buffer, see enc28j60_transfer_write. */
+	void
+	transfer_write(const uint8_t *payload, size_t len)
+	{
+		locked_command(ENC28J60_WBM | ENC28J60_BM_ARG, payload, len);
+		tx_end += len;
+		reg_write<ENC28J60_REG_ETXND>(tx_end);
+	}
+
+	/* Transmit the packet in the transmit buffer and wait for completion, see enc28j60_transfer_send. */
+	void
+	transfer_send()
+	{
+		{
+			typename Lock::Guard guard;
+			/* Reset transmission logic, errata issue 12 */
+			command2(ENC28J60_BFS | ENC28J60_ECON1, ENC28J60_TXRST);
+			command2(ENC28J60_BFC | ENC28J60_ECON1, ENC28J60_TXRST);
+
+			command2(ENC28J60_BFS | ENC28J60_ECON1, ENC28J60_TXRTS);
+		}
+
+		while (reg_read<ENC28J60_REG_ECON1>() & ENC28J60_TXRTS) {
+			Config::delay_us(1);
+		}
+	}
+
+	/* Retrieve the seven byte status vector of the last transmitted packet. */
+	void
+	transfer_status(uint8_t *status)
+	{
+		reg_write<ENC28J60_REG_ERDPT>(tx_end + 1);
+		locked_read(ENC28J60_RBM | ENC28J60_BM_ARG, status, 7);
+	}
+
+	/*
+	 * Start receiving the next packet, see enc28j60_receive_init.
+	 * \return packet size in bytes
+	 */
+	uint16_t
+	receive_init()
+	{
+		uint8_t header[6];
+		{
+			typename Lock::Guard guard;
+			select_bank(0);
+			command2(ENC28J60_WCR | ENC28J60_ERDPT, next_packet & 0xFF);
+			command2(ENC28J60_WCR | (ENC28J60_ERDPT + 1), next_packet >> 8);
+			read(ENC28J60_RBM | ENC28J60_BM_ARG, header, 6);
+		}
+
+		next_packet = header[0] | header[1] << 8;
+		uint16_t byte_count = header[2] | header[3] << 8;
+
+		return (header[4] & 0x80) ? byte_count - 4 : 0;
+	}
+
+	/* Read data of the packet being received, see enc28j60_receive_read. */
+	void
+	receive_read(uint8_t *payload, size_t len)
+	{
+		locked_read(ENC28J60_RBM | ENC28J60_BM_ARG, payload, len);
+	}
+
+	/* Free the packet being received, see enc28j60_receive_ack. */
+	void
+	receive_ack()
+	{
+		typename Lock::Guard guard;
+		command2(ENC28J60_BFS | ENC28J60_ECON2, ENC28J60_PKTDEC);
+
+		/* Free buffer & Errata issue 14 */
+		uint16_t rdpt = next_packet == 0 ? Config::rx_buffer_size - 1 : next_packet - 1;
+		select_bank(0);
+		command2(ENC28J60_WCR | ENC28J60_ERXRDPT, rdpt & 0xFF);
+		command2(ENC28J60_WCR | (ENC28J60_ERXRDPT + 1), rdpt >> 8);
+	}
+
+	/* Enable the given interrupts and disable the rest, see enc28j60_interrupts. */
+	void
+	interrupts(uint8_t flags)
+	{
+		typename Lock::Guard guard;
+		command2(ENC28J60_BFC | ENC28J60_EIR, flags);
+		command2(ENC28J60_WCR | ENC28J60_EIE, flags | ENC28J60_INTIE);
+	}
+
+	void
+	isr_begin()
+	{
+		reg_clear<ENC28J60_REG_EIE>(ENC28J60_INTIE);
+	}
+
+	void
+	isr_end()
+	{
+		reg_set<ENC28J60_REG_EIE>(ENC28J60_INTIE);
+	}
+
+	/* \return mask built from ENC28J60_{PKTIF,DMAIF,LINKIF,TXIF,TXERIF,RXERIF} */
+	uint8_t
+	interrupt_flags()
+	{
+		uint8_t flags = reg_read<ENC28J60_REG_EIR>();
+
+		/* Errata */
+		if (reg_read<ENC28J60_REG_EPKTCNT>()) {
+			flags |= ENC28J60_PKTIF;
+		}
+
+		return flags;
+	}
+
+	/* Clear interrupt flags, all of them if flags is 0. */
+	void
+	interrupt_clear(uint8_t flags)
+	{
+		if (!flags) {
+			flags = ENC28J60_PKTIF | ENC28J60_DMAIF | ENC28J60_LINKIF | ENC28J60_TXIF | ENC28J60_TXERIF |
+					ENC28J60_RXERIF;
+		}
+
+		reg_clear<ENC28J60_REG_EIR>(flags);
+	}
+
+	uint16_t
+	read_phy(uint8_t address)
+	{
+		reg_write<ENC28J60_REG_MIREGADR>(address);
+		reg_write<ENC28J60_REG_MICMD>(ENC28J60_MIIRD);
+		wait_phy();
+		reg_write<ENC28J60_REG_MICMD>(0);
+
+		return reg_read<ENC28J60_REG_MIRD>();
+	}
+
+	void
+	write_phy(uint8_t address, uint16_t data)
+	{
+		reg_write<ENC28J60_REG_MIREGADR>(address);
+		reg_write<ENC28J60_REG_MIWR>(data);
+		wait_phy();
+	}
+
+	/* Read a register described by a register descriptor (ENC28J60_REG_*), see enc28j60_reg_read. */
+	template <enc28j60_reg_t Reg>
+	uint16_t
+	reg_read()
+	{
+		constexpr size_t len = (Reg & ENC28J60_REGF_MAC) ? 2 : 1;
+		uint8_t data[2];
+
+		typename Lock::Guard guard;
+		select_bank(ENC28J60_REG_BANK(Reg));
+		read(ENC28J60_RCR | ENC28J60_REG_ADDRESS(Reg), data, len);
+		uint16_t value = data[len - 1];
+		if (Reg & ENC28J60_REGF_16) {
+			read(ENC28J60_RCR | (ENC28J60_REG_ADDRESS(Reg) + 1), data, len);
+			value |= data[len - 1] << 8;
+		}
+
+		return value;
+	}
+
+	/* Write a register described by a register descriptor (ENC28J60_REG_*), see enc28j60_reg_write. */
+	template <enc28j60_reg_t Reg>
+	void
+	reg_write(uint16_t value)
+	{
+		typename Lock::Guard guard;
+		select_bank(ENC28J60_REG_BANK(Reg));
+		command2(ENC28J60_WCR | ENC28J60_REG_ADDRESS(Reg), value & 0xFF);
+		if (Reg & ENC28J60_REGF_16) {
+			command2(ENC28J60_WCR | (ENC28J60_REG_ADDRESS(Reg) + 1), value >> 8);
+		}
+	}
+
+	/* Set bits of an ETH register. */
+	template <enc28j60_reg_t Reg>
+	void
+	reg_set(uint8_t mask)
+	{
+		static_assert(!(Reg & ENC28J60_REGF_MAC), "BFS is not supported on MAC and MII registers");
+		typename Lock::Guard guard;
+		select_bank(ENC28J60_REG_BANK(Reg));
+		command2(ENC28J60_BFS | ENC28J60_REG_ADDRESS(Reg), mask);
+	}
+
+	/* Clear bits of an ETH register. */
+	template <enc28j60_reg_t Reg>
+	void
+	reg_clear(uint8_t mask)
+	{
+		static_assert(!(Reg & ENC28J60_REGF_MAC), "BFC is not supported on MAC and MII registers");
+		typename Lock::Guard guard;
+		select_bank(ENC28J60_REG_BANK(Reg));
+		command2(ENC28J60_BFC | ENC28J60_REG_ADDRESS(Reg), mask);
+	}
+
+private:
+
+	uint8_t bank = ENC28J60_BANK_ANY;
+	uint16_t tx_end = Config::rx_buffer_size;
+
+	static void
+	command(uint8_t instruction, const uint8_t *data, size_t len)
+	{
+		Cs::select();
+		Spi::transfer(&instruction, nullptr, 1);
+		Spi::transfer(data, nullptr, len);
+		Cs::deselect();
+	}
+
+	static void
+	command2(uint8_t instruction, uint8_t argument)
+	{
+		const uint8_t data[2] = { instruction, argument };
+		Cs::select();
+		Spi::transfer(data, nullptr, 2);
+		Cs::deselect();
+	}
+
+	static void
+	read(uint8_t instruction, uint8_t *data, size_t len)
+	{
+		Cs::select();
+		Spi::transfer(&instruction, nullptr, 1);
+		Spi::transfer(nullptr, data, len);
+		Cs::deselect();
+	}
+
+	static void
+	locked_command(uint8_t instruction, const uint8_t *data, size_t len)
+	{
+		typename Lock::Guard guard;
+		command(instruction, data, len);
+	}
+
+	static void
+	locked_read(uint8_t instruction, uint8_t *data, size_t len)
+	{
+		typename Lock::Guard guard;
+		read(instruction, data, len);
+	}
+
+	/* Call with the lock held. */
+	void
+	select_bank(uint8_t target)
+	{
+		if (target == ENC28J60_BANK_ANY || target == bank) {
+			return;
+		}
+
+		command2(ENC28J60_BFC | ENC28J60_ECON1, 0x03);
+		if (target) {
+			command2(ENC28J60_BFS | ENC28J60_ECON1, target);
+		}
+		bank = target;
+	}
+
+	void
+	wait_phy()
+	{
+		Config::delay_us(11); /* MISTAT.BUSY is set 10.24 us after the command */
+		while (reg_read<ENC28J60_REG_MISTAT>() & ENC28J60_BUSY) {
+			Config::delay_us(1);
+		}
+	}
+
+};
+
+/* Lock policy for single-context use (no ISR or second core touching the device). */
+struct NoLock {
+	struct Guard {
+		Guard() {}
+	};
+};
+
+/* Chip select policy for transports that time the chip select themselves. */
+struct NoCs {
+	static void select() {}
+	static void deselect() {}
+};
+
+/* Config policy with the same buffer partition as the C driver and a caller supplied delay. */
+template <uint16_t RxBufferSize, void (*Delay)(uint32_t)>
+struct BufferPartition {
+	static constexpr uint16_t rx_buffer_size = RxBufferSize;
+
+	static void
+	delay_us(uint32_t us)
+	{
+		Delay(us);
+	}
+};
+
+} // namespace enc28j60
+} // namespace pico
+
+#endif
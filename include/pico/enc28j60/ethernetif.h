@@ -1,7 +1,74 @@
 #ifndef ENC28J60_ETHERNETIF_H
 #define ENC28J60_ETHERNETIF_H
 
+#include <stdbool.h>
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#define ETHERNETIF_TX_CLASSES 4  /* Transmit classes, see ethernetif_tx_classify */
+#define ETHERNETIF_TX_QUEUE_DEPTH 8  /* Packets queued per class */
+#define ETHERNETIF_TX_SMALL 128  /* Packets up to this length are latency sensitive */
+#define ETHERNETIF_TX_QUANTUM 1514  /* Default bytes per round of a weighted class */
+
+/* Transmit class. */
+struct ethernetif_tx_class {
+
+	/* Served before all weighted classes, in class order. */
+	u8_t strict;
+
+	/* Bytes per round of a weighted class, 0 for ETHERNETIF_TX_QUANTUM. */
+	u16_t quantum;
+
+	/* Counters: packets queued, sent and dropped because the queue was full. */
+	u32_t enqueued;
+	u32_t sent;
+	u32_t dropped;
+
+	/* Current and largest queue depth. */
+	u8_t depth;
+	u8_t max_depth;
+
+	/* Total and largest time packets spent queued, in microseconds. */
+	u32_t latency_us;
+	u32_t max_latency_us;
+
+	/* Queue and deficit. Managed by the library. */
+	struct pbuf *queue[ETHERNETIF_TX_QUEUE_DEPTH];
+	u32_t stamps[ETHERNETIF_TX_QUEUE_DEPTH];
+	u8_t head;
+	u32_t deficit;
+
+};
+
+/*
+ * Transmit scheduler.
+ * When set as tx_scheduler of the instance, packets are queued per class instead of being transmitted in call
+ * order, so small latency-sensitive packets overtake queued bulk traffic. Strict priority classes are always served
+ * first, the remaining classes share the link by deficit round robin according to their quantum.
+ */
+struct ethernetif_tx_scheduler {
+
+	struct ethernetif_tx_class classes[ETHERNETIF_TX_CLASSES];
+
+	/* Packet classifier, NULL for ethernetif_tx_classify. */
+	u8_t (*classify)(struct netif *netif, struct pbuf *p);
+
+	/* Weighted class served in the current round. Managed by the library. */
+	u8_t current;
+
+};
+
 err_t ethernetif_init(struct netif *netif);
+void ethernetif_transmit(struct netif *netif, struct pbuf *p, bool wait);
 struct pbuf *low_level_input(const struct netif *netif);
+struct pbuf *low_level_read(const struct netif *netif, u16_t len);
+struct pbuf *ethernetif_hold(struct pbuf *p);
+err_t ethernetif_resolve(struct netif *netif, const ip4_addr_t *ipaddr, u8_t *mac_address);
+
+/* Set classes 0 and 1 to strict priority and classes 2 and 3 to weighted 3:1. */
+void ethernetif_tx_scheduler_init(struct ethernetif_tx_scheduler *scheduler);
+u8_t ethernetif_tx_classify(struct netif *netif, struct pbuf *p);
+void ethernetif_tx_poll(struct netif *netif);
 
 #endif
@@ -0,0 +1,84 @@
+#ifndef ENC28J60_ETHERNETIF_RTOS_H
+#define ENC28J60_ETHERNETIF_RTOS_H
+
+#include <stdbool.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <task.h>
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#define ETHERNETIF_RTOS_RX_BATCH 8  /* Default frames handed to the TCP/IP thread per batch */
+#define ETHERNETIF_RTOS_TX_QUEUE 16  /* Default transmit queue length */
+#define ETHERNETIF_RTOS_STACK 1024  /* Default stack size of the driver task, in words */
+
+/*
+ * Driver task for lwIP with NO_SYS 0 on FreeRTOS.
+ * The INT pin only notifies the task, all SPI traffic and pbuf handling happens in the task. Received frames are
+ * passed to the TCP/IP thread in batches, outgoing packets are queued by the TCP/IP thread and written to the
+ * ENC28J60 by the task, so the chip is only ever accessed from one context and needs no critical section.
+ */
+struct ethernetif_rtos {
+
+	/* GPIO connected to the INT pin of the instance. */
+	uint8_t int_pin;
+
+	/* Priority of the driver task, 0 for configMAX_PRIORITIES - 1. */
+	UBaseType_t priority;
+
+	/*
+	 * Cores the driver task may run on, as a mask (bit 0 for core 0), 0 for no restriction.
+	 * Ignored unless configUSE_CORE_AFFINITY is enabled. The INT pin is routed to the core calling
+	 * ethernetif_rtos_start.
+	 */
+	UBaseType_t core_affinity;
+
+	/* Stack size of the driver task in words, 0 for ETHERNETIF_RTOS_STACK. */
+	configSTACK_DEPTH_TYPE stack_size;
+
+	/*
+	 * Most frames read per batch, 0 for ETHERNETIF_RTOS_RX_BATCH.
+	 * A batch costs one message to the TCP/IP thread. Frames beyond two batches waiting for the TCP/IP thread stay
+	 * in the receive buffer of the ENC28J60.
+	 */
+	u8_t rx_batch;
+
+	/* Transmit queue length, 0 for ETHERNETIF_RTOS_TX_QUEUE. */
+	UBaseType_t tx_queue_length;
+
+	/*
+	 * Block the caller of linkoutput until the packet is transmitted.
+	 * The driver task signals completion by a notification with index tx_notify_index, which needs
+	 * configTASK_NOTIFICATION_ARRAY_ENTRIES > tx_notify_index. Otherwise output returns as soon as the packet is
+	 * queued.
+	 */
+	u8_t tx_wait;
+	UBaseType_t tx_notify_index;
+
+	/* Counters: frames received, batches passed to the TCP/IP thread, packets sent and dropped on a full queue. */
+	u32_t rx_frames;
+	u32_t rx_batches;
+	u32_t tx_packets;
+	u32_t tx_dropped;
+
+	/* Managed by the library. */
+	struct netif *netif;
+	TaskHandle_t task;
+	QueueHandle_t tx_queue;
+	QueueHandle_t rx_queue;
+	struct tcpip_callback_msg *rx_message;
+	bool rx_posted;
+
+};
+
+/*
+ * Start the driver task of an interface.
+ * Add the interface first with netif_add(netif, ..., &enc28j60, ethernetif_init, tcpip_input), the ENC28J60
+ * interrupts are set up by this function.
+ * \return false if the task or the queue could not be allocated, or the INT pin could not be routed
+ */
+bool ethernetif_rtos_start(struct ethernetif_rtos *rtos, struct netif *netif);
+
+#endif
@@ -0,0 +1,60 @@
+#ifndef ENC28J60_GRO_H
+#define ENC28J60_GRO_H
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#define ETHERNETIF_GRO_FLOWS 4  /* TCP flows coalesced at once */
+
+/* TCP flow being coalesced. Managed by the library. */
+struct ethernetif_gro_flow {
+	struct pbuf *p;  /* First segment, with the payload of the following ones chained to it */
+	u8_t addresses[8];  /* Source and destination IPv4 address */
+	u16_t ports[2];
+	u32_t next_seq;
+	u16_t mss;  /* Payload of the first segment, only the last segment may be shorter */
+	u16_t payload_len;
+	u32_t payload_sum;  /* Ones' complement sum of the coalesced payload */
+	u8_t segments;
+	u8_t flags;
+};
+
+/*
+ * Receive segment coalescing.
+ * In-order TCP segments of the same flow, received in one batch, are merged into a single pbuf chain with corrected
+ * IPv4 and TCP headers before they reach netif->input, so lwIP processes and acknowledges one segment instead of
+ * several. Only plain data segments are merged: IPv4 without options or fragmentation, ACK with or without PSH and
+ * the same acknowledgement, window and TCP options as the segment before. Anything else is passed through
+ * unchanged, after the segments held for coalescing so the order of a flow is kept.
+ * The TCP checksum of a merged segment is derived from the checksums of its parts, without reading the payload.
+ * lwIP still verifies it, so a corrupted part makes it drop the whole merged segment.
+ */
+struct ethernetif_gro {
+
+	/* Most segments merged into one, 0 for 8. */
+	u8_t max_segments;
+
+	/* Counters: packets received, packets handed to lwIP, segments merged into a previous one and packets passed
+	 * through. The merge ratio is received / delivered. */
+	u32_t received;
+	u32_t delivered;
+	u32_t merged;
+	u32_t passed;
+
+	/* Flows being coalesced. Managed by the library. */
+	struct ethernetif_gro_flow flows[ETHERNETIF_GRO_FLOWS];
+	u8_t victim;
+
+};
+
+/*
+ * Receive a frame, instead of calling netif->input.
+ * Frames may be held until ethernetif_gro_flush.
+ * \param p received frame, for example from low_level_input
+ */
+void ethernetif_gro_input(struct ethernetif_gro *gro, struct netif *netif, struct pbuf *p);
+
+/* Hand all held segments to netif->input. Call at the end of every receive batch. */
+void ethernetif_gro_flush(struct ethernetif_gro *gro, struct netif *netif);
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef ENC28J60_IRQ_H
+#define ENC28J60_IRQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ENC28J60_IRQ_MAX_INSTANCES 4  /* Maximum number of instances routed by the dispatcher */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Interrupt handler of an instance.
+ * Called from the GPIO interrupt on a falling edge of the INT pin of the instance.
+ * \param context pointer passed to enc28j60_irq_add, for example the netif of the instance
+ */
+typedef void (*enc28j60_irq_handler_t)(struct enc28j60 *self, void *context);
+
+/*
+ * Route the INT pin of an instance to a handler.
+ * The Pico SDK has a single GPIO interrupt callback per core, the dispatcher installs it on the calling core and
+ * looks up the instance by pin, so several ENC28J60 can share it. Call from the core that should handle the
+ * interrupts. The pin MUST be configured as input before calling this.
+ * \param int_pin GPIO connected to the INT pin of the instance
+ * \return false if ENC28J60_IRQ_MAX_INSTANCES pins are routed already, true otherwise
+ */
+bool enc28j60_irq_add(struct enc28j60 *self, uint8_t int_pin, enc28j60_irq_handler_t handler, void *context);
+
+/* Disable the interrupt of an instance and remove it from the dispatcher. */
+void enc28j60_irq_remove(struct enc28j60 *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef ENC28J60_MODERATION_H
+#define ENC28J60_MODERATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <pico/time.h>
+
+#include <pico/enc28j60/irq.h>
+
+/* Reception modes */
+#define ENC28J60_MODERATION_INTERRUPT 0  /* PKTIE enabled, frames are served from the INT pin interrupt */
+#define ENC28J60_MODERATION_POLL 1  /* PKTIE disabled, EPKTCNT is polled from a repeating timer */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Adaptive interrupt moderation.
+ * At low packet rates every frame raises an interrupt, for the lowest latency. Above poll_rate the PKTIE interrupt
+ * is disabled and pending frames are served from a repeating timer every poll_interval_us instead, so a flood of
+ * small frames costs one EPKTCNT read per interval rather than a full interrupt sequence per frame. Below
+ * interrupt_rate the interrupt is enabled again.
+ */
+struct enc28j60_moderation {
+
+	/* Instance to moderate. */
+	struct enc28j60 *eth;
+
+	/* Packets per second to switch to polling at, 0 for 5000. */
+	uint32_t poll_rate;
+
+	/* Packets per second to switch back to interrupts at, 0 for poll_rate / 4. */
+	uint32_t interrupt_rate;
+
+	/* Polling interval in microseconds, 0 for 500. */
+	uint32_t poll_interval_us;
+
+	/* Rate measurement window in microseconds, 0 for 10000. */
+	uint32_t window_us;
+
+	/* Current mode, ENC28J60_MODERATION_INTERRUPT or ENC28J60_MODERATION_POLL. */
+	uint8_t mode;
+
+	/* Counters: mode switches and packet rate of the last window. */
+	uint32_t switches;
+	uint32_t rate;
+
+	/* Managed by the library. */
+	enc28j60_irq_handler_t handler;
+	void *context;
+	uint32_t window_start;
+	uint32_t window_packets;
+	repeating_timer_t timer;
+	volatile bool polling;
+
+};
+
+/*
+ * Start in interrupt mode.
+ * In poll mode handler is called from the timer once per pending frame, with one EPKTCNT read per interval and no
+ * enc28j60_isr_begin or enc28j60_isr_end around it, and the frames are accounted for by the library. The INT pin
+ * interrupt handler (see enc28j60_irq_add) keeps the interrupt sequence, calls the same handler on PKTIF and calls
+ * enc28j60_moderation_account. Call from the core handling the INT pin interrupt.
+ * \param handler reads one frame and does nothing else, MUST NOT call enc28j60_moderation_account
+ */
+void enc28j60_moderation_start(struct enc28j60_moderation *moderation, enc28j60_irq_handler_t handler,
+		void *context);
+
+/*
+ * Account for received frames and switch the mode if the rate crossed a threshold.
+ * \param frames frames read by the handler
+ */
+void enc28j60_moderation_account(struct enc28j60_moderation *moderation, uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef ENC28J60_OFFLOAD_H
+#define ENC28J60_OFFLOAD_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ENC28J60_OFFLOAD_ADDRESSES 4  /* Maximum number of local IPv4 addresses */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * ARP and ICMP echo responder.
+ * Answers ARP requests for the local addresses and ICMP echo requests to them inside the driver, so health-check
+ * traffic never reaches lwIP. An echo reply is assembled in the chip SRAM: the request is copied from the receive
+ * buffer to the transmit buffer by the DMA copy engine and only addresses, type and checksum are patched over SPI,
+ * so the echo payload never crosses SPI.
+ */
+struct enc28j60_offload {
+
+	/* Local IPv4 addresses, in network byte order. */
+	uint8_t ip_addresses[ENC28J60_OFFLOAD_ADDRESSES][4];
+	uint8_t ip_address_count;
+
+	/* Answer ARP requests. */
+	bool arp;
+
+	/* Answer ICMP echo requests. */
+	bool icmp;
+
+	/* Replies sent. */
+	uint32_t arp_replies;
+	uint32_t echo_replies;
+
+};
+
+/*
+ * Start receiving the next frame and answer it if it is an ARP or ICMP echo request for a local address.
+ * Call instead of enc28j60_receive_init. Answered frames are acknowledged right away. Other frames are left pending
+ * with the read position at their start, so they can be read with enc28j60_receive_read (for example by
+ * low_level_read) and MUST then be acknowledged with enc28j60_receive_ack.
+ * Answered ARP requests do not reach lwIP, so the ARP cache does not learn the requesters. Requests arriving while
+ * the transmit buffer is held (see enc28j60_buffer_held) are delivered locally instead of being answered.
+ * \return length of the frame if it has to be delivered locally, 0 if it was answered or received with an error
+ */
+uint16_t enc28j60_offload_input(struct enc28j60_offload *offload, struct enc28j60 *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
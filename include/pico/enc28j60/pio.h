@@ -0,0 +1,63 @@
+#ifndef ENC28J60_PIO_H
+#define ENC28J60_PIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <hardware/pio.h>
+
+#define ENC28J60_PIO_MAX_BAUDRATE 20000000  /* Highest SPI clock, the chip select timing of the program relies on it */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * PIO based SPI transport.
+ * A PIO state machine drives SCK, MOSI, MISO and CS, so the hardware SPI blocks stay free for other peripherals.
+ * Opcode and data of a command are clocked out as one stream and back-to-back commands (BFS, BFC, WCR sequences)
+ * are executed without CPU intervention between them.
+ */
+struct enc28j60_pio {
+
+	/* PIO block running the program (pio0 or pio1). */
+	PIO pio;
+
+	/* State machine index. Managed by the library. */
+	uint sm;
+
+	/* Offset of the loaded program, shared by the instances on the same PIO block. Managed by the library. */
+	uint offset;
+
+};
+
+/*
+ * Load the program, unless an instance on the same PIO block did, claim a state machine and configure the pins.
+ * The pins MUST NOT be configured as SPI function or as GPIO output, the state machine takes them over.
+ * \param pio PIO block to use (pio0 or pio1)
+ * \param baudrate SPI clock frequency in Hz, capped at ENC28J60_PIO_MAX_BAUDRATE
+ * \return false if there is no free state machine or no space for the program, true otherwise
+ */
+bool enc28j60_pio_init(struct enc28j60_pio *self, PIO pio, uint sck_pin, uint mosi_pin, uint miso_pin, uint cs_pin,
+		uint32_t baudrate);
+
+/*
+ * Execute a single command in one chip select cycle.
+ * Sends the instruction and tx_len bytes from tx, then reads rx_len bytes into rx.
+ */
+void enc28j60_pio_command(const struct enc28j60_pio *self, uint8_t instruction, const uint8_t *tx, size_t tx_len,
+		uint8_t *rx, size_t rx_len);
+
+/*
+ * Execute a sequence of two byte commands (instruction, argument) back-to-back.
+ * Chip select is toggled by the state machine between the commands.
+ * \param commands array of count { instruction, argument } pairs
+ */
+void enc28j60_pio_commands(const struct enc28j60_pio *self, const uint8_t (*commands)[2], size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
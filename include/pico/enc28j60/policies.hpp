@@ -0,0 +1,110 @@
+#ifndef ENC28J60_POLICIES_HPP
+#define ENC28J60_POLICIES_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+#include <hardware/sync.h>
+#include <pico/critical_section.h>
+#include <pico/time.h>
+
+#include <pico/enc28j60/enc28j60.hpp>
+
+/* RP2040 policies for pico::enc28j60::Enc28j60, see pico/enc28j60/enc28j60.hpp. */
+
+namespace pico {
+namespace enc28j60 {
+
+/*
+ * Hardware SPI block (0 for spi0, 1 for spi1) driven through its FIFOs directly.
+ * The bus MUST be initialized with spi_init and gpio_set_function before use.
+ */
+template <unsigned Index>
+struct HardwareSpi {
+	static_assert(Index < 2, "RP2040 has spi0 and spi1");
+
+	static spi_inst_t *
+	instance()
+	{
+		return Index ? spi1 : spi0;
+	}
+
+	static void
+	transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+	{
+		constexpr size_t fifo_depth = 8;
+		spi_hw_t *hw = spi_get_hw(instance());
+		size_t tx_remaining = len;
+		size_t rx_remaining = len;
+
+		while (tx_remaining || rx_remaining) {
+			if (tx_remaining && spi_is_writable(instance()) && rx_remaining < tx_remaining + fifo_depth) {
+				hw->dr = tx != nullptr ? tx[len - tx_remaining] : 0;
+				tx_remaining--;
+			}
+			if (rx_remaining && spi_is_readable(instance())) {
+				uint8_t byte = (uint8_t) hw->dr;
+				if (rx != nullptr) {
+					rx[len - rx_remaining] = byte;
+				}
+				rx_remaining--;
+			}
+		}
+	}
+};
+
+/*
+ * Chip select on a GPIO pin.
+ * The pin MUST be configured as output before use (gpio_init and gpio_set_dir).
+ */
+template <unsigned Pin>
+struct GpioCs {
+	static void select() { gpio_put(Pin, 0); }
+	static void deselect() { gpio_put(Pin, 1); }
+};
+
+/*
+ * Lock on a critical section, for use from an ISR or both cores.
+ * The critical section MUST be initialized with critical_section_init before use.
+ */
+template <critical_section_t *Section>
+struct CriticalSectionLock {
+	struct Guard {
+		Guard() { critical_section_enter_blocking(Section); }
+		~Guard() { critical_section_exit(Section); }
+		Guard(const Guard &) = delete;
+		Guard &operator=(const Guard &) = delete;
+	};
+};
+
+/*
+ * Lock on a hardware spin lock with interrupts disabled on the calling core.
+ * Claim the spin lock number with spin_lock_claim or spin_lock_claim_unused.
+ */
+template <unsigned Num>
+struct SpinLock {
+	struct Guard {
+		uint32_t saved_irq;
+		Guard() { saved_irq = spin_lock_blocking(spin_lock_instance(Num)); }
+		~Guard() { spin_unlock(spin_lock_instance(Num), saved_irq); }
+		Guard(const Guard &) = delete;
+		Guard &operator=(const Guard &) = delete;
+	};
+};
+
+inline void
+sleep_us32(uint32_t us)
+{
+	sleep_us(us);
+}
+
+/* Buffer partition with a receive buffer of RxBufferSize bytes (6666 in the C driver), delays with sleep_us. */
+template <uint16_t RxBufferSize = 6666>
+using PicoBufferPartition = BufferPartition<RxBufferSize, sleep_us32>;
+
+} // namespace enc28j60
+} // namespace pico
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef ENC28J60_POWER_H
+#define ENC28J60_POWER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Wake-up filters */
+#define ENC28J60_WAKE_UNICAST 0x01  /* Any frame to the MAC address of the instance */
+#define ENC28J60_WAKE_MAGIC 0x02  /* Magic Packet for the MAC address of the instance */
+#define ENC28J60_WAKE_PATTERN 0x04  /* Frames matching the pattern set with enc28j60_wake_pattern */
+#define ENC28J60_WAKE_BROADCAST 0x08  /* Broadcast frames, for example ARP requests */
+
+#define ENC28J60_PATTERN_SIZE 64  /* Pattern match window */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Power management.
+ * enc28j60_power_idle restricts reception to the wake-up filters and puts the RP2040 into dormant mode until the
+ * INT pin signals a received frame. The ENC28J60 keeps receiving meanwhile, so the frame which woke the MCU is in
+ * the receive buffer on resume and is not lost.
+ */
+struct enc28j60_power {
+
+	/* Instance to wait on. */
+	struct enc28j60 *eth;
+
+	/* GPIO connected to the INT pin of the instance. */
+	uint8_t int_pin;
+
+	/* Mask built from ENC28J60_WAKE_*. */
+	uint8_t filters;
+
+	/* Counters: times the MCU went dormant. */
+	uint32_t sleeps;
+
+	/*
+	 * Time from resuming until the first frame was received, in microseconds, see enc28j60_power_received.
+	 * The oscillator start-up before the timer runs again is not included.
+	 */
+	uint32_t last_resume_us;
+	uint32_t max_resume_us;
+
+	uint32_t resumed_us;
+	bool resuming;
+
+};
+
+/*
+ * Set the pattern for ENC28J60_WAKE_PATTERN.
+ * \param offset position of the pattern window in the frame, must be even
+ * \param pattern ENC28J60_PATTERN_SIZE bytes, only the bytes selected by mask are compared
+ * \param mask 8 bytes, bit n of byte k selects byte 8 * k + n of the window
+ */
+void enc28j60_wake_pattern(struct enc28j60 *self, uint16_t offset, const uint8_t *pattern, const uint8_t *mask);
+
+/*
+ * Restrict reception to frames passing any of the filters.
+ * \param filters mask built from ENC28J60_WAKE_*, 0 to receive all frames again
+ */
+void enc28j60_wake_filters(struct enc28j60 *self, uint8_t filters);
+
+/*
+ * Sleep until a frame passing the wake-up filters is received.
+ * Returns right away if frames are pending already. The interrupts of the instance are set to PKTIE for the time of
+ * sleeping and restored afterwards, reception is unfiltered again on return. The system clock is restored by
+ * sleep_power_up, so timeouts based on the system timer lose the dormant time.
+ */
+void enc28j60_power_idle(struct enc28j60_power *power);
+
+/*
+ * Record the wake-up latency in last_resume_us and max_resume_us.
+ * Call once the first frame after enc28j60_power_idle has been received, for example after enc28j60_receive_init or
+ * low_level_input. Does nothing if enc28j60_power_idle returned without sleeping or the latency is recorded already.
+ */
+void enc28j60_power_received(struct enc28j60_power *power);
+
+/*
+ * Enter the power save mode of the IC.
+ * Reception is disabled, so frames arriving in power save mode are lost. Use between bursts of traffic whose
+ * timing is known to the application, not to wait for frames.
+ */
+void enc28j60_power_down(struct enc28j60 *self);
+
+/* Leave the power save mode, wait for the oscillator and enable reception. */
+void enc28j60_power_up(struct enc28j60 *self);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef ENC28J60_SRAM_H
+#define ENC28J60_SRAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENC28J60_SRAM_BLOCKS 16  /* Maximum number of free and allocated blocks */
+#define ENC28J60_SRAM_NONE 0xFFFF  /* Returned when an allocation fails */
+#define ENC28J60_SRAM_END 0x2000  /* End of the chip SRAM */
+#define ENC28J60_TX_SPACE (1 + 1518 + 7)  /* Transmit buffer: control byte, largest (tagged) frame and status vector */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Block of chip SRAM. Managed by the library. */
+struct enc28j60_sram_block {
+	uint16_t start;
+	uint16_t len;
+	bool used;
+};
+
+/*
+ * Allocator of spare chip SRAM.
+ * Manages a region of the 8 KB ENC28J60 buffer memory outside the receive and transmit buffers. The bookkeeping is
+ * kept in MCU RAM, the blocks themselves are read and written over SPI or copied on the chip by its DMA copy engine.
+ */
+struct enc28j60_sram {
+
+	/* Instance owning the memory. */
+	struct enc28j60 *eth;
+
+	/* Blocks sorted by address, covering the whole region. Managed by the library. */
+	struct enc28j60_sram_block blocks[ENC28J60_SRAM_BLOCKS];
+	uint8_t count;
+
+	/* Bytes currently allocated. */
+	uint16_t allocated;
+
+};
+
+/*
+ * Manage the chip SRAM from start to end.
+ * The spare memory of an instance starts at enc28j60_rx_buffer_size + ENC28J60_TX_SPACE, so give the instance a
+ * smaller rx_buffer_size to make room. Leave out ENC28J60_UDP_STREAM_TEMPLATE and above if a UDP stream is used.
+ */
+void enc28j60_sram_init(struct enc28j60_sram *sram, struct enc28j60 *eth, uint16_t start, uint16_t end);
+
+/*
+ * Allocate a block (first fit).
+ * \return chip SRAM address of the block, ENC28J60_SRAM_NONE if there is no free block large enough
+ */
+uint16_t enc28j60_sram_alloc(struct enc28j60_sram *sram, uint16_t len);
+
+/* Free a block returned from enc28j60_sram_alloc. */
+void enc28j60_sram_free(struct enc28j60_sram *sram, uint16_t address);
+
+/* Write len bytes to the chip SRAM at address. */
+void enc28j60_sram_write(struct enc28j60_sram *sram, uint16_t address, const uint8_t *data, size_t len);
+
+/* Read len bytes from the chip SRAM at address. */
+void enc28j60_sram_read(struct enc28j60_sram *sram, uint16_t address, uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef ENC28J60_TXCACHE_H
+#define ENC28J60_TXCACHE_H
+
+#include <stdint.h>
+
+#include <pico/enc28j60/sram.h>
+
+#define ENC28J60_TXCACHE_ENTRIES 8  /* Maximum number of cached payloads */
+#define ENC28J60_TXCACHE_KEY 16  /* Key: IPv4 addresses, ports and sequence number */
+#define ENC28J60_TXCACHE_CONNECTION 12  /* Leading part of the key: IPv4 addresses and ports */
+#define ENC28J60_TXCACHE_MIN_PAYLOAD 128  /* Smaller payloads are cheaper to rewrite than to copy on the chip */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Cached payload. Managed by the library. */
+struct enc28j60_txcache_entry {
+	uint8_t key[ENC28J60_TXCACHE_KEY];
+	uint16_t len;
+	uint16_t address;  /* Chip SRAM address, ENC28J60_SRAM_NONE if the entry is free */
+	uint32_t stamp;  /* Insertion order, the oldest entry is evicted first */
+};
+
+/*
+ * Retransmit cache.
+ * Keeps the payloads of sent TCP segments in spare chip SRAM, keyed by connection, sequence number and length. A
+ * retransmitted segment carries the same payload, so only its headers are written over SPI and the payload is copied
+ * on the chip by the DMA copy engine. Used by ethernetif when set as tx_cache of the instance.
+ * Payloads are released once the peer acknowledges them, and all payloads of a connection when a SYN or RST is sent or
+ * received on its addresses and ports, so a new connection reusing them never gets stale payloads. ethernetif does
+ * this for the frames it sends and receives.
+ */
+struct enc28j60_txcache {
+
+	/* Allocator providing the chip SRAM. */
+	struct enc28j60_sram *sram;
+
+	/* Counters of retransmissions served from the cache, of stored payloads and of payloads released. */
+	uint32_t hits;
+	uint32_t stores;
+	uint32_t releases;
+
+	struct enc28j60_txcache_entry entries[ENC28J60_TXCACHE_ENTRIES];
+	uint32_t clock;
+
+};
+
+/* Initialize an empty cache. */
+void enc28j60_txcache_init(struct enc28j60_txcache *cache, struct enc28j60_sram *sram);
+
+/*
+ * Find a cached payload.
+ * \return chip SRAM address of the payload, ENC28J60_SRAM_NONE if it is not cached
+ */
+uint16_t enc28j60_txcache_lookup(struct enc28j60_txcache *cache, const uint8_t *key, uint16_t len);
+
+/*
+ * Store a payload, evicting the oldest entries if there is no room.
+ * \param source chip SRAM address of the payload, usually in the transmit buffer after the frame was sent
+ */
+void enc28j60_txcache_store(struct enc28j60_txcache *cache, const uint8_t *key, uint16_t source, uint16_t len);
+
+/*
+ * Release the payloads of a connection acknowledged by the peer.
+ * \param connection first ENC28J60_TXCACHE_CONNECTION bytes of the keys of the connection
+ * \param ack acknowledgment number received from the peer
+ */
+void enc28j60_txcache_ack(struct enc28j60_txcache *cache, const uint8_t *connection, uint32_t ack);
+
+/*
+ * Release all payloads of a connection, for example when it is closed.
+ * \param connection first ENC28J60_TXCACHE_CONNECTION bytes of the keys of the connection
+ */
+void enc28j60_txcache_invalidate(struct enc28j60_txcache *cache, const uint8_t *connection);
+
+/* Release all payloads. */
+void enc28j60_txcache_flush(struct enc28j60_txcache *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
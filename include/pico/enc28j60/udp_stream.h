@@ -0,0 +1,78 @@
+#ifndef ENC28J60_UDP_STREAM_H
+#define ENC28J60_UDP_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ENC28J60_UDP_STREAM_HEADER 42  /* Ethernet, IPv4 and UDP header */
+#define ENC28J60_UDP_STREAM_MAX_PAYLOAD 1472  /* Largest payload of an unfragmented datagram */
+#define ENC28J60_UDP_STREAM_TEMPLATE (0x2000 - ENC28J60_UDP_STREAM_HEADER)  /* Template address in chip SRAM */
+
+struct enc28j60;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * UDP streaming sender.
+ * Sends same-shape IPv4/UDP datagrams to one destination without lwIP. The header is built once and staged as a
+ * template at the end of the chip SRAM. The header in the transmit buffer is reused from the previous datagram, so
+ * only length, identification and checksum fields are patched before the payload is written. If another sender
+ * used the transmit buffer in between, the header is restored from the template by the DMA copy engine of the IC.
+ * The template needs ENC28J60_UDP_STREAM_HEADER bytes above the transmit buffer, which an rx_buffer_size of at most
+ * 6624 leaves. With a larger receive buffer, such as the default, there is no template and the header is restored
+ * over SPI instead, which clocks about 25 more bytes per restore.
+ * Use one stream per instance.
+ */
+struct enc28j60_udp_stream {
+
+	/* Instance sending the datagrams. */
+	struct enc28j60 *eth;
+
+	/*
+	 * Fill in the UDP checksum.
+	 * If set to false, the checksum field is left 0 (no checksum), which IPv4 allows and saves a pass over the payload.
+	 */
+	bool checksum;
+
+	/* Datagrams sent. */
+	uint32_t sent;
+
+	/*
+	 * Header, its template address in chip SRAM (ENC28J60_SRAM_NONE without template), partial checksums, IP
+	 * identification and transmit buffer generation. Managed by the library.
+	 */
+	uint8_t header[ENC28J60_UDP_STREAM_HEADER];
+	uint16_t template_address;
+	uint32_t ip_sum;
+	uint32_t udp_sum;
+	uint16_t id;
+	uint32_t generation;
+
+};
+
+/*
+ * Build the header and stage the template if it fits above the transmit buffer.
+ * The destination MAC address is the one of the destination host, or of the gateway for an off-link destination.
+ * Resolve it once, for example with ethernetif_resolve.
+ * \param addresses in network byte order
+ */
+void enc28j60_udp_stream_init(struct enc28j60_udp_stream *stream, struct enc28j60 *eth,
+		const uint8_t *destination_mac, const uint8_t *source_ip, const uint8_t *destination_ip, uint16_t source_port,
+		uint16_t destination_port);
+
+/*
+ * Send a datagram.
+ * Claims the transmit buffer with enc28j60_transfer_claim and blocks until the frame is transmitted, like
+ * enc28j60_transfer_send.
+ * \param len payload length, at most ENC28J60_UDP_STREAM_MAX_PAYLOAD
+ */
+void enc28j60_udp_stream_send(struct enc28j60_udp_stream *stream, const uint8_t *payload, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ENC28J60_VLAN_H
+#define ENC28J60_VLAN_H
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+
+#define ETHERNETIF_VLAN_PORTS 4  /* Maximum number of VLAN interfaces per ENC28J60 */
+
+/* VLAN interface. */
+struct ethernetif_vlan_port {
+
+	/* VLAN identifier, 1 to 4094. */
+	u16_t vid;
+
+	struct netif *netif;
+
+	/* Counters: frames received and sent. */
+	u32_t rx;
+	u32_t tx;
+
+};
+
+/*
+ * 802.1Q demultiplexer.
+ * Tagged frames are delivered to the interface of their VLAN with the tag stripped, frames sent through a VLAN
+ * interface get the tag inserted on the way into the transmit buffer. The VLAN is decided from the first 16 bytes
+ * of a frame, so frames of unknown VLANs are dropped without reading the rest of them over SPI. Untagged and
+ * priority tagged frames go to the interface of the ENC28J60 itself.
+ * Set as vlan of the instance before adding the interface of the instance, so enc28j60_init configures the padding
+ * and frame length for tagged frames.
+ */
+struct ethernetif_vlan {
+
+	struct ethernetif_vlan_port ports[ETHERNETIF_VLAN_PORTS];
+	u8_t port_count;
+
+	/* Counters: frames dropped because of an unknown VLAN. */
+	u32_t unknown;
+
+};
+
+/*
+ * Register a VLAN interface.
+ * Call before netif_add(netif, ..., &enc28j60, ethernetif_vlan_init, ...).
+ * \return ERR_MEM if ETHERNETIF_VLAN_PORTS interfaces are registered already, ERR_OK otherwise
+ */
+err_t ethernetif_vlan_add(struct ethernetif_vlan *vlan, struct netif *netif, u16_t vid);
+
+/* Initialization function of VLAN interfaces, to be passed to netif_add. */
+err_t ethernetif_vlan_init(struct netif *netif);
+
+/*
+ * Receive the next frame of the instance and find its interface.
+ * Call instead of low_level_input on the interface of the ENC28J60.
+ * \param netif interface of the ENC28J60 (added with ethernetif_init)
+ * \param destination where the interface the frame belongs to will be written to
+ * \return a pbuf with the untagged frame, NULL if it was dropped or on memory error
+ */
+struct pbuf *ethernetif_vlan_input(struct netif *netif, struct netif **destination);
+
+#endif
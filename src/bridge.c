@@ -0,0 +1,200 @@
+#include <string.h>
+
+#include <hardware/timer.h>
+#include <pico/time.h>
+
+#include <pico/enc28j60/bridge.h>
+#include <pico/enc28j60/capture.h>
+#include <pico/enc28j60/enc28j60.h>
+
+#define ENC28J60_BRIDGE_PORT_NONE 0xFF
+
+static inline uint32_t
+enc28j60_bridge_now(void)
+{
+	return to_ms_since_boot(get_absolute_time());
+}
+
+static inline uint32_t
+enc28j60_bridge_hash(const uint8_t *mac_address)
+{
+	/* The vendor part varies little, so hash mostly on the NIC specific bytes */
+	uint32_t hash = mac_address[5] | mac_address[4] << 8 | mac_address[3] << 16;
+
+	hash ^= mac_address[2] ^ mac_address[1] ^ mac_address[0];
+	hash *= 0x9E3779B1;
+
+	return hash >> 24;
+}
+
+static inline int
+enc28j60_bridge_expired(const struct enc28j60_bridge *bridge, const struct enc28j60_bridge_entry *entry,
+		uint32_t now)
+{
+	uint32_t ageing_ms = bridge->ageing_ms ? bridge->ageing_ms : ENC28J60_BRIDGE_AGEING_MS;
+
+	return entry->port == ENC28J60_BRIDGE_PORT_NONE || now - entry->seen > ageing_ms;
+}
+
+/* \return port the address was learned on, ENC28J60_BRIDGE_PORT_NONE if unknown */
+static uint8_t
+enc28j60_bridge_lookup(const struct enc28j60_bridge *bridge, const uint8_t *mac_address, uint32_t now)
+{
+	uint32_t hash = enc28j60_bridge_hash(mac_address);
+
+	for (uint32_t i = 0; i < ENC28J60_BRIDGE_PROBES; i++) {
+		const struct enc28j60_bridge_entry *entry = &bridge->table[(hash + i) % ENC28J60_BRIDGE_TABLE_SIZE];
+		if (!enc28j60_bridge_expired(bridge, entry, now) && !memcmp(entry->mac_address, mac_address, 6)) {
+			return entry->port;
+		}
+	}
+
+	return ENC28J60_BRIDGE_PORT_NONE;
+}
+
+static void
+enc28j60_bridge_learn(struct enc28j60_bridge *bridge, const uint8_t *mac_address, uint8_t port, uint32_t now)
+{
+	uint32_t hash = enc28j60_bridge_hash(mac_address);
+	struct enc28j60_bridge_entry *victim = NULL;
+
+	for (uint32_t i = 0; i < ENC28J60_BRIDGE_PROBES; i++) {
+		struct enc28j60_bridge_entry *entry = &bridge->table[(hash + i) % ENC28J60_BRIDGE_TABLE_SIZE];
+		if (entry->port != ENC28J60_BRIDGE_PORT_NONE && !memcmp(entry->mac_address, mac_address, 6)) {
+			victim = entry;
+			break;
+		}
+
+		/* Prefer free or expired entries, otherwise replace the least recently seen one */
+		if (victim == NULL || enc28j60_bridge_expired(bridge, entry, now)
+				|| (!enc28j60_bridge_expired(bridge, victim, now) && now - entry->seen > now - victim->seen)) {
+			victim = entry;
+		}
+	}
+
+	memcpy(victim->mac_address, mac_address, 6);
+	victim->port = port;
+	victim->seen = now;
+}
+
+/* Start recording a forwarded frame, \return the capture to append it to or NULL. */
+static struct enc28j60_capture *
+enc28j60_bridge_capture(struct enc28j60_capture *capture, const uint8_t *header, uint16_t len, uint64_t now,
+		uint32_t flags)
+{
+	return capture != NULL && enc28j60_capture_begin(capture, header, 14, len, now, flags) ? capture : NULL;
+}
+
+/*
+ * Copy the rest of the frame being received on from to the transmit buffer of to and send it.
+ * The frame is captured on to as sent and, unless it goes to lwIP as well and is captured there, on from as received.
+ * A capture shared by both ports records it once.
+ */
+static void
+enc28j60_bridge_forward(struct enc28j60 *from, struct enc28j60 *to, const uint8_t *header, uint16_t len, bool local)
+{
+	uint8_t bounce[ENC28J60_BRIDGE_BOUNCE_SIZE];
+	uint64_t now = from->capture != NULL || to->capture != NULL ? time_us_64() : 0;
+	struct enc28j60_capture *inbound = local ? NULL
+			: enc28j60_bridge_capture(from->capture, header, len, now, ENC28J60_CAPTURE_INBOUND);
+	struct enc28j60_capture *outbound = to->capture == from->capture ? NULL
+			: enc28j60_bridge_capture(to->capture, header, len, now, ENC28J60_CAPTURE_OUTBOUND);
+
+	if (inbound != NULL) {
+		enc28j60_capture_append(inbound, header, 14);
+	}
+	if (outbound != NULL) {
+		enc28j60_capture_append(outbound, header, 14);
+	}
+
+	enc28j60_transfer_init(to);
+	enc28j60_transfer_write(to, header, 14);
+	for (uint16_t left = len - 14; left;) {
+		uint16_t chunk = left > sizeof(bounce) ? sizeof(bounce) : left;
+		enc28j60_receive_read(from, bounce, chunk);
+		enc28j60_transfer_write(to, bounce, chunk);
+		if (inbound != NULL) {
+			enc28j60_capture_append(inbound, bounce, chunk);
+		}
+		if (outbound != NULL) {
+			enc28j60_capture_append(outbound, bounce, chunk);
+		}
+		left -= chunk;
+	}
+	enc28j60_transfer_send(to);
+
+	if (inbound != NULL) {
+		enc28j60_capture_commit(inbound);
+	}
+	if (outbound != NULL) {
+		enc28j60_capture_commit(outbound);
+	}
+}
+
+void
+enc28j60_bridge_init(struct enc28j60_bridge *bridge)
+{
+	for (size_t i = 0; i < ENC28J60_BRIDGE_TABLE_SIZE; i++) {
+		bridge->table[i].port = ENC28J60_BRIDGE_PORT_NONE;
+	}
+	bridge->forwarded = 0;
+	bridge->flooded = 0;
+	bridge->filtered = 0;
+	bridge->reserved = 0;
+}
+
+uint16_t
+enc28j60_bridge_input(struct enc28j60_bridge *bridge, uint8_t port)
+{
+	struct enc28j60 *self = bridge->ports[port];
+	struct enc28j60 *peer = bridge->ports[!port];
+	uint8_t header[14];
+	uint32_t now = enc28j60_bridge_now();
+
+	uint16_t len = enc28j60_receive_init(self);
+	if (len < sizeof(header)) {
+		enc28j60_receive_ack(self);
+		return 0;
+	}
+	enc28j60_receive_read(self, header, sizeof(header));
+
+	const uint8_t *destination = &header[0];
+	const uint8_t *source = &header[6];
+
+	/* Never learn group addresses */
+	if (!(source[0] & 1)) {
+		enc28j60_bridge_learn(bridge, source, port, now);
+	}
+
+	bool group = destination[0] & 1;
+	bool local = group || !memcmp(destination, self->mac_address, 6) || !memcmp(destination, peer->mac_address, 6);
+
+	/* IEEE 802.1D reserved group addresses 01-80-C2-00-00-00 to 0F (PAUSE, STP, LACP) are never relayed */
+	if (group && !memcmp(destination, (const uint8_t[]) { 0x01, 0x80, 0xC2, 0x00, 0x00 }, 5)
+			&& destination[5] <= 0x0F) {
+		bridge->reserved++;
+	} else if (group) {
+		enc28j60_bridge_forward(self, peer, header, len, true);
+		bridge->flooded++;
+	} else if (!local) {
+		uint8_t destination_port = enc28j60_bridge_lookup(bridge, destination, now);
+		if (destination_port == port) {
+			bridge->filtered++;
+		} else {
+			enc28j60_bridge_forward(self, peer, header, len, false);
+			if (destination_port == ENC28J60_BRIDGE_PORT_NONE) {
+				bridge->flooded++;
+			} else {
+				bridge->forwarded++;
+			}
+		}
+	}
+
+	if (local) {
+		enc28j60_receive_seek(self, 0);
+		return len;
+	}
+
+	enc28j60_receive_ack(self);
+	return 0;
+}
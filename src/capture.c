@@ -0,0 +1,181 @@
+#include <string.h>
+
+#include <pico/enc28j60/capture.h>
+
+#define PCAPNG_SHB 0x0A0D0D0A
+#define PCAPNG_IDB 0x00000001
+#define PCAPNG_EPB 0x00000006
+#define PCAPNG_BYTE_ORDER 0x1A2B3C4D
+#define PCAPNG_LINKTYPE_ETHERNET 1
+#define PCAPNG_IF_TSRESOL 9
+#define PCAPNG_EPB_FLAGS 2
+
+/* Fields narrower than 32 bits, packed into a word so the first one is at the lower address */
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PCAPNG_PAIR(first, second) ((uint32_t) (first) << 16 | (second))
+#define PCAPNG_BYTE(first) ((uint32_t) (first) << 24)
+#else
+#define PCAPNG_PAIR(first, second) ((uint32_t) (second) << 16 | (first))
+#define PCAPNG_BYTE(first) ((uint32_t) (first))
+#endif
+
+#define SHB_LEN 28
+#define IDB_LEN 32  /* With if_tsresol and the end of options */
+#define EPB_HEADER 28
+#define EPB_TRAILER 16  /* epb_flags, end of options and block length */
+
+/* Copy into the ring at a position, wrapping around its end. */
+static void
+enc28j60_capture_put(struct enc28j60_capture *capture, size_t position, const void *data, size_t len)
+{
+	size_t index = position % capture->size;
+	size_t first = capture->size - index < len ? capture->size - index : len;
+
+	memcpy(&capture->buffer[index], data, first);
+	memcpy(capture->buffer, (const uint8_t *) data + first, len - first);
+}
+
+void
+enc28j60_capture_init(struct enc28j60_capture *capture)
+{
+	capture->head = 0;
+	capture->tail = 0;
+	capture->captured = 0;
+	capture->filtered = 0;
+	capture->dropped = 0;
+	capture->producing = false;
+
+	/* Section Header Block, section length unknown */
+	uint32_t shb[SHB_LEN / 4] = {
+		PCAPNG_SHB, SHB_LEN, PCAPNG_BYTE_ORDER, PCAPNG_PAIR(1, 0), 0xFFFFFFFF, 0xFFFFFFFF, SHB_LEN
+	};
+
+	/* Interface Description Block, microsecond timestamps */
+	uint32_t snaplen = capture->snaplen ? capture->snaplen : 0xFFFF;
+	uint32_t idb[IDB_LEN / 4] = {
+		PCAPNG_IDB, IDB_LEN, PCAPNG_PAIR(PCAPNG_LINKTYPE_ETHERNET, 0), snaplen, PCAPNG_PAIR(PCAPNG_IF_TSRESOL, 1),
+		PCAPNG_BYTE(6), 0, IDB_LEN
+	};
+
+	enc28j60_capture_put(capture, 0, shb, SHB_LEN);
+	enc28j60_capture_put(capture, SHB_LEN, idb, IDB_LEN);
+	__atomic_store_n(&capture->head, SHB_LEN + IDB_LEN, __ATOMIC_RELEASE);
+}
+
+static bool
+enc28j60_capture_match(const struct enc28j60_capture *capture, const uint8_t *head, size_t head_len)
+{
+	for (uint8_t i = 0; i < capture->filter_count; i++) {
+		const struct enc28j60_capture_match *match = &capture->filter[i];
+		if (match->offset >= head_len || (head[match->offset] & match->mask) != match->value) {
+			return capture->exclude;
+		}
+	}
+
+	return !capture->exclude;
+}
+
+bool
+enc28j60_capture_begin(struct enc28j60_capture *capture, const uint8_t *head, size_t head_len, size_t len,
+		uint64_t timestamp_us, uint32_t flags)
+{
+	if (!enc28j60_capture_match(capture, head, head_len)) {
+		capture->filtered++;
+		return false;
+	}
+
+	if (__atomic_test_and_set(&capture->producing, __ATOMIC_ACQUIRE)) {
+		/* Another context is capturing a frame */
+		capture->dropped++;
+		return false;
+	}
+
+	uint32_t captured_len = capture->snaplen && len > capture->snaplen ? capture->snaplen : len;
+	uint32_t padding = (4 - captured_len % 4) % 4;
+	uint32_t block_len = EPB_HEADER + captured_len + padding + EPB_TRAILER;
+
+	size_t tail = __atomic_load_n(&capture->tail, __ATOMIC_ACQUIRE);
+	if (capture->head - tail + block_len > capture->size) {
+		capture->dropped++;
+		__atomic_clear(&capture->producing, __ATOMIC_RELEASE);
+		return false;
+	}
+
+	uint32_t header[EPB_HEADER / 4] = {
+		PCAPNG_EPB, block_len, 0, timestamp_us >> 32, timestamp_us & 0xFFFFFFFF, captured_len, len
+	};
+	enc28j60_capture_put(capture, capture->head, header, EPB_HEADER);
+
+	capture->write = capture->head + EPB_HEADER;
+	capture->remaining = captured_len;
+	capture->padding = padding;
+	capture->flags = flags;
+
+	return true;
+}
+
+void
+enc28j60_capture_append(struct enc28j60_capture *capture, const uint8_t *data, size_t len)
+{
+	if (len > capture->remaining) {
+		len = capture->remaining;
+	}
+
+	enc28j60_capture_put(capture, capture->write, data, len);
+	capture->write += len;
+	capture->remaining -= len;
+}
+
+void
+enc28j60_capture_commit(struct enc28j60_capture *capture)
+{
+	static const uint8_t zeros[4];
+
+	/* Frames shorter than announced are filled up */
+	while (capture->remaining) {
+		enc28j60_capture_append(capture, zeros, capture->remaining < 4 ? capture->remaining : 4);
+	}
+	enc28j60_capture_put(capture, capture->write, zeros, capture->padding);
+	capture->write += capture->padding;
+
+	uint32_t block_len = capture->write + EPB_TRAILER - capture->head;
+	uint32_t trailer[EPB_TRAILER / 4] = { PCAPNG_PAIR(PCAPNG_EPB_FLAGS, 4), capture->flags, 0, block_len };
+	enc28j60_capture_put(capture, capture->write, trailer, EPB_TRAILER);
+
+	capture->captured++;
+	__atomic_store_n(&capture->head, capture->write + EPB_TRAILER, __ATOMIC_RELEASE);
+	__atomic_clear(&capture->producing, __ATOMIC_RELEASE);
+}
+
+bool
+enc28j60_capture_frame(struct enc28j60_capture *capture, const uint8_t *data, size_t len, uint64_t timestamp_us,
+		uint32_t flags)
+{
+	if (!enc28j60_capture_begin(capture, data, len, len, timestamp_us, flags)) {
+		return false;
+	}
+
+	enc28j60_capture_append(capture, data, len);
+	enc28j60_capture_commit(capture);
+
+	return true;
+}
+
+size_t
+enc28j60_capture_read(struct enc28j60_capture *capture, uint8_t *data, size_t len)
+{
+	size_t head = __atomic_load_n(&capture->head, __ATOMIC_ACQUIRE);
+	size_t available = head - capture->tail;
+	if (len > available) {
+		len = available;
+	}
+
+	size_t index = capture->tail % capture->size;
+	size_t first = capture->size - index < len ? capture->size - index : len;
+	memcpy(data, &capture->buffer[index], first);
+	memcpy(data + first, capture->buffer, len - first);
+
+	__atomic_store_n(&capture->tail, capture->tail + len, __ATOMIC_RELEASE);
+
+	return len;
+}
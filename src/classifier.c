@@ -0,0 +1,227 @@
+#include <string.h>
+
+#include <pico/enc28j60/classifier.h>
+#include <pico/enc28j60/enc28j60.h>
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_ARP 0x0806
+#define IP_PROTOCOL_TCP 6
+#define IP_PROTOCOL_UDP 17
+
+/* Indices of by_destination */
+enum {
+	DESTINATION_UNICAST,
+	DESTINATION_OTHER,
+	DESTINATION_BROADCAST,
+	DESTINATION_MULTICAST,
+};
+
+/* Frame fields needed by the rules, parsed once per frame */
+struct enc28j60_classifier_frame {
+	const uint8_t *data;
+	size_t peeked;
+	uint16_t len;
+	uint16_t ethertype;
+	bool ipv4;
+	int port;  /* Destination port, -1 if not read yet */
+};
+
+bool
+enc28j60_classifier_compile(struct enc28j60_classifier *classifier, const struct enc28j60_rule *rules,
+		size_t count)
+{
+	if (count > ENC28J60_CLASSIFIER_RULES) {
+		return false;
+	}
+
+	memset(classifier->by_destination, 0, sizeof(classifier->by_destination));
+	memset(classifier->by_ethertype, 0, sizeof(classifier->by_ethertype));
+	memset(classifier->by_ip_protocol, 0, sizeof(classifier->by_ip_protocol));
+	classifier->any_ethertype = 0;
+	classifier->any_ip_protocol = 0;
+	classifier->ethertype_count = 0;
+	classifier->ip_protocol_count = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		const struct enc28j60_rule *rule = &rules[i];
+		uint32_t bit = 1u << i;
+
+		classifier->rules[i] = *rule;
+
+		uint8_t destinations = rule->match & 0x0F;
+		if (!destinations) {
+			destinations = 0x0F;
+		}
+		for (size_t j = 0; j < 4; j++) {
+			if (destinations & (1 << j)) {
+				classifier->by_destination[j] |= bit;
+			}
+		}
+
+		if (rule->match & ENC28J60_MATCH_ETHERTYPE) {
+			size_t j = 0;
+			while (j < classifier->ethertype_count && classifier->ethertypes[j] != rule->ethertype) {
+				j++;
+			}
+			if (j == ENC28J60_CLASSIFIER_KEYS) {
+				return false;
+			}
+			if (j == classifier->ethertype_count) {
+				classifier->ethertypes[classifier->ethertype_count++] = rule->ethertype;
+			}
+			classifier->by_ethertype[j] |= bit;
+		} else {
+			classifier->any_ethertype |= bit;
+		}
+
+		if (rule->match & ENC28J60_MATCH_IP_PROTOCOL) {
+			size_t j = 0;
+			while (j < classifier->ip_protocol_count && classifier->ip_protocols[j] != rule->ip_protocol) {
+				j++;
+			}
+			if (j == ENC28J60_CLASSIFIER_KEYS) {
+				return false;
+			}
+			if (j == classifier->ip_protocol_count) {
+				classifier->ip_protocols[classifier->ip_protocol_count++] = rule->ip_protocol;
+			}
+			classifier->by_ip_protocol[j] |= bit;
+		} else {
+			classifier->any_ip_protocol |= bit;
+		}
+	}
+
+	return true;
+}
+
+/* \return TCP or UDP destination port of an unfragmented IPv4 frame, -1 if there is none */
+static int
+enc28j60_classifier_port(struct enc28j60 *self, struct enc28j60_classifier_frame *frame)
+{
+	const uint8_t *data = frame->data;
+
+	if (frame->port >= 0) {
+		return frame->port;
+	}
+	if (!frame->ipv4 || (data[23] != IP_PROTOCOL_TCP && data[23] != IP_PROTOCOL_UDP)) {
+		return -1;
+	}
+	if (((data[20] & 0x1F) << 8 | data[21]) != 0) {
+		return -1;  /* Not the first fragment */
+	}
+
+	size_t offset = 14 + (data[14] & 0x0F) * 4 + 2;
+	if (offset + 2 <= frame->peeked) {
+		frame->port = data[offset] << 8 | data[offset + 1];
+	} else if (offset + 2 <= frame->len) {
+		/* IP options push the ports out of the peeked bytes */
+		uint8_t port[2];
+		enc28j60_receive_seek(self, offset);
+		enc28j60_receive_read(self, port, 2);
+		frame->port = port[0] << 8 | port[1];
+	}
+
+	return frame->port;
+}
+
+static bool
+enc28j60_classifier_local_ip(const struct enc28j60_classifier *classifier,
+		const struct enc28j60_classifier_frame *frame)
+{
+	if (frame->ipv4) {
+		return !memcmp(&frame->data[30], classifier->ip_address, 4);
+	}
+	if (frame->ethertype == ETHERTYPE_ARP && frame->peeked >= 42) {
+		return !memcmp(&frame->data[38], classifier->ip_address, 4);
+	}
+
+	return false;
+}
+
+static uint8_t
+enc28j60_classifier_decide(const struct enc28j60_classifier *classifier, struct enc28j60 *self,
+		struct enc28j60_classifier_frame *frame)
+{
+	const uint8_t *data = frame->data;
+	static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	uint32_t candidates;
+
+	if (data[0] & 1) {
+		candidates = classifier->by_destination[memcmp(data, broadcast, 6) ? DESTINATION_MULTICAST
+			: DESTINATION_BROADCAST];
+	} else {
+		candidates = classifier->by_destination[memcmp(data, self->mac_address, 6) ? DESTINATION_OTHER
+			: DESTINATION_UNICAST];
+	}
+
+	uint32_t ethertype_candidates = classifier->any_ethertype;
+	for (size_t i = 0; i < classifier->ethertype_count; i++) {
+		if (classifier->ethertypes[i] == frame->ethertype) {
+			ethertype_candidates |= classifier->by_ethertype[i];
+			break;
+		}
+	}
+	candidates &= ethertype_candidates;
+
+	uint32_t ip_protocol_candidates = classifier->any_ip_protocol;
+	if (frame->ipv4) {
+		for (size_t i = 0; i < classifier->ip_protocol_count; i++) {
+			if (classifier->ip_protocols[i] == data[23]) {
+				ip_protocol_candidates |= classifier->by_ip_protocol[i];
+				break;
+			}
+		}
+	}
+	candidates &= ip_protocol_candidates;
+
+	/* Remaining conditions in rule order */
+	while (candidates) {
+		const struct enc28j60_rule *rule = &classifier->rules[__builtin_ctz(candidates)];
+		candidates &= candidates - 1;
+
+		if (rule->match & ENC28J60_MATCH_PORT) {
+			int port = enc28j60_classifier_port(self, frame);
+			if (port < rule->port_min || port > rule->port_max) {
+				continue;
+			}
+		}
+		if ((rule->match & ENC28J60_MATCH_LOCAL_IP) && !enc28j60_classifier_local_ip(classifier, frame)) {
+			continue;
+		}
+
+		return rule->class_id;
+	}
+
+	return classifier->default_class;
+}
+
+uint16_t
+enc28j60_classify(struct enc28j60_classifier *classifier, struct enc28j60 *self, uint8_t *class_id)
+{
+	uint8_t data[ENC28J60_CLASSIFIER_PEEK];
+	struct enc28j60_classifier_frame frame = { .data = data, .port = -1 };
+
+	frame.len = enc28j60_receive_init(self);
+	frame.peeked = frame.len < sizeof(data) ? frame.len : sizeof(data);
+
+	uint8_t decision = ENC28J60_CLASS_DROP;
+	if (frame.peeked >= 14) {
+		enc28j60_receive_read(self, data, frame.peeked);
+		frame.ethertype = data[12] << 8 | data[13];
+		frame.ipv4 = frame.ethertype == ETHERTYPE_IPV4 && frame.peeked >= 34 && (data[14] >> 4) == 4;
+		decision = enc28j60_classifier_decide(classifier, self, &frame);
+	}
+
+	if (decision == ENC28J60_CLASS_DROP) {
+		enc28j60_receive_ack(self);
+		classifier->dropped++;
+		classifier->dropped_bytes += frame.len - frame.peeked;
+		return 0;
+	}
+
+	enc28j60_receive_seek(self, 0);
+	classifier->accepted++;
+	*class_id = decision;
+
+	return frame.len;
+}
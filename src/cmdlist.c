@@ -0,0 +1,378 @@
+#include <string.h>
+
+#include <hardware/dma.h>
+#include <hardware/pio.h>
+#include <hardware/spi.h>
+#include <pico/stdlib.h>
+
+#include <pico/enc28j60/cmdlist.h>
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/pio.h>
+
+void
+enc28j60_cmdlist_init(struct enc28j60_cmdlist *list)
+{
+	list->tx_channel = dma_claim_unused_channel(true);
+	list->rx_channel = dma_claim_unused_channel(true);
+	list->submitted = NULL;
+	enc28j60_cmdlist_clear(list);
+}
+
+void
+enc28j60_cmdlist_clear(struct enc28j60_cmdlist *list)
+{
+	list->count = 0;
+	list->tx_len = 0;
+	list->rx_len = 0;
+	list->bank = ENC28J60_BANK_ANY;
+}
+
+int
+enc28j60_cmdlist_add(struct enc28j60_cmdlist *list, uint8_t instruction, const uint8_t *data, size_t len,
+		size_t read_len)
+{
+	size_t bytes = 1 + len + read_len;
+	if (list->count == ENC28J60_CMDLIST_COMMANDS || list->rx_len + bytes > ENC28J60_CMDLIST_BYTES) {
+		return -1;
+	}
+
+	struct enc28j60_command *command = &list->commands[list->count];
+	command->tx_len = len;
+	command->rx_len = read_len;
+	command->tx_offset = list->tx_len;
+	command->rx_offset = list->rx_len;
+
+	/* Same layout as consumed by the PIO program, see pio_spi.pio */
+	list->tx[list->tx_len++] = 8 * bytes - 1;
+	list->tx[list->tx_len++] = (uint32_t) instruction << 24;
+	for (size_t i = 0; i < len; i++) {
+		list->tx[list->tx_len++] = (uint32_t) data[i] << 24;
+	}
+	for (size_t i = 0; i < read_len; i++) {
+		list->tx[list->tx_len++] = 0;
+	}
+	list->rx_len += bytes;
+
+	return list->count++;
+}
+
+int
+enc28j60_cmdlist_select_bank(struct enc28j60_cmdlist *list, uint8_t bank)
+{
+	uint8_t bank_mask = 0x03;
+	uint8_t count = list->count;
+	uint8_t tx_len = list->tx_len;
+	uint8_t rx_len = list->rx_len;
+
+	bank &= 0x03;
+	int index = enc28j60_cmdlist_add(list, ENC28J60_BFC | ENC28J60_ECON1, &bank_mask, 1, 0);
+	if (index >= 0 && bank) {
+		index = enc28j60_cmdlist_add(list, ENC28J60_BFS | ENC28J60_ECON1, &bank, 1, 0);
+	}
+	if (index < 0) {
+		/* Never leave half a bank switch in the list */
+		list->count = count;
+		list->tx_len = tx_len;
+		list->rx_len = rx_len;
+		return -1;
+	}
+
+	list->bank = bank;
+	return index;
+}
+
+static void
+enc28j60_cmdlist_execute_spi(const struct enc28j60 *config, struct enc28j60_cmdlist *list)
+{
+	uint8_t tx[ENC28J60_CMDLIST_BYTES];
+	struct spi_inst *spi = config->bus != NULL ? config->bus->spi : config->spi;
+
+	for (uint8_t i = 0; i < list->count; i++) {
+		const struct enc28j60_command *command = &list->commands[i];
+		size_t bytes = 1 + command->tx_len + command->rx_len;
+		for (size_t j = 0; j < bytes; j++) {
+			tx[j] = list->tx[command->tx_offset + 1 + j] >> 24;
+		}
+
+		gpio_put(config->cs_pin, 0);
+		spi_write_read_blocking(spi, tx, &list->rx[command->rx_offset], bytes);
+		gpio_put(config->cs_pin, 1);
+	}
+}
+
+static void
+enc28j60_cmdlist_execute_dma(const struct enc28j60 *config, struct enc28j60_cmdlist *list)
+{
+	const struct enc28j60_pio *pio = config->pio;
+
+	dma_channel_config tx_config = dma_channel_get_default_config(list->tx_channel);
+	channel_config_set_transfer_data_size(&tx_config, DMA_SIZE_32);
+	channel_config_set_read_increment(&tx_config, true);
+	channel_config_set_write_increment(&tx_config, false);
+	channel_config_set_dreq(&tx_config, pio_get_dreq(pio->pio, pio->sm, true));
+	dma_channel_configure(list->tx_channel, &tx_config, &pio->pio->txf[pio->sm], list->tx, list->tx_len, false);
+
+	dma_channel_config rx_config = dma_channel_get_default_config(list->rx_channel);
+	channel_config_set_transfer_data_size(&rx_config, DMA_SIZE_8);
+	channel_config_set_read_increment(&rx_config, false);
+	channel_config_set_write_increment(&rx_config, true);
+	channel_config_set_dreq(&rx_config, pio_get_dreq(pio->pio, pio->sm, false));
+	dma_channel_configure(list->rx_channel, &rx_config, list->rx, &pio->pio->rxf[pio->sm], list->rx_len, false);
+
+	dma_start_channel_mask((1u << list->tx_channel) | (1u << list->rx_channel));
+}
+
+void
+enc28j60_cmdlist_submit(struct enc28j60 *config, struct enc28j60_cmdlist *list)
+{
+	enc28j60_transaction_begin(config);
+	list->submitted = config;
+	if (list->bank != ENC28J60_BANK_ANY) {
+		config->bank = list->bank;
+	}
+
+	if (config->pio != NULL) {
+		enc28j60_cmdlist_execute_dma(config, list);
+	} else {
+		enc28j60_cmdlist_execute_spi(config, list);
+	}
+}
+
+bool
+enc28j60_cmdlist_busy(const struct enc28j60_cmdlist *list)
+{
+	if (list->submitted == NULL || list->submitted->pio == NULL) {
+		return false;
+	}
+
+	return dma_channel_is_busy(list->rx_channel);
+}
+
+void
+enc28j60_cmdlist_wait(struct enc28j60_cmdlist *list)
+{
+	struct enc28j60 *config = list->submitted;
+	if (config == NULL) {
+		return;
+	}
+
+	if (config->pio != NULL) {
+		dma_channel_wait_for_finish_blocking(list->rx_channel);
+	}
+
+	list->submitted = NULL;
+	enc28j60_transaction_end(config);
+}
+
+const uint8_t *
+enc28j60_cmdlist_result(const struct enc28j60_cmdlist *list, int index)
+{
+	const struct enc28j60_command *command = &list->commands[index];
+
+	return &list->rx[command->rx_offset + 1 + command->tx_len];
+}
+
+/* Index of the EIR read in the list built by enc28j60_isr_begin_submit */
+#define ISR_BEGIN_EIR 1
+
+void
+enc28j60_isr_begin_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	uint8_t intie = ENC28J60_INTIE;
+
+	enc28j60_cmdlist_clear(list);
+	enc28j60_cmdlist_add(list, ENC28J60_BFC | ENC28J60_EIE, &intie, 1, 0);
+	enc28j60_cmdlist_add(list, ENC28J60_RCR | ENC28J60_EIR, NULL, 0, 1);
+	/* Always, the bank of the instance may change on another core until the list is submitted */
+	enc28j60_cmdlist_select_bank(list, 1);
+	enc28j60_cmdlist_add(list, ENC28J60_RCR | ENC28J60_EPKTCNT, NULL, 0, 1);
+
+	enc28j60_cmdlist_submit(self, list);
+}
+
+uint8_t
+enc28j60_isr_begin_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	(void) self;
+
+	enc28j60_cmdlist_wait(list);
+
+	uint8_t flags = *enc28j60_cmdlist_result(list, ISR_BEGIN_EIR);
+
+	/* Errata, EPKTCNT is read last */
+	if (*enc28j60_cmdlist_result(list, list->count - 1)) {
+		flags |= ENC28J60_PKTIF;
+	}
+
+	return flags;
+}
+
+uint8_t
+enc28j60_isr_begin_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	enc28j60_isr_begin_submit(self, list);
+
+	return enc28j60_isr_begin_complete(self, list);
+}
+
+void
+enc28j60_isr_end_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list, uint8_t flags)
+{
+	uint8_t intie = ENC28J60_INTIE;
+
+	if (!flags) {
+		flags = ENC28J60_PKTIF | ENC28J60_DMAIF | ENC28J60_LINKIF | ENC28J60_TXIF | ENC28J60_TXERIF | ENC28J60_RXERIF;
+	}
+
+	enc28j60_cmdlist_clear(list);
+	enc28j60_cmdlist_add(list, ENC28J60_BFC | ENC28J60_EIR, &flags, 1, 0);
+	enc28j60_cmdlist_add(list, ENC28J60_BFS | ENC28J60_EIE, &intie, 1, 0);
+
+	enc28j60_cmdlist_submit(self, list);
+}
+
+void
+enc28j60_isr_end_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	(void) self;
+
+	enc28j60_cmdlist_wait(list);
+}
+
+void
+enc28j60_isr_end_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list, uint8_t flags)
+{
+	enc28j60_isr_end_submit(self, list, flags);
+	enc28j60_isr_end_complete(self, list);
+}
+
+/* \return index of the write of the high byte, or -1 if the list is full, in which case nothing is added */
+static int
+enc28j60_cmdlist_add_cr16(struct enc28j60_cmdlist *list, uint8_t address, uint16_t data)
+{
+	uint8_t low = data & 0xFF;
+	uint8_t high = data >> 8;
+	uint8_t count = list->count;
+	uint8_t tx_len = list->tx_len;
+	uint8_t rx_len = list->rx_len;
+
+	int index = enc28j60_cmdlist_add(list, ENC28J60_WCR | address, &low, 1, 0);
+	if (index >= 0) {
+		index = enc28j60_cmdlist_add(list, ENC28J60_WCR | (address + 1), &high, 1, 0);
+	}
+	if (index < 0) {
+		/* Never leave half a 16-bit write in the list */
+		list->count = count;
+		list->tx_len = tx_len;
+		list->rx_len = rx_len;
+	}
+
+	return index;
+}
+
+void
+enc28j60_transfer_init_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	uint8_t control = 0;
+
+	enc28j60_transfer_claim(self);
+
+	enc28j60_cmdlist_clear(list);
+	enc28j60_cmdlist_select_bank(list, 0);
+	uint16_t tx_start = enc28j60_rx_buffer_size(self);
+	enc28j60_cmdlist_add_cr16(list, ENC28J60_ETXST, tx_start);
+	enc28j60_cmdlist_add_cr16(list, ENC28J60_ETXND, tx_start);
+	enc28j60_cmdlist_add_cr16(list, ENC28J60_EWRPT, tx_start);
+	enc28j60_cmdlist_add(list, ENC28J60_WBM | ENC28J60_BM_ARG, &control, 1, 0);
+
+	enc28j60_cmdlist_submit(self, list);
+	self->tx_generation++;
+}
+
+void
+enc28j60_transfer_init_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	(void) self;
+
+	enc28j60_cmdlist_wait(list);
+}
+
+void
+enc28j60_transfer_init_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	enc28j60_transfer_init_submit(self, list);
+	enc28j60_transfer_init_complete(self, list);
+}
+
+void
+enc28j60_receive_init_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	enc28j60_cmdlist_clear(list);
+	enc28j60_cmdlist_select_bank(list, 0);
+	enc28j60_cmdlist_add_cr16(list, ENC28J60_ERDPT, self->next_packet);
+	enc28j60_cmdlist_add(list, ENC28J60_RBM | ENC28J60_BM_ARG, NULL, 0, 6);
+
+	enc28j60_cmdlist_submit(self, list);
+	self->buffers |= ENC28J60_BUFFER_RX;
+}
+
+uint16_t
+enc28j60_receive_init_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	struct {
+		uint16_t next_packet;
+		uint16_t byte_count;
+		uint16_t status;
+	} header;
+
+	enc28j60_cmdlist_wait(list);
+
+	/* The header is read by the last command */
+	memcpy(&header, enc28j60_cmdlist_result(list, list->count - 1), 6);
+
+	self->rx_start = (self->next_packet + 6) % enc28j60_rx_buffer_size(self);
+	self->rx_pointer = self->rx_start;
+	self->next_packet = header.next_packet;
+
+	return (header.status & 0x80) ? header.byte_count - 4 : 0;
+}
+
+uint16_t
+enc28j60_receive_init_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	enc28j60_receive_init_submit(self, list);
+
+	return enc28j60_receive_init_complete(self, list);
+}
+
+void
+enc28j60_receive_ack_submit(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	uint8_t pktdec = ENC28J60_PKTDEC;
+
+	/* Free buffer & Errata issue 14 */
+	uint16_t read_pointer = self->next_packet == 0 ? enc28j60_rx_buffer_size(self) - 1 : self->next_packet - 1;
+
+	enc28j60_cmdlist_clear(list);
+	enc28j60_cmdlist_add(list, ENC28J60_BFS | ENC28J60_ECON2, &pktdec, 1, 0);
+	enc28j60_cmdlist_select_bank(list, 0);
+	enc28j60_cmdlist_add_cr16(list, ENC28J60_ERXRDPT, read_pointer);
+
+	enc28j60_cmdlist_submit(self, list);
+	self->buffers &= ~ENC28J60_BUFFER_RX;
+}
+
+void
+enc28j60_receive_ack_complete(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	(void) self;
+
+	enc28j60_cmdlist_wait(list);
+}
+
+void
+enc28j60_receive_ack_batched(struct enc28j60 *self, struct enc28j60_cmdlist *list)
+{
+	enc28j60_receive_ack_submit(self, list);
+	enc28j60_receive_ack_complete(self, list);
+}
@@ -0,0 +1,141 @@
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+
+#include <hardware/timer.h>
+#include <pico/platform.h>
+
+#include <pico/enc28j60/dispatch.h>
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_VLAN 0x8100
+#define IP_PROTOCOL_TCP 6
+#define IP_PROTOCOL_UDP 17
+#define HEADER_PEEK 42  /* Ethernet, 802.1Q tag, minimal IPv4 header and ports */
+
+/* Final mix of murmur3, so low bits depend on every input bit */
+static u32_t
+dispatch_mix(u32_t hash)
+{
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+static u32_t
+dispatch_word(const u8_t *data)
+{
+	return (u32_t) data[0] << 24 | (u32_t) data[1] << 16 | (u32_t) data[2] << 8 | data[3];
+}
+
+u32_t
+ethernetif_dispatch_hash(const struct pbuf *p)
+{
+	u8_t header[HEADER_PEEK];
+	u16_t len = pbuf_copy_partial(p, header, sizeof(header), ETH_PAD_SIZE);
+	size_t offset = 12;
+
+	if (len < 14) {
+		return 0;
+	}
+
+	u16_t ethertype = header[12] << 8 | header[13];
+	if (ethertype == ETHERTYPE_VLAN && len >= 18) {
+		offset += 4;
+		ethertype = header[16] << 8 | header[17];
+	}
+
+	const u8_t *ip = &header[offset + 2];
+	if (ethertype != ETHERTYPE_IPV4 || len < offset + 2 + 20 || (ip[0] >> 4) != 4) {
+		/* XOR of both addresses keeps the hash symmetric */
+		u32_t hash = ethertype;
+		for (size_t i = 0; i < 6; i += 2) {
+			hash = hash * 31 + ((header[i] << 8 | header[i + 1]) ^ (header[6 + i] << 8 | header[7 + i]));
+		}
+		return dispatch_mix(hash);
+	}
+
+	u32_t hash = (dispatch_word(&ip[12]) ^ dispatch_word(&ip[16])) + ip[9];
+
+	/* Fragments have no ports after the first one, hash every fragment of a datagram alike */
+	bool fragment = (ip[6] & 0x3F) || ip[7];
+	if (!fragment && (ip[9] == IP_PROTOCOL_TCP || ip[9] == IP_PROTOCOL_UDP)) {
+		u8_t ports[4];
+		u16_t ports_offset = ETH_PAD_SIZE + offset + 2 + (ip[0] & 0x0F) * 4;
+		if (pbuf_copy_partial(p, ports, sizeof(ports), ports_offset) == sizeof(ports)) {
+			hash = hash * 31 + ((ports[0] << 8 | ports[1]) ^ (ports[2] << 8 | ports[3]));
+		}
+	}
+
+	return dispatch_mix(hash);
+}
+
+void
+ethernetif_dispatch_init(struct ethernetif_dispatch *dispatch)
+{
+	if (!dispatch->depth) {
+		dispatch->depth = 16;
+	}
+
+	for (size_t i = 0; i < ETHERNETIF_DISPATCH_QUEUES; i++) {
+		queue_init(&dispatch->queues[i].queue, sizeof(struct pbuf *), dispatch->depth);
+	}
+}
+
+void
+ethernetif_dispatch_register(struct ethernetif_dispatch *dispatch, ethernetif_dispatch_handler_t handler,
+		void *context)
+{
+	struct ethernetif_dispatch_queue *queue = &dispatch->queues[get_core_num()];
+
+	queue->context = context;
+	queue->handler = handler;
+}
+
+bool
+ethernetif_dispatch_put(struct ethernetif_dispatch *dispatch, struct pbuf *p)
+{
+	struct ethernetif_dispatch_queue *queue =
+			&dispatch->queues[ethernetif_dispatch_hash(p) % ETHERNETIF_DISPATCH_QUEUES];
+	u16_t len = p->tot_len;  /* Once queued, p belongs to the other core and may be freed any time */
+
+	if (queue->handler == NULL || !queue_try_add(&queue->queue, &p)) {
+		queue->dropped++;
+		pbuf_free(p);
+		return false;
+	}
+
+	queue->enqueued++;
+	queue->bytes += len;
+	u16_t depth = queue_get_level_unsafe(&queue->queue);
+	if (depth > queue->max_depth) {
+		queue->max_depth = depth;
+	}
+
+	return true;
+}
+
+u32_t
+ethernetif_dispatch_poll(struct ethernetif_dispatch *dispatch, u32_t budget)
+{
+	struct ethernetif_dispatch_queue *queue = &dispatch->queues[get_core_num()];
+	struct pbuf *p;
+	u32_t handled = 0;
+
+	if (!budget) {
+		budget = dispatch->depth;
+	}
+
+	while (handled < budget && queue_try_remove(&queue->queue, &p)) {
+		u32_t start = time_us_32();
+		queue->handler(p, queue->context);
+		queue->busy_us += time_us_32() - start;
+		handled++;
+	}
+	queue->handled += handled;
+
+	return handled;
+}
@@ -4,104 +4,166 @@
 #include <pico/stdlib.h>
 
 #include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/pio.h>
+
+/* Advance a receive buffer address, wrapping around the end of the receive buffer. */
+static inline uint16_t
+enc28j60_rx_advance(const struct enc28j60 *self, uint16_t address, size_t len)
+{
+	return (address + len) % enc28j60_rx_buffer_size(self);
+}
 
 void
-enc28j60_init(const struct enc28j60 *self)
+enc28j60_init(struct enc28j60 *self)
 {
 	/* Soft reset */
 	enc28j60_write(self, ENC28J60_SRC | ENC28J60_SRC_ARG, NULL, 0);
+	self->bank = 0;
+	self->rx_held = 0;
+	self->buffers = 0;
 	sleep_ms(1); /* Errata issue 2 */
 
 	/* LED setup */
 	enc28j60_write_phy(self, ENC28J60_PHLCON, 0x3476);
 
-	uint8_t prev_bank = enc28j60_switch_bank(self, 0);
-
 	/* MAC setup */
-	enc28j60_write_cr16(self, ENC28J60_ERXST, 0);  /* Start receive buffer in 0 as per errata issue 5 */
-	enc28j60_write_cr16(self, ENC28J60_ERXND, ENC28J60_RCV_BUFFER_SIZE - 1);
-	enc28j60_write_cr16(self, ENC28J60_ERXRDPT, 0);
-
-	enc28j60_switch_bank(self, 2);
-	enc28j60_write_cr8(self, ENC28J60_MACON1, ENC28J60_MARXEN);
-	enc28j60_write_cr8(self, ENC28J60_MACON3, ENC28J60_PADCFG_60 | ENC28J60_TXCRCEN | ENC28J60_FRMLNEN);
-	enc28j60_write_cr8(self, ENC28J60_MACON4, ENC28J60_DEFER);
-	enc28j60_write_cr16(self, ENC28J60_MAMXFL, 1518);
-	enc28j60_write_cr8(self, ENC28J60_MABBIPG, 0x12);
-	enc28j60_write_cr16(self, ENC28J60_MAIPG, 0x0C12);
-
-	enc28j60_switch_bank(self, 3);
-	enc28j60_write_cr16(self, ENC28J60_MAADR1, self->mac_address[0]);
-	enc28j60_write_cr16(self, ENC28J60_MAADR2, self->mac_address[1]);
-	enc28j60_write_cr16(self, ENC28J60_MAADR3, self->mac_address[2]);
-	enc28j60_write_cr16(self, ENC28J60_MAADR4, self->mac_address[3]);
-	enc28j60_write_cr16(self, ENC28J60_MAADR5, self->mac_address[4]);
-	enc28j60_write_cr16(self, ENC28J60_MAADR6, self->mac_address[5]);
+	enc28j60_reg_write(self, ENC28J60_REG_ERXST, 0);  /* Start receive buffer in 0 as per errata issue 5 */
+	enc28j60_reg_write(self, ENC28J60_REG_ERXND, enc28j60_rx_buffer_size(self) - 1);
+	enc28j60_reg_write(self, ENC28J60_REG_ERXRDPT, 0);
+
+	enc28j60_reg_write(self, ENC28J60_REG_MACON1, ENC28J60_MARXEN);
+	if (self->vlan != NULL) {
+		/* Tagged frames are padded to 64 bytes and may be 4 bytes longer */
+		enc28j60_reg_write(self, ENC28J60_REG_MACON3, ENC28J60_PADCFG_VLAN | ENC28J60_TXCRCEN | ENC28J60_FRMLNEN);
+		enc28j60_reg_write(self, ENC28J60_REG_MAMXFL, 1522);
+	} else {
+		enc28j60_reg_write(self, ENC28J60_REG_MACON3, ENC28J60_PADCFG_60 | ENC28J60_TXCRCEN | ENC28J60_FRMLNEN);
+		enc28j60_reg_write(self, ENC28J60_REG_MAMXFL, 1518);
+	}
+	enc28j60_reg_write(self, ENC28J60_REG_MACON4, ENC28J60_DEFER);
+	enc28j60_reg_write(self, ENC28J60_REG_MABBIPG, 0x12);
+	enc28j60_reg_write(self, ENC28J60_REG_MAIPG, 0x0C12);
+
+	enc28j60_reg_write(self, ENC28J60_REG_MAADR1, self->mac_address[0]);
+	enc28j60_reg_write(self, ENC28J60_REG_MAADR2, self->mac_address[1]);
+	enc28j60_reg_write(self, ENC28J60_REG_MAADR3, self->mac_address[2]);
+	enc28j60_reg_write(self, ENC28J60_REG_MAADR4, self->mac_address[3]);
+	enc28j60_reg_write(self, ENC28J60_REG_MAADR5, self->mac_address[4]);
+	enc28j60_reg_write(self, ENC28J60_REG_MAADR6, self->mac_address[5]);
 
 	/* PHY setup */
 	enc28j60_write_phy(self, ENC28J60_PHCON2, ENC28J60_HDLDIS); /* Disable loopback as per errata issue 9 */
 
 	/* Disable all filters */
-	enc28j60_switch_bank(self, 1);
-	enc28j60_write_cr16(self, ENC28J60_ERXFCON, 0);
+	enc28j60_reg_write(self, ENC28J60_REG_ERXFCON, 0);
 
 	/* Enable reception */
-	enc28j60_bit_set(self, ENC28J60_ECON1, ENC28J60_RXEN);
+	enc28j60_reg_set(self, ENC28J60_REG_ECON1, ENC28J60_RXEN);
+}
 
-	enc28j60_switch_bank(self, prev_bank);
+void
+enc28j60_transfer_claim(struct enc28j60 *self)
+{
+	enc28j60_transaction_begin(self);
+	while (enc28j60_transfer_busy(self)) {
+		/* Lets interrupts in while waiting, unless the caller holds a transaction */
+		enc28j60_transaction_end(self);
+		tight_loop_contents();
+		enc28j60_transaction_begin(self);
+	}
+	self->buffers |= ENC28J60_BUFFER_TX;
+	enc28j60_transaction_end(self);
 }
 
 void
-enc28j60_transfer_init(const struct enc28j60 *self)
+enc28j60_transfer_init(struct enc28j60 *self)
 {
-	uint8_t prev_bank = enc28j60_switch_bank(self, 0);
-	enc28j60_write_cr16(self, ENC28J60_ETXST, ENC28J60_RCV_BUFFER_SIZE);
-	enc28j60_write_cr16(self, ENC28J60_ETXND, ENC28J60_RCV_BUFFER_SIZE);
-	enc28j60_write_cr16(self, ENC28J60_EWRPT, ENC28J60_RCV_BUFFER_SIZE);
+	enc28j60_transfer_claim(self);
+
+	enc28j60_transaction_begin(self);
+	self->tx_generation++;
+	uint16_t tx_start = enc28j60_rx_buffer_size(self);
+	enc28j60_reg_write(self, ENC28J60_REG_ETXST, tx_start);
+	enc28j60_reg_write(self, ENC28J60_REG_ETXND, tx_start);
+	enc28j60_reg_write(self, ENC28J60_REG_EWRPT, tx_start);
 
 	uint8_t control = 0;
 	enc28j60_write(self, ENC28J60_WBM | ENC28J60_BM_ARG, &control, 1);
+	enc28j60_transaction_end(self);
+}
 
-	enc28j60_switch_bank(self, prev_bank);
+void
+enc28j60_transfer_write(struct enc28j60 *self, const uint8_t *payload, size_t len)
+{
+	do {
+		size_t chunk = (self->preempt_chunk && len > self->preempt_chunk) ? self->preempt_chunk : len;
+
+		enc28j60_transaction_begin(self);
+		uint16_t tx_buffer_end = enc28j60_reg_read(self, ENC28J60_REG_ETXND);
+		if (self->preempt_chunk) {
+			enc28j60_reg_write(self, ENC28J60_REG_EWRPT, tx_buffer_end + 1);
+		}
+		enc28j60_write(self, ENC28J60_WBM | ENC28J60_BM_ARG, payload, chunk);
+		enc28j60_reg_write(self, ENC28J60_REG_ETXND, tx_buffer_end + chunk);
+		enc28j60_transaction_end(self);
+
+		payload += chunk;
+		len -= chunk;
+	} while (len);
 }
 
 void
-enc28j60_transfer_write(const struct enc28j60 *self, const uint8_t *payload, size_t len)
+enc28j60_transfer_copy(struct enc28j60 *self, uint16_t source, size_t len)
 {
-	uint8_t prev_bank = enc28j60_switch_bank(self, 0);
+	enc28j60_transaction_begin(self);
+	uint16_t tx_buffer_end = enc28j60_reg_read(self, ENC28J60_REG_ETXND);
+	enc28j60_dma_copy(self, tx_buffer_end + 1, source, len);
+	enc28j60_reg_write(self, ENC28J60_REG_ETXND, tx_buffer_end + len);
+	enc28j60_reg_write(self, ENC28J60_REG_EWRPT, tx_buffer_end + len + 1);
+	enc28j60_transaction_end(self);
+}
 
-	uint16_t tx_buffer_end = enc28j60_read_cr16(self, ENC28J60_ETXND);
-	enc28j60_write(self, ENC28J60_WBM | ENC28J60_BM_ARG, payload, len);
-	enc28j60_write_cr16(self, ENC28J60_ETXND, tx_buffer_end + len);
+void
+enc28j60_transfer_start(struct enc28j60 *self)
+{
+	const uint8_t commands[][2] = {
+		/* Reset transmission logic, errata issue 12 */
+		{ ENC28J60_BFS | ENC28J60_ECON1, ENC28J60_TXRST },
+		{ ENC28J60_BFC | ENC28J60_ECON1, ENC28J60_TXRST },
+
+		{ ENC28J60_BFS | ENC28J60_ECON1, ENC28J60_TXRTS },
+	};
+	enc28j60_write_sequence(self, commands, 3);
+	self->buffers &= ~ENC28J60_BUFFER_TX;
+}
 
-	enc28j60_switch_bank(self, prev_bank);
+bool
+enc28j60_transfer_busy(struct enc28j60 *self)
+{
+	return enc28j60_reg_read(self, ENC28J60_REG_ECON1) & ENC28J60_TXRTS;
 }
 
 void
-enc28j60_transfer_send(const struct enc28j60 *self)
+enc28j60_transfer_send(struct enc28j60 *self)
 {
-	/* Reset transmission logic, errata issue 12 */
-	enc28j60_bit_set(self, ENC28J60_ECON1, ENC28J60_TXRST);
-	enc28j60_bit_clear(self, ENC28J60_ECON1, ENC28J60_TXRST);
+	enc28j60_transfer_start(self);
 
-	enc28j60_bit_set(self, ENC28J60_ECON1, ENC28J60_TXRTS);
-
-	while (enc28j60_read_cr8(self, ENC28J60_ECON1, false) & ENC28J60_TXRTS) {
-		sleep_us(1);
+	while (enc28j60_transfer_busy(self)) {
+		tight_loop_contents();
 	}
 }
 
 void
-enc28j60_transfer_status(const struct enc28j60 *self, uint8_t *status)
+enc28j60_transfer_status(struct enc28j60 *self, uint8_t *status)
 {
 	if (status == NULL) {
 		return;
 	}
 
-	uint8_t prev_bank = enc28j60_switch_bank(self, 0);
-	enc28j60_write_cr16(self, ENC28J60_ERDPT, enc28j60_read_cr16(self, ENC28J60_ETXND) + 1);
+	enc28j60_transaction_begin(self);
+	enc28j60_reg_write(self, ENC28J60_REG_ERDPT, enc28j60_reg_read(self, ENC28J60_REG_ETXND) + 1);
 	enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, status, 7);
-	enc28j60_switch_bank(self, prev_bank);
+	enc28j60_transaction_end(self);
 }
 
 uint16_t
@@ -112,129 +174,391 @@ enc28j60_receive_init(struct enc28j60 *self)
 		uint16_t byte_count;
 		uint16_t status;
 	} header;
-	uint8_t prev_bank = enc28j60_switch_bank(self, 0);
-	enc28j60_write_cr16(self, ENC28J60_ERDPT, self->next_packet);
+	enc28j60_transaction_begin(self);
+	self->buffers |= ENC28J60_BUFFER_RX;
+	enc28j60_reg_write(self, ENC28J60_REG_ERDPT, self->next_packet);
 	enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, (uint8_t *) &header, 6);
+	enc28j60_transaction_end(self);
 
+	self->rx_start = enc28j60_rx_advance(self, self->next_packet, 6);
+	self->rx_pointer = self->rx_start;
 	self->next_packet = header.next_packet;
 
-	enc28j60_switch_bank(self, prev_bank);
-
 	return (header.status & 0x80) ? header.byte_count - 4 : 0;
 }
 
 void
-enc28j60_receive_read(const struct enc28j60 *self, uint8_t *payload, size_t len)
+enc28j60_receive_read(struct enc28j60 *self, uint8_t *payload, size_t len)
 {
-	enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, payload, len);
+	if (!self->preempt_chunk) {
+		enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, payload, len);
+		self->rx_pointer = enc28j60_rx_advance(self, self->rx_pointer, len);
+		return;
+	}
+
+	while (len) {
+		size_t chunk = len > self->preempt_chunk ? self->preempt_chunk : len;
+
+		enc28j60_transaction_begin(self);
+		enc28j60_reg_write(self, ENC28J60_REG_ERDPT, self->rx_pointer);
+		enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, payload, chunk);
+		enc28j60_transaction_end(self);
+
+		self->rx_pointer = enc28j60_rx_advance(self, self->rx_pointer, chunk);
+		payload += chunk;
+		len -= chunk;
+	}
 }
 
 void
-enc28j60_receive_ack(const struct enc28j60 *self)
+enc28j60_receive_seek(struct enc28j60 *self, uint16_t offset)
 {
-	uint32_t crc;
-	enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, (uint8_t *) &crc, 4);
+	self->rx_pointer = enc28j60_rx_advance(self, self->rx_start, offset);
+	enc28j60_reg_write(self, ENC28J60_REG_ERDPT, self->rx_pointer);
+}
 
-	enc28j60_bit_set(self, ENC28J60_ECON2, ENC28J60_PKTDEC);
+void
+enc28j60_receive_ack(struct enc28j60 *self)
+{
+	enc28j60_transaction_begin(self);
+	enc28j60_reg_set(self, ENC28J60_REG_ECON2, ENC28J60_PKTDEC);
 
 	/* Free buffer & Errata issue 14 */
-	uint8_t prev_bank = enc28j60_switch_bank(self, 0);
-	if (self->next_packet == enc28j60_read_cr8(self, ENC28J60_ERXST, false)) {
-		enc28j60_write_cr16(self, ENC28J60_ERXRDPT, enc28j60_read_cr16(self, ENC28J60_ERXND));
+	if (self->next_packet == 0) {
+		enc28j60_reg_write(self, ENC28J60_REG_ERXRDPT, enc28j60_rx_buffer_size(self) - 1);
 	} else {
-		enc28j60_write_cr16(self, ENC28J60_ERXRDPT, self->next_packet - 1);
+		enc28j60_reg_write(self, ENC28J60_REG_ERXRDPT, self->next_packet - 1);
 	}
+	self->buffers &= ~ENC28J60_BUFFER_RX;
+	enc28j60_transaction_end(self);
+}
 
-	enc28j60_switch_bank(self, prev_bank);
+bool
+enc28j60_frame_next(struct enc28j60 *self, struct enc28j60_frame *frame)
+{
+	struct {
+		uint16_t next_packet;
+		uint16_t byte_count;
+		uint16_t status;
+	} header;
+
+	if (!enc28j60_frame_pending(self)) {
+		return false;
+	}
+
+	enc28j60_transaction_begin(self);
+	enc28j60_reg_write(self, ENC28J60_REG_ERDPT, self->next_packet);
+	enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, (uint8_t *) &header, 6);
+	enc28j60_transaction_end(self);
+
+	frame->start = enc28j60_rx_advance(self, self->next_packet, 6);
+	frame->next = header.next_packet;
+	frame->len = (header.status & 0x80) ? header.byte_count - 4 : 0;
+
+	self->next_packet = header.next_packet;
+	self->rx_held++;
+
+	return true;
+}
+
+void
+enc28j60_frame_read(struct enc28j60 *self, const struct enc28j60_frame *frame, uint16_t offset, uint8_t *data,
+		size_t len)
+{
+	/* The read pointer wraps from ERXND to ERXST by itself */
+	enc28j60_transaction_begin(self);
+	enc28j60_reg_write(self, ENC28J60_REG_ERDPT, enc28j60_rx_advance(self, frame->start, offset));
+	enc28j60_read(self, ENC28J60_RBM | ENC28J60_BM_ARG, data, len);
+	enc28j60_transaction_end(self);
+}
+
+void
+enc28j60_frame_release(struct enc28j60 *self, const struct enc28j60_frame *frame)
+{
+	enc28j60_transaction_begin(self);
+	enc28j60_reg_set(self, ENC28J60_REG_ECON2, ENC28J60_PKTDEC);
+
+	/* Free buffer & Errata issue 14 */
+	if (frame->next == 0) {
+		enc28j60_reg_write(self, ENC28J60_REG_ERXRDPT, enc28j60_rx_buffer_size(self) - 1);
+	} else {
+		enc28j60_reg_write(self, ENC28J60_REG_ERXRDPT, frame->next - 1);
+	}
+	enc28j60_transaction_end(self);
+
+	self->rx_held--;
+}
+
+uint8_t
+enc28j60_frame_pending(struct enc28j60 *self)
+{
+	return enc28j60_reg_read(self, ENC28J60_REG_EPKTCNT) - self->rx_held;
 }
 
 void
-enc28j60_interrupts(const struct enc28j60 *self, uint8_t flags)
+enc28j60_dma_copy(struct enc28j60 *self, uint16_t destination, uint16_t source, size_t len)
 {
-	enc28j60_bit_clear(self, ENC28J60_EIR, flags);
-	enc28j60_write_cr8(self, ENC28J60_EIE, flags | ENC28J60_INTIE);
+	uint16_t source_end = source + len - 1;
+	if (source < enc28j60_rx_buffer_size(self)) {
+		source_end = enc28j60_rx_advance(self, source, len - 1);
+	}
+
+	enc28j60_transaction_begin(self);
+	enc28j60_reg_write(self, ENC28J60_REG_EDMAST, source);
+	enc28j60_reg_write(self, ENC28J60_REG_EDMAND, source_end);
+	enc28j60_reg_write(self, ENC28J60_REG_EDMADST, destination);
+	enc28j60_reg_clear(self, ENC28J60_REG_ECON1, ENC28J60_CSUMEN);
+	enc28j60_reg_set(self, ENC28J60_REG_ECON1, ENC28J60_DMAST);
+	while (enc28j60_reg_read(self, ENC28J60_REG_ECON1) & ENC28J60_DMAST) {
+		tight_loop_contents();
+	}
+	enc28j60_transaction_end(self);
 }
 
 void
-enc28j60_isr_begin(const struct enc28j60 *self)
+enc28j60_interrupts(struct enc28j60 *self, uint8_t flags)
 {
-	enc28j60_bit_clear(self, ENC28J60_EIE, ENC28J60_INTIE);
+	const uint8_t commands[][2] = {
+		{ ENC28J60_BFC | ENC28J60_EIR, flags },
+		{ ENC28J60_WCR | ENC28J60_EIE, flags | ENC28J60_INTIE },
+	};
+	enc28j60_write_sequence(self, commands, 2);
 }
 
 void
-enc28j60_isr_end(const struct enc28j60 *self)
+enc28j60_isr_begin(struct enc28j60 *self)
 {
-	enc28j60_bit_set(self, ENC28J60_EIE, ENC28J60_INTIE);
+	enc28j60_reg_clear(self, ENC28J60_REG_EIE, ENC28J60_INTIE);
+}
+
+void
+enc28j60_isr_end(struct enc28j60 *self)
+{
+	enc28j60_reg_set(self, ENC28J60_REG_EIE, ENC28J60_INTIE);
 }
 
 uint8_t
-enc28j60_interrupt_flags(const struct enc28j60 *self)
+enc28j60_interrupt_flags(struct enc28j60 *self)
 {
-	uint8_t flags = enc28j60_read_cr8(self, ENC28J60_EIR, false);
+	enc28j60_transaction_begin(self);
+	uint8_t flags = enc28j60_reg_read(self, ENC28J60_REG_EIR);
 
 	/* Errata */
-	uint8_t prev_bank = enc28j60_switch_bank(self, 1);
-	uint8_t packet_count = enc28j60_read_cr8(self, ENC28J60_EPKTCNT, false);
-	if (packet_count) {
+	if (enc28j60_reg_read(self, ENC28J60_REG_EPKTCNT)) {
 		flags |= ENC28J60_PKTIF;
 	}
-
-	enc28j60_switch_bank(self, prev_bank);
+	enc28j60_transaction_end(self);
 
 	return flags;
 }
 
 void
-enc28j60_interrupt_clear(const struct enc28j60 *self, uint8_t flags)
+enc28j60_interrupt_clear(struct enc28j60 *self, uint8_t flags)
 {
 	if (!flags) {
 		flags = ENC28J60_PKTIF | ENC28J60_DMAIF | ENC28J60_LINKIF | ENC28J60_TXIF | ENC28J60_TXERIF | ENC28J60_RXERIF;
 	}
 
-	enc28j60_bit_clear(self, ENC28J60_EIR, flags);
+	enc28j60_reg_clear(self, ENC28J60_REG_EIR, flags);
 }
 
-void
-enc28j60_read(const struct enc28j60 *config, uint8_t instruction, uint8_t *data, size_t len)
+bool
+enc28j60_buffer_held(const struct enc28j60 *self, uint8_t buffer)
+{
+	return self->buffers & buffer;
+}
+
+static inline struct critical_section *
+enc28j60_critical_section(const struct enc28j60 *config)
+{
+	return config->bus != NULL ? config->bus->critical_section : config->critical_section;
+}
+
+static inline void
+enc28j60_lock(struct enc28j60 *config)
+{
+	struct critical_section *critical_section = enc28j60_critical_section(config);
+	if (critical_section == NULL) {
+		return;
+	}
+
+	/* The lock is shared by all instances on a bus */
+	struct enc28j60_lock *lock = config->bus != NULL ? &config->bus->lock : &config->lock;
+
+	/* Already held by a transaction on this core */
+	if (lock->depth && lock->core == get_core_num()) {
+		lock->depth++;
+		return;
+	}
+
+	critical_section_enter_blocking(critical_section);
+	lock->core = get_core_num();
+	lock->depth = 1;
+	lock->start = time_us_32();
+}
+
+static inline void
+enc28j60_unlock(struct enc28j60 *config)
 {
-	if (config->critical_section != NULL) {
-		critical_section_enter_blocking(config->critical_section);
+	struct critical_section *critical_section = enc28j60_critical_section(config);
+	if (critical_section == NULL) {
+		return;
+	}
+
+	struct enc28j60_lock *lock = config->bus != NULL ? &config->bus->lock : &config->lock;
+	if (--lock->depth) {
+		return;
 	}
-	gpio_put(config->cs_pin, 0);
-	spi_write_blocking(config->spi, &instruction, 1);
-	spi_read_blocking(config->spi, 0, data, len);
-	gpio_put(config->cs_pin, 1);
-	if (config->critical_section != NULL) {
-		critical_section_exit(config->critical_section);
+
+	uint32_t held = time_us_32() - lock->start;
+	if (held > config->max_lock_us) {
+		config->max_lock_us = held;
 	}
+	critical_section_exit(critical_section);
+}
+
+static inline struct spi_inst *
+enc28j60_spi(const struct enc28j60 *config)
+{
+	return config->bus != NULL ? config->bus->spi : config->spi;
 }
 
 void
-enc28j60_write(const struct enc28j60 *config, uint8_t instruction, const uint8_t *data, size_t len)
+enc28j60_transaction_begin(struct enc28j60 *self)
 {
-	if (config->critical_section != NULL) {
-		critical_section_enter_blocking(config->critical_section);
+	enc28j60_lock(self);
+}
+
+void
+enc28j60_transaction_end(struct enc28j60 *self)
+{
+	enc28j60_unlock(self);
+}
+
+static void
+enc28j60_spi_read(struct enc28j60 *config, uint8_t instruction, uint8_t *data, size_t len)
+{
+	config->spi_bytes += 1 + len;
+	if (config->pio != NULL) {
+		enc28j60_pio_command(config->pio, instruction, NULL, 0, data, len);
+	} else {
+		gpio_put(config->cs_pin, 0);
+		spi_write_blocking(enc28j60_spi(config), &instruction, 1);
+		spi_read_blocking(enc28j60_spi(config), 0, data, len);
+		gpio_put(config->cs_pin, 1);
 	}
-	gpio_put(config->cs_pin, 0);
-	spi_write_blocking(config->spi, &instruction, 1);
-	spi_write_blocking(config->spi, data, len);
-	gpio_put(config->cs_pin, 1);
-	if (config->critical_section != NULL) {
-		critical_section_exit(config->critical_section);
+}
+
+static void
+enc28j60_spi_write(struct enc28j60 *config, uint8_t instruction, const uint8_t *data, size_t len)
+{
+	config->spi_bytes += 1 + len;
+	if (config->pio != NULL) {
+		enc28j60_pio_command(config->pio, instruction, data, len, NULL, 0);
+	} else {
+		gpio_put(config->cs_pin, 0);
+		spi_write_blocking(enc28j60_spi(config), &instruction, 1);
+		spi_write_blocking(enc28j60_spi(config), data, len);
+		gpio_put(config->cs_pin, 1);
 	}
 }
 
+static void
+enc28j60_spi_sequence(struct enc28j60 *config, const uint8_t (*commands)[2], size_t count)
+{
+	config->spi_bytes += 2 * count;
+	if (config->pio != NULL) {
+		enc28j60_pio_commands(config->pio, commands, count);
+	} else {
+		for (size_t i = 0; i < count; i++) {
+			gpio_put(config->cs_pin, 0);
+			spi_write_blocking(enc28j60_spi(config), commands[i], 2);
+			gpio_put(config->cs_pin, 1);
+		}
+	}
+}
+
+/* Switch the bank unless it is selected already. Call with the lock held. */
+static void
+enc28j60_select_bank(struct enc28j60 *config, uint8_t bank)
+{
+	if (bank == ENC28J60_BANK_ANY || bank == config->bank) {
+		return;
+	}
+
+	const uint8_t commands[][2] = {
+		{ ENC28J60_BFC | ENC28J60_ECON1, 0x03 },
+		{ ENC28J60_BFS | ENC28J60_ECON1, bank },
+	};
+	enc28j60_spi_sequence(config, commands, 2);
+	config->bank = bank;
+}
+
+void
+enc28j60_read(struct enc28j60 *config, uint8_t instruction, uint8_t *data, size_t len)
+{
+	enc28j60_lock(config);
+	enc28j60_spi_read(config, instruction, data, len);
+	enc28j60_unlock(config);
+}
+
+void
+enc28j60_write(struct enc28j60 *config, uint8_t instruction, const uint8_t *data, size_t len)
+{
+	enc28j60_lock(config);
+	enc28j60_spi_write(config, instruction, data, len);
+	enc28j60_unlock(config);
+}
+
+/*
+ * Execute a sequence of two byte commands (instruction, argument).
+ * The sequence is executed in a single critical section and, with the PIO transport, without gaps between commands.
+ */
+void
+enc28j60_write_sequence(struct enc28j60 *config, const uint8_t (*commands)[2], size_t count)
+{
+	enc28j60_lock(config);
+	enc28j60_spi_sequence(config, commands, count);
+	enc28j60_unlock(config);
+}
+
+/*
+ * Read command preceded by a bank switch if needed, in a single critical section.
+ * \param bank bank of the register or ENC28J60_BANK_ANY for common registers
+ */
+void
+enc28j60_banked_read(struct enc28j60 *config, uint8_t bank, uint8_t instruction, uint8_t *data, size_t len)
+{
+	enc28j60_lock(config);
+	enc28j60_select_bank(config, bank);
+	enc28j60_spi_read(config, instruction, data, len);
+	enc28j60_unlock(config);
+}
+
+/*
+ * Sequence of two byte commands preceded by a bank switch if needed, in a single critical section.
+ * \param bank bank of the registers or ENC28J60_BANK_ANY for common registers
+ */
+void
+enc28j60_banked_write(struct enc28j60 *config, uint8_t bank, const uint8_t (*commands)[2], size_t count)
+{
+	enc28j60_lock(config);
+	enc28j60_select_bank(config, bank);
+	enc28j60_spi_sequence(config, commands, count);
+	enc28j60_unlock(config);
+}
+
 uint8_t
-enc28j60_read_cr8(const struct enc28j60 *config, uint8_t address, bool skip_dummy)
+enc28j60_read_cr8(struct enc28j60 *config, uint8_t address, bool skip_dummy)
 {
-	uint16_t data;
-	enc28j60_read(config, ENC28J60_RCR | address, (uint8_t *) &data, skip_dummy ? 2 : 1);
+	uint8_t data[2];
+	enc28j60_read(config, ENC28J60_RCR | address, data, skip_dummy ? 2 : 1);
 
-	return (uint8_t) data;
+	return skip_dummy ? data[1] : data[0];
 }
 
 uint16_t
-enc28j60_read_cr16(const struct enc28j60 *config, uint8_t address)
+enc28j60_read_cr16(struct enc28j60 *config, uint8_t address)
 {
 	uint16_t data;
 	enc28j60_read(config, ENC28J60_RCR | address, (uint8_t *) &data, 1);
@@ -244,67 +568,86 @@ enc28j60_read_cr16(const struct enc28j60 *config, uint8_t address)
 }
 
 void
-enc28j60_write_cr8(const struct enc28j60 *config, uint8_t address, uint8_t data)
+enc28j60_write_cr8(struct enc28j60 *config, uint8_t address, uint8_t data)
 {
 	enc28j60_write(config, ENC28J60_WCR | address, &data, 1);
 }
 
 void
-enc28j60_write_cr16(const struct enc28j60 *config, uint8_t address, uint16_t data)
+enc28j60_write_cr16(struct enc28j60 *config, uint8_t address, uint16_t data)
 {
-	enc28j60_write(config, ENC28J60_WCR | address, (uint8_t *) &data, 1);
-	enc28j60_write(config, ENC28J60_WCR | (address + 1), (uint8_t *) (&data) + 1, 1);
+	const uint8_t commands[][2] = {
+		{ ENC28J60_WCR | address, data & 0xFF },
+		{ ENC28J60_WCR | (address + 1), data >> 8 },
+	};
+	enc28j60_write_sequence(config, commands, 2);
 }
 
 void
-enc28j60_bit_set(const struct enc28j60 *config, uint8_t address, uint8_t mask)
+enc28j60_bit_set(struct enc28j60 *config, uint8_t address, uint8_t mask)
 {
 	enc28j60_write(config, ENC28J60_BFS | address , &mask, 1);
 }
 
 void
-enc28j60_bit_clear(const struct enc28j60 *config, uint8_t address, uint8_t mask)
+enc28j60_bit_clear(struct enc28j60 *config, uint8_t address, uint8_t mask)
 {
 	enc28j60_write(config, ENC28J60_BFC | address , &mask, 1);
 }
 
 uint8_t
-enc28j60_switch_bank(const struct enc28j60 *config, uint8_t bank)
+enc28j60_switch_bank(struct enc28j60 *config, uint8_t bank)
 {
-	uint8_t prev_bank = enc28j60_read_cr8(config, ENC28J60_ECON1, false) & 0x03;
-
-	enc28j60_bit_clear(config, ENC28J60_ECON1, 0x03);
-	enc28j60_bit_set(config, ENC28J60_ECON1, bank & 0x03); /* & 0x03 in case of a bad argument */
+	enc28j60_lock(config);
+	uint8_t prev_bank = config->bank;
+	enc28j60_select_bank(config, bank & 0x03); /* & 0x03 in case of a bad argument */
+	enc28j60_unlock(config);
 
 	return prev_bank;
 }
 
+static void
+enc28j60_wait_phy(struct enc28j60 *config)
+{
+	sleep_us(11);  /* MISTAT.BUSY is set 10.24 us after the command */
+	while (enc28j60_reg_read(config, ENC28J60_REG_MISTAT) & ENC28J60_BUSY) {
+		sleep_us(1);
+	}
+}
+
 uint16_t
-enc28j60_read_phy(const struct enc28j60 *config, uint8_t address)
+enc28j60_read_phy(struct enc28j60 *config, uint8_t address)
 {
-	uint8_t prev_bank = enc28j60_switch_bank(config, 2);
+	enc28j60_transaction_begin(config);
+	enc28j60_reg_write(config, ENC28J60_REG_MIREGADR, address);
+	enc28j60_reg_write(config, ENC28J60_REG_MICMD, ENC28J60_MIIRD);
+	enc28j60_transaction_end(config);
 
-	enc28j60_write_cr8(config, ENC28J60_MIREGADR, address);
-	enc28j60_bit_set(config, ENC28J60_MICMD, ENC28J60_MIIRD);
-	sleep_ms(1);  /* TODO: polling */
-	uint16_t data = (uint16_t) enc28j60_read_cr8(config, ENC28J60_MIRD, true) | ((uint16_t) enc28j60_read_cr8(config, ENC28J60_MIRD + 1, true) << 8);
-	enc28j60_bit_clear(config, ENC28J60_MICMD, ENC28J60_MIIRD);
+	enc28j60_wait_phy(config);
 
-	enc28j60_switch_bank(config, prev_bank);
+	enc28j60_transaction_begin(config);
+	enc28j60_reg_write(config, ENC28J60_REG_MICMD, 0);
+	uint16_t data = enc28j60_reg_read(config, ENC28J60_REG_MIRD);
+	enc28j60_transaction_end(config);
 
 	return data;
 }
 
 void
-enc28j60_write_phy(const struct enc28j60 *config, uint8_t address, uint16_t data)
+enc28j60_write_phy(struct enc28j60 *config, uint8_t address, uint16_t data)
 {
-	uint8_t prev_bank = enc28j60_switch_bank(config, 2);
-	enc28j60_write_cr8(config, ENC28J60_MIREGADR, address);
-	enc28j60_write_cr16(config, ENC28J60_MIWR, data);
+	enc28j60_transaction_begin(config);
+	enc28j60_reg_write(config, ENC28J60_REG_MIREGADR, address);
+	enc28j60_reg_write(config, ENC28J60_REG_MIWR, data);
+	enc28j60_transaction_end(config);
 
-	sleep_ms(1);  /* TODO: polling */
+	enc28j60_wait_phy(config);
+}
 
-	enc28j60_switch_bank(config, prev_bank);
+uint16_t
+enc28j60_rx_buffer_size(const struct enc28j60 *config)
+{
+	return config->rx_buffer_size ? config->rx_buffer_size : ENC28J60_RCV_BUFFER_SIZE;
 }
 
 /*
@@ -319,153 +662,3 @@ enc28j60_write_phy(const struct enc28j60 *config, uint8_t address, uint16_t data
  * which is 1518 (max frame size) + 1 (control byte) + 8 (status vector)
 */
 const uint16_t ENC28J60_RCV_BUFFER_SIZE = 6666;
-
-/* Instructions */
-const uint8_t ENC28J60_RCR = 0x00; /* Read Control Register */
-const uint8_t ENC28J60_RBM = 0x20; /* Read Buffer Memory */
-const uint8_t ENC28J60_WCR = 0x40; /* Write Control Register */
-const uint8_t ENC28J60_WBM = 0x60; /* Write Buffer Memory */
-const uint8_t ENC28J60_BFS = 0x80; /* Bit Field Set */
-const uint8_t ENC28J60_BFC = 0xA0; /* Bit Field Clear */
-const uint8_t ENC28J60_SRC = 0xE0; /* System Reset Command (Soft Reset) */
-
-const uint8_t ENC28J60_BM_ARG = 0x1A; /* RBM/WBM Argument */
-const uint8_t ENC28J60_SRC_ARG = 0x1F; /* SRC Argument */
-
-/* Common Control Registers */
-const uint8_t ENC28J60_EIE = 0x1B;
-const uint8_t ENC28J60_EIR = 0x1C;
-const uint8_t ENC28J60_ESTAT = 0x1D;
-const uint8_t ENC28J60_ECON2 = 0x1E;
-const uint8_t ENC28J60_ECON1 = 0x1F;
-
-/* Bank 0 Control Registers */
-const uint8_t ENC28J60_ERDPT = 0x00;
-const uint8_t ENC28J60_EWRPT = 0x02;
-const uint8_t ENC28J60_ETXST = 0x04;
-const uint8_t ENC28J60_ETXND = 0x06;
-const uint8_t ENC28J60_ERXST = 0x08;
-const uint8_t ENC28J60_ERXND = 0x0A;
-const uint8_t ENC28J60_ERXRDPT = 0x0C;
-const uint8_t ENC28J60_ERXWRPT = 0x0E;
-const uint8_t ENC28J60_EDMAST = 0x10;
-const uint8_t ENC28J60_EDMAND = 0x12;
-const uint8_t ENC28J60_EDMADST = 0x14;
-const uint8_t ENC28J60_EDMACS = 0x06;
-
-/* Bank 1 Control Registers */
-const uint8_t ENC28J60_EHT = 0x00;
-const uint8_t ENC28J60_EPMM = 0x08;
-const uint8_t ENC28J60_EPMCS = 0x10;
-const uint8_t ENC28J60_EPMO = 0x14;
-const uint8_t ENC28J60_ERXFCON = 0x18;
-const uint8_t ENC28J60_EPKTCNT = 0x19;
-
-/* Bank 2 Control Registers */
-const uint8_t ENC28J60_MACON1 = 0x00;
-const uint8_t ENC28J60_MACON3 = 0x02;
-const uint8_t ENC28J60_MACON4 = 0x03;
-const uint8_t ENC28J60_MABBIPG = 0x04;
-const uint8_t ENC28J60_MAIPG = 0x06;
-const uint8_t ENC28J60_MACLCON1 = 0x08;
-const uint8_t ENC28J60_MACLCON2 = 0x09;
-const uint8_t ENC28J60_MAMXFL = 0x0A;
-const uint8_t ENC28J60_MICMD = 0x12;
-const uint8_t ENC28J60_MIREGADR = 0x14;
-const uint8_t ENC28J60_MIWR = 0x16;
-const uint8_t ENC28J60_MIRD = 0x18;
-
-/* Bank 3 Control Registers */
-const uint8_t ENC28J60_MAADR5 = 0x00;
-const uint8_t ENC28J60_MAADR6 = 0x01;
-const uint8_t ENC28J60_MAADR3 = 0x02;
-const uint8_t ENC28J60_MAADR4 = 0x03;
-const uint8_t ENC28J60_MAADR1 = 0x04;
-const uint8_t ENC28J60_MAADR2 = 0x05;
-const uint8_t ENC28J60_EBSTD = 0x06;
-const uint8_t ENC28J60_EBSTCON = 0x07;
-const uint8_t ENC28J60_EBSTCS = 0x08;
-const uint8_t ENC28J60_MISTAT = 0x0A;
-const uint8_t ENC28J60_EREVID = 0x12;
-const uint8_t ENC28J60_ECOCON = 0x15;
-const uint8_t ENC28J60_EFLOCON = 0x17;
-const uint8_t ENC28J60_EPAUS = 0x18;
-
-/* PHY Registers */
-const uint8_t ENC28J60_PHCON1 = 0x00;
-const uint8_t ENC28J60_PHSTAT1 = 0x01;
-const uint8_t ENC28J60_PHID1 = 0x02;
-const uint8_t ENC28J60_PHID2 = 0x03;
-const uint8_t ENC28J60_PHCON2 = 0x10;
-const uint8_t ENC28J60_PHSTAT2 = 0x11;
-const uint8_t ENC28J60_PHIE = 0x12;
-const uint8_t ENC28J60_PHIR = 0x13;
-const uint8_t ENC28J60_PHLCON = 0x14;
-
-/* Register Bits */
-const uint8_t ENC28J60_UCEN = 0x80;
-const uint8_t ENC28J60_ANDOR = 0x40;
-const uint8_t ENC28J60_CRCEN = 0x20;
-const uint8_t ENC28J60_PMEN = 0x10;
-const uint8_t ENC28J60_MPEN = 0x08;
-const uint8_t ENC28J60_HTEN = 0x04;
-const uint8_t ENC28J60_MCEN = 0x02;
-const uint8_t ENC28J60_BCEN = 0x01;
-
-const uint8_t ENC28J60_TXPAUS = 0x08;
-const uint8_t ENC28J60_RXPAUS = 0x04;
-const uint8_t ENC28J60_PASSALL = 0x02;
-const uint8_t ENC28J60_MARXEN = 0x01;
-
-const uint8_t ENC28J60_PADCFG_64 = 0xE0;
-const uint8_t ENC28J60_PADCFG_NO = 0xC0;
-const uint8_t ENC28J60_PADCFG_VLAN = 0xA0;
-const uint8_t ENC28J60_PADCFG_60 = 0x20;
-const uint8_t ENC28J60_TXCRCEN = 0x10;
-const uint8_t ENC28J60_PHDREN = 0x08;
-const uint8_t ENC28J60_HFRMEN = 0x04;
-const uint8_t ENC28J60_FRMLNEN = 0x02;
-const uint8_t ENC28J60_FULDPX = 0x01;
-
-const uint16_t ENC28J60_FRCLNK = 0x0400;
-const uint16_t ENC28J60_TXDIS = 0x0200;
-const uint16_t ENC28J60_JABBER = 0x0400;
-const uint16_t ENC28J60_HDLDIS = 0x0100;
-
-const uint8_t ENC28J60_INTIE = 0x80;
-const uint8_t ENC28J60_PKTIE = 0x40;
-const uint8_t ENC28J60_DMAIE = 0x20;
-const uint8_t ENC28J60_LINKIE = 0x10;
-const uint8_t ENC28J60_TXIE = 0x08;
-const uint8_t ENC28J60_TXERIE = 0x02;
-const uint8_t ENC28J60_RXERIE = 0x01;
-
-const uint8_t ENC28J60_TXRST = 0x80;
-const uint8_t ENC28J60_RXRST = 0x40;
-const uint8_t ENC28J60_DMAST = 0x20;
-const uint8_t ENC28J60_CSUMEN = 0x10;
-const uint8_t ENC28J60_TXRTS = 0x08;
-const uint8_t ENC28J60_RXEN = 0x04;
-
-const uint8_t ENC28J60_PKTIF = 0x40;
-const uint8_t ENC28J60_DMAIF = 0x20;
-const uint8_t ENC28J60_LINKIF = 0x10;
-const uint8_t ENC28J60_TXIF = 0x08;
-const uint8_t ENC28J60_TXERIF = 0x02;
-const uint8_t ENC28J60_RXERIF = 0x01;
-
-const uint8_t ENC28J60_AUTOINC = 0x80;
-const uint8_t ENC28J60_PKTDEC = 0x40;
-const uint8_t ENC28J60_PWRSV = 0x20;
-const uint8_t ENC28J60_VRPS = 0x08;
-
-const uint8_t ENC28J60_DEFER = 0x40;
-
-const uint8_t ENC28J60_MIIRD = 0x01;
-
-const uint8_t ENC28J60_INT = 0x80;
-const uint8_t ENC28J60_BUFER = 0x40;
-const uint8_t ENC28J60_LATECOL = 0x10;
-const uint8_t ENC28J60_RXBUSY = 0x04;
-const uint8_t ENC28J60_TXABRT = 0x02;
-const uint8_t ENC28J60_CLKRDY = 0x01;
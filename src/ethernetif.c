@@ -1,18 +1,32 @@
 #include "lwip/def.h"
 #include "lwip/etharp.h"
 #include "lwip/ethip6.h"
+#include "lwip/ip.h"
 #include "lwip/mem.h"
 #include "lwip/opt.h"
 #include "lwip/pbuf.h"
+#include "lwip/prot/tcp.h"
 #include "lwip/snmp.h"
 #include "lwip/stats.h"
 #include "netif/ppp/pppoe.h"
 
+#include <stdbool.h>
+#include <string.h>
+
+#include <hardware/timer.h>
+
+#include <pico/enc28j60/capture.h>
+#include <pico/enc28j60/cmdlist.h>
 #include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/ethernetif.h>
+#include <pico/enc28j60/txcache.h>
 
 #define IFNAME0 'e'
 #define IFNAME1 'n'
 
+/* Ethernet, largest IPv4 and largest TCP header */
+#define TCP_CACHE_HEADERS (SIZEOF_ETH_HDR + 60 + 60)
+
 static void ethernetif_input(struct netif *netif);
 
 /**
@@ -25,7 +39,7 @@ static void ethernetif_input(struct netif *netif);
 static void
 low_level_init(struct netif *netif)
 {
-	const struct enc28j60 *eth = netif->state;
+	struct enc28j60 *eth = netif->state;
 
 	/* set MAC hardware address length */
 	netif->hwaddr_len = ETHARP_HWADDR_LEN;
@@ -62,43 +76,189 @@ low_level_init(struct netif *netif)
 }
 
 /**
- * This function should do the actual transmission of the packet. The packet is
- * contained in the pbuf that is passed to the function. This pbuf
- * might be chained.
+ * Copy the headers of a frame carrying a TCP segment over IPv4.
  *
- * @param netif the lwip network interface structure for this ethernetif
- * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
- * @return ERR_OK if the packet could be sent
- *			 an err_t value if the packet couldn't be sent
+ * @param p the frame to parse
+ * @param headers buffer for TCP_CACHE_HEADERS bytes of headers
+ * @param len where the number of copied bytes will be written to
+ * @return offset of the TCP header, 0 if the frame carries no TCP segment
+ */
+static u16_t
+tcp_headers(struct pbuf *p, u8_t *headers, u16_t *len)
+{
+	*len = pbuf_copy_partial(p, headers, TCP_CACHE_HEADERS, 0);
+	if (*len < SIZEOF_ETH_HDR + 40 || headers[12] != 0x08 || headers[13] != 0x00 || headers[23] != IP_PROTO_TCP) {
+		return 0;
+	}
+
+	u16_t tcp = SIZEOF_ETH_HDR + (headers[14] & 0x0F) * 4;
+	if (tcp + 20 > *len) {
+		return 0;
+	}
+	return tcp;
+}
+
+/**
+ * Find out whether a TCP segment carries a payload worth caching and build
+ * its retransmit cache key.
  *
- * @note Returning ERR_MEM here if a DMA queue of your MAC is full can lead to
- *		 strange results. You might consider waiting for space in the DMA queue
- *		 to become available since the stack doesn't retry to send a packet
- *		 dropped because of memory failure (except for the TCP timers).
+ * @param p the frame carrying the segment
+ * @param headers headers of the frame, as copied by tcp_headers()
+ * @param len number of copied header bytes
+ * @param tcp offset of the TCP header
+ * @param key buffer for ENC28J60_TXCACHE_KEY bytes of key
+ * @param payload_len where the TCP payload length will be written to
+ * @return length of the headers, 0 if the frame carries no cacheable payload
  */
+static u16_t
+tcp_cache_key(struct pbuf *p, const u8_t *headers, u16_t len, u16_t tcp, u8_t *key, u16_t *payload_len)
+{
+	u16_t header_len = tcp + (headers[tcp + 12] >> 4) * 4;
+	u16_t frame_len = SIZEOF_ETH_HDR + (headers[16] << 8 | headers[17]);
+	if (header_len > len || frame_len > p->tot_len || frame_len < header_len + ENC28J60_TXCACHE_MIN_PAYLOAD) {
+		return 0;
+	}
+	*payload_len = frame_len - header_len;
 
-static err_t
-low_level_output(struct netif *netif, struct pbuf *p)
+	/* Addresses, ports and sequence number */
+	MEMCPY(&key[0], &headers[26], 8);
+	MEMCPY(&key[8], &headers[tcp], 8);
+
+	return header_len;
+}
+
+/**
+ * Release the retransmit cache entries a TCP segment makes stale: payloads
+ * acknowledged by the peer, and all payloads of a connection being opened
+ * or reset, so a new connection on the same addresses and ports starts
+ * with none.
+ *
+ * @param cache the retransmit cache
+ * @param headers headers of the frame, as copied by tcp_headers()
+ * @param tcp offset of the TCP header
+ * @param inbound whether the segment was received rather than sent
+ */
+static void
+tcp_cache_update(struct enc28j60_txcache *cache, const u8_t *headers, u16_t tcp, bool inbound)
+{
+	u8_t connection[ENC28J60_TXCACHE_CONNECTION];
+	u8_t flags = headers[tcp + 13];
+
+	/* Cache keys start with the addresses and ports of the sending side */
+	if (inbound) {
+		MEMCPY(&connection[0], &headers[30], 4);
+		MEMCPY(&connection[4], &headers[26], 4);
+		MEMCPY(&connection[8], &headers[tcp + 2], 2);
+		MEMCPY(&connection[10], &headers[tcp], 2);
+	} else {
+		MEMCPY(&connection[0], &headers[26], 8);
+		MEMCPY(&connection[8], &headers[tcp], 4);
+	}
+
+	if (flags & (TCP_SYN | TCP_RST)) {
+		enc28j60_txcache_invalidate(cache, connection);
+	} else if (inbound && (flags & TCP_ACK)) {
+		const u8_t *ack = &headers[tcp + 8];
+		enc28j60_txcache_ack(cache, connection, (u32_t) ack[0] << 24 | ack[1] << 16 | ack[2] << 8 | ack[3]);
+	}
+}
+
+/**
+ * Record a frame in the capture of the interface, if there is one.
+ *
+ * @param eth the instance the frame was received or sent on
+ * @param p the frame, without padding word
+ * @param flags ENC28J60_CAPTURE_INBOUND or ENC28J60_CAPTURE_OUTBOUND
+ */
+static void
+capture_frame(struct enc28j60 *eth, struct pbuf *p, u32_t flags)
 {
-	const struct enc28j60 *eth = netif->state;
 	struct pbuf *q;
 
-	/* Initiate transfer */
-	enc28j60_transfer_init(eth);
+	if (eth->capture == NULL
+			|| !enc28j60_capture_begin(eth->capture, p->payload, p->len, p->tot_len, time_us_64(), flags)) {
+		return;
+	}
+
+	for (q = p; q != NULL; q = q->next) {
+		enc28j60_capture_append(eth->capture, q->payload, q->len);
+	}
+	enc28j60_capture_commit(eth->capture);
+}
+
+/**
+ * Write a packet to the transmit buffer and transmit it.
+ * Retransmissions found in the retransmit cache are completed from chip SRAM.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param p the MAC packet to send
+ * @param wait block until the packet is transmitted
+ */
+void
+ethernetif_transmit(struct netif *netif, struct pbuf *p, bool wait)
+{
+	struct enc28j60 *eth = netif->state;
+	struct pbuf *q;
+	u8_t headers[TCP_CACHE_HEADERS];
+	u8_t key[ENC28J60_TXCACHE_KEY];
+	u16_t tcp = 0;
+	u16_t headers_len = 0;
+	u16_t header_len = 0;
+	u16_t payload_len = 0;
+	u16_t cached = ENC28J60_SRAM_NONE;
 
 	#if ETH_PAD_SIZE
 	pbuf_remove_header(p, ETH_PAD_SIZE); /* drop the padding word */
 	#endif
 
-	for (q = p; q != NULL; q = q->next) {
-	/* Send the data from the pbuf to the interface, one pbuf at a
-		time. The size of the data in each pbuf is kept in the ->len
-		variable. */
-		enc28j60_transfer_write(eth, q->payload, q->len);
+	/* Initiate transfer, with a command list the cache lookup runs while the transmit buffer is set up */
+	if (eth->cmdlist != NULL) {
+		enc28j60_transfer_init_submit(eth, eth->cmdlist);
+	} else {
+		enc28j60_transfer_init(eth);
+	}
+
+	if (eth->tx_cache != NULL) {
+		tcp = tcp_headers(p, headers, &headers_len);
+		if (tcp) {
+			tcp_cache_update(eth->tx_cache, headers, tcp, false);
+			header_len = tcp_cache_key(p, headers, headers_len, tcp, key, &payload_len);
+		}
+		if (header_len) {
+			cached = enc28j60_txcache_lookup(eth->tx_cache, key, payload_len);
+		}
+	}
+
+	if (eth->cmdlist != NULL) {
+		enc28j60_transfer_init_complete(eth, eth->cmdlist);
+	}
+
+	if (cached != ENC28J60_SRAM_NONE) {
+		/* Retransmission: fresh headers, the payload is copied on the chip */
+		enc28j60_transfer_write(eth, headers, header_len);
+		enc28j60_transfer_copy(eth, cached, payload_len);
+	} else {
+		for (q = p; q != NULL; q = q->next) {
+		/* Send the data from the pbuf to the interface, one pbuf at a
+			time. The size of the data in each pbuf is kept in the ->len
+			variable. */
+			enc28j60_transfer_write(eth, q->payload, q->len);
+		}
 	}
 
 	/* signal that packet should be sent */
-	enc28j60_transfer_send(eth);
+	if (wait) {
+		enc28j60_transfer_send(eth);
+	} else {
+		enc28j60_transfer_start(eth);
+	}
+
+	capture_frame(eth, p, ENC28J60_CAPTURE_OUTBOUND);
+
+	if (header_len && cached == ENC28J60_SRAM_NONE) {
+		/* The payload is still in the transmit buffer, after the control byte and the headers */
+		enc28j60_txcache_store(eth->tx_cache, key, enc28j60_rx_buffer_size(eth) + 1 + header_len, payload_len);
+	}
 
 	MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len);
 	if (((u8_t *)p->payload)[0] & 1) {
@@ -115,28 +275,225 @@ low_level_output(struct netif *netif, struct pbuf *p)
 	#endif
 
 	LINK_STATS_INC(link.xmit);
+}
+
+/**
+ * Pick the next packet to transmit: strict priority classes in class order,
+ * then the weighted classes by deficit round robin.
+ *
+ * @return index of the class to dequeue from, ETHERNETIF_TX_CLASSES if all queues are empty
+ */
+static u8_t
+tx_schedule(struct ethernetif_tx_scheduler *scheduler)
+{
+	bool weighted = false;
+
+	for (u8_t i = 0; i < ETHERNETIF_TX_CLASSES; i++) {
+		struct ethernetif_tx_class *class = &scheduler->classes[i];
+		if (class->depth) {
+			if (class->strict) {
+				return i;
+			}
+			weighted = true;
+		}
+	}
+	if (!weighted) {
+		return ETHERNETIF_TX_CLASSES;
+	}
+
+	for (;;) {
+		struct ethernetif_tx_class *class = &scheduler->classes[scheduler->current];
+		if (!class->strict && class->depth) {
+			u16_t len = class->queue[class->head]->tot_len;
+			if (class->deficit >= len) {
+				class->deficit -= len;
+				return scheduler->current;
+			}
+			class->deficit += class->quantum ? class->quantum : ETHERNETIF_TX_QUANTUM;
+		} else {
+			class->deficit = 0;
+		}
+		scheduler->current = (scheduler->current + 1) % ETHERNETIF_TX_CLASSES;
+	}
+}
+
+/**
+ * Default packet classifier: ARP and network control traffic first, then
+ * expedited forwarding and small packets (such as pure TCP ACKs), then
+ * best effort, then lower effort (DSCP CS1) bulk traffic.
+ */
+u8_t
+ethernetif_tx_classify(struct netif *netif, struct pbuf *p)
+{
+	LWIP_UNUSED_ARG(netif);
+
+	u16_t type = pbuf_get_at(p, ETH_PAD_SIZE + 12) << 8 | pbuf_get_at(p, ETH_PAD_SIZE + 13);
+	if (type == ETHTYPE_ARP) {
+		return 0;
+	}
+
+	if (type == ETHTYPE_IP) {
+		u8_t dscp = pbuf_get_at(p, ETH_PAD_SIZE + SIZEOF_ETH_HDR + 1) >> 2;
+		if (dscp >= 48) {
+			return 0;
+		}
+		if (dscp == 46) {
+			return 1;
+		}
+		if (dscp == 8) {
+			return 3;
+		}
+	}
+
+	return p->tot_len <= ETH_PAD_SIZE + ETHERNETIF_TX_SMALL ? 1 : 2;
+}
+
+void
+ethernetif_tx_scheduler_init(struct ethernetif_tx_scheduler *scheduler)
+{
+	memset(scheduler, 0, sizeof(*scheduler));
+
+	scheduler->classes[0].strict = 1;
+	scheduler->classes[1].strict = 1;
+	scheduler->classes[2].quantum = 3 * ETHERNETIF_TX_QUANTUM;
+	scheduler->classes[3].quantum = ETHERNETIF_TX_QUANTUM;
+}
+
+/**
+ * Transmit the next queued packet if the transmit buffer is free.
+ * Called on every output, call it also from the main loop (or after a
+ * TXIF interrupt) to drain the queues.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ */
+void
+ethernetif_tx_poll(struct netif *netif)
+{
+	struct enc28j60 *eth = netif->state;
+	struct ethernetif_tx_scheduler *scheduler = eth->tx_scheduler;
+
+	if (enc28j60_transfer_busy(eth)) {
+		return;
+	}
+
+	u8_t i = tx_schedule(scheduler);
+	if (i == ETHERNETIF_TX_CLASSES) {
+		return;
+	}
+
+	struct ethernetif_tx_class *class = &scheduler->classes[i];
+	struct pbuf *p = class->queue[class->head];
+	u32_t latency = time_us_32() - class->stamps[class->head];
+	class->head = (class->head + 1) % ETHERNETIF_TX_QUEUE_DEPTH;
+	class->depth--;
+
+	class->latency_us += latency;
+	if (latency > class->max_latency_us) {
+		class->max_latency_us = latency;
+	}
+	class->sent++;
+
+	ethernetif_transmit(netif, p, false);
+	pbuf_free(p);
+}
+
+/**
+ * Keep a packet beyond the linkoutput call, for example in a queue.
+ * Data the caller may reuse once the call returns (PBUF_REF, PBUF_ROM
+ * anywhere in the chain, like a PBUF_REF payload behind the headers) is
+ * copied, otherwise a reference is taken.
+ *
+ * @param p the packet passed to linkoutput
+ * @return the packet to keep and free later, NULL if the copy failed
+ */
+struct pbuf *
+ethernetif_hold(struct pbuf *p)
+{
+	struct pbuf *q;
+
+	for (q = p; q != NULL; q = q->next) {
+		if (PBUF_NEEDS_COPY(q)) {
+			return pbuf_clone(PBUF_RAW, PBUF_RAM, p);
+		}
+	}
+
+	pbuf_ref(p);
+	return p;
+}
+
+/**
+ * This function should do the actual transmission of the packet. The packet is
+ * contained in the pbuf that is passed to the function. This pbuf
+ * might be chained.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+ * @return ERR_OK if the packet could be sent
+ *			 an err_t value if the packet couldn't be sent
+ *
+ * @note Returning ERR_MEM here if a DMA queue of your MAC is full can lead to
+ *		 strange results. You might consider waiting for space in the DMA queue
+ *		 to become available since the stack doesn't retry to send a packet
+ *		 dropped because of memory failure (except for the TCP timers).
+ */
+
+static err_t
+low_level_output(struct netif *netif, struct pbuf *p)
+{
+	struct enc28j60 *eth = netif->state;
+	struct ethernetif_tx_scheduler *scheduler = eth->tx_scheduler;
+
+	if (scheduler == NULL) {
+		ethernetif_transmit(netif, p, true);
+		return ERR_OK;
+	}
+
+	u8_t i = scheduler->classify != NULL ? scheduler->classify(netif, p) : ethernetif_tx_classify(netif, p);
+	struct ethernetif_tx_class *class = &scheduler->classes[i % ETHERNETIF_TX_CLASSES];
+	if (class->depth == ETHERNETIF_TX_QUEUE_DEPTH) {
+		class->dropped++;
+		LINK_STATS_INC(link.drop);
+		MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+		return ERR_MEM;
+	}
+
+	p = ethernetif_hold(p);
+	if (p == NULL) {
+		LINK_STATS_INC(link.memerr);
+		LINK_STATS_INC(link.drop);
+		MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+		return ERR_MEM;
+	}
+
+	u8_t tail = (class->head + class->depth) % ETHERNETIF_TX_QUEUE_DEPTH;
+	class->queue[tail] = p;
+	class->stamps[tail] = time_us_32();
+	class->depth++;
+	class->enqueued++;
+	if (class->depth > class->max_depth) {
+		class->max_depth = class->depth;
+	}
+
+	ethernetif_tx_poll(netif);
 
 	return ERR_OK;
 }
 
 /**
- * Should allocate a pbuf and transfer the bytes of the incoming
- * packet from the interface into the pbuf.
+ * Should allocate a pbuf and transfer the bytes of the packet, which
+ * reception has been started already, from the interface into the pbuf.
+ * The packet is acknowledged afterwards.
  *
  * @param netif the lwip network interface structure for this ethernetif
+ * @param len length of the packet as returned from enc28j60_receive_init
  * @return a pbuf filled with the received packet (including MAC header)
  *			 NULL on memory error
  */
 struct pbuf *
-low_level_input(const struct netif *netif)
+low_level_read(const struct netif *netif, u16_t len)
 {
 	struct enc28j60 *eth = netif->state;
 	struct pbuf *p, *q;
-	u16_t len;
-
-	/* Obtain the size of the packet and put it into the "len"
-	 variable. */
-	len = enc28j60_receive_init(eth);
 
 #if ETH_PAD_SIZE
 	len += ETH_PAD_SIZE; /* allow room for Ethernet padding */
@@ -165,8 +522,23 @@ low_level_input(const struct netif *netif)
 			enc28j60_receive_read(eth, q->payload, q->len);
 		}
 
-		/* acknowledge that packet has been read */
-		enc28j60_receive_ack(eth);
+		/* acknowledge that packet has been read, with a command list the frame is captured meanwhile */
+		if (eth->cmdlist != NULL) {
+			enc28j60_receive_ack_submit(eth, eth->cmdlist);
+		} else {
+			enc28j60_receive_ack(eth);
+		}
+
+		capture_frame(eth, p, ENC28J60_CAPTURE_INBOUND);
+
+		if (eth->tx_cache != NULL) {
+			u8_t headers[TCP_CACHE_HEADERS];
+			u16_t headers_len;
+			u16_t tcp = tcp_headers(p, headers, &headers_len);
+			if (tcp) {
+				tcp_cache_update(eth->tx_cache, headers, tcp, true);
+			}
+		}
 
 		MIB2_STATS_NETIF_ADD(netif, ifinoctets, p->tot_len);
 		if (((u8_t *)p->payload)[0] & 1) {
@@ -176,13 +548,21 @@ low_level_input(const struct netif *netif)
 			/* unicast packet*/
 			MIB2_STATS_NETIF_INC(netif, ifinucastpkts);
 		}
+
+		if (eth->cmdlist != NULL) {
+			enc28j60_receive_ack_complete(eth, eth->cmdlist);
+		}
 		#if ETH_PAD_SIZE
 		pbuf_add_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
 		#endif
 
 		LINK_STATS_INC(link.recv);
 	} else {
-		enc28j60_receive_ack(eth);
+		if (eth->cmdlist != NULL) {
+			enc28j60_receive_ack_batched(eth, eth->cmdlist);
+		} else {
+			enc28j60_receive_ack(eth);
+		}
 		LINK_STATS_INC(link.memerr);
 		LINK_STATS_INC(link.drop);
 		MIB2_STATS_NETIF_INC(netif, ifindiscards);
@@ -191,6 +571,26 @@ low_level_input(const struct netif *netif)
 	return p;
 }
 
+/**
+ * Should allocate a pbuf and transfer the bytes of the incoming
+ * packet from the interface into the pbuf.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @return a pbuf filled with the received packet (including MAC header)
+ *			 NULL on memory error
+ */
+struct pbuf *
+low_level_input(const struct netif *netif)
+{
+	struct enc28j60 *eth = netif->state;
+
+	/* Obtain the size of the packet */
+	if (eth->cmdlist != NULL) {
+		return low_level_read(netif, enc28j60_receive_init_batched(eth, eth->cmdlist));
+	}
+	return low_level_read(netif, enc28j60_receive_init(eth));
+}
+
 /**
  * This function should be called when a packet is ready to be read
  * from the interface. It uses the function low_level_input() that
@@ -218,6 +618,36 @@ ethernetif_input(struct netif *netif)
 	}
 }
 
+/**
+ * Find the MAC address frames to an IPv4 destination have to be sent to,
+ * for senders bypassing lwIP such as enc28j60_udp_stream.
+ * Off-link destinations are resolved to the gateway of the interface.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param ipaddr destination address
+ * @param mac_address a six byte buffer, where the MAC address will be written to
+ * @return ERR_OK if the address is in the ARP cache,
+ *			 ERR_INPROGRESS if an ARP request was sent, call again later
+ */
+err_t
+ethernetif_resolve(struct netif *netif, const ip4_addr_t *ipaddr, u8_t *mac_address)
+{
+	struct eth_addr *eth_ret;
+	const ip4_addr_t *ip_ret;
+
+	if (!ip4_addr_netcmp(ipaddr, netif_ip4_addr(netif), netif_ip4_netmask(netif))) {
+		ipaddr = netif_ip4_gw(netif);
+	}
+
+	if (etharp_find_addr(netif, ipaddr, &eth_ret, &ip_ret) >= 0) {
+		MEMCPY(mac_address, eth_ret->addr, ETH_HWADDR_LEN);
+		return ERR_OK;
+	}
+
+	etharp_query(netif, ipaddr, NULL);
+	return ERR_INPROGRESS;
+}
+
 /**
  * Should be called at the beginning of the program to set up the
  * network interface. It calls the function low_level_init() to do the
@@ -0,0 +1,268 @@
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/snmp.h"
+#include "lwip/stats.h"
+#include "lwip/tcpip.h"
+#include "netif/ethernet.h"
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <task.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/ethernetif.h>
+#include <pico/enc28j60/ethernetif_rtos.h>
+#include <pico/enc28j60/irq.h>
+
+/* Packet queued for the driver task */
+struct ethernetif_rtos_tx {
+	struct pbuf *p;
+	TaskHandle_t waiter;  /* Task to notify on completion, NULL if nobody waits */
+};
+
+/**
+ * Pass the queued frames to lwIP. Runs in the TCP/IP thread, once per
+ * batch posted by the driver task.
+ */
+static void
+ethernetif_rtos_deliver(void *context)
+{
+	struct ethernetif_rtos *rtos = context;
+	struct pbuf *p;
+
+	/* Frames queued after this point are posted again */
+	taskENTER_CRITICAL();
+	rtos->rx_posted = false;
+	taskEXIT_CRITICAL();
+
+	while (xQueueReceive(rtos->rx_queue, &p, 0) == pdPASS) {
+		if (ethernet_input(p, rtos->netif) != ERR_OK) {
+			LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_rtos_deliver: IP input error\n"));
+			pbuf_free(p);
+		}
+	}
+
+	/* There is room for frames left in the ENC28J60 again */
+	xTaskNotifyGive(rtos->task);
+}
+
+/**
+ * Post the queued frames to the TCP/IP thread unless a batch is posted
+ * already.
+ *
+ * @return false if the TCP/IP mailbox is full
+ */
+static bool
+ethernetif_rtos_post(struct ethernetif_rtos *rtos)
+{
+	taskENTER_CRITICAL();
+	bool post = !rtos->rx_posted && uxQueueMessagesWaiting(rtos->rx_queue);
+	if (post) {
+		rtos->rx_posted = true;
+	}
+	taskEXIT_CRITICAL();
+
+	if (!post) {
+		return true;
+	}
+
+	if (tcpip_callbackmsg_trycallback(rtos->rx_message) != ERR_OK) {
+		taskENTER_CRITICAL();
+		rtos->rx_posted = false;
+		taskEXIT_CRITICAL();
+		return false;
+	}
+
+	rtos->rx_batches++;
+	return true;
+}
+
+/**
+ * Read up to a batch of frames into the receive queue.
+ *
+ * @return true if frames are left in the receive buffer and there is room for them
+ */
+static bool
+ethernetif_rtos_receive(struct ethernetif_rtos *rtos)
+{
+	struct enc28j60 *eth = rtos->netif->state;
+	u8_t count = 0;
+	UBaseType_t space = uxQueueSpacesAvailable(rtos->rx_queue);
+	u8_t pending = enc28j60_reg_read(eth, ENC28J60_REG_EPKTCNT);
+
+	while (pending && count < rtos->rx_batch && space) {
+		struct pbuf *p = low_level_input(rtos->netif);
+		if (p != NULL) {
+			xQueueSend(rtos->rx_queue, &p, 0);
+			space--;
+			count++;
+		}
+		pending--;
+	}
+	rtos->rx_frames += count;
+
+	/* Without space the TCP/IP thread restarts the task once it has drained the queue */
+	return pending && space;
+}
+
+/**
+ * Transmit the queued packets and signal their completion.
+ */
+static void
+ethernetif_rtos_transmit(struct ethernetif_rtos *rtos)
+{
+	struct ethernetif_rtos_tx request;
+
+	while (xQueueReceive(rtos->tx_queue, &request, 0) == pdPASS) {
+		ethernetif_transmit(rtos->netif, request.p, true);
+		pbuf_free(request.p);
+		rtos->tx_packets++;
+
+		if (request.waiter != NULL) {
+			xTaskNotifyGiveIndexed(request.waiter, rtos->tx_notify_index);
+		}
+	}
+}
+
+static void
+ethernetif_rtos_task(void *argument)
+{
+	struct ethernetif_rtos *rtos = argument;
+	struct enc28j60 *eth = rtos->netif->state;
+	TickType_t timeout = portMAX_DELAY;
+
+	enc28j60_interrupts(eth, ENC28J60_PKTIE | ENC28J60_TXERIE | ENC28J60_RXERIE);
+
+	for (;;) {
+		ulTaskNotifyTake(pdTRUE, timeout);
+
+		/* Transmit first, so queued packets are not held back by a flood of received frames */
+		ethernetif_rtos_transmit(rtos);
+
+		enc28j60_isr_begin(eth);
+		u8_t flags = enc28j60_interrupt_flags(eth);
+
+		if (flags & ENC28J60_PKTIF) {
+			if (ethernetif_rtos_receive(rtos)) {
+				/* Come back for the rest after serving the transmit queue */
+				xTaskNotifyGive(rtos->task);
+			}
+		}
+
+		/* With the TCP/IP mailbox full, retry on the next tick */
+		timeout = ethernetif_rtos_post(rtos) ? portMAX_DELAY : 1;
+
+		if (flags & ENC28J60_TXERIF) {
+			LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_rtos_task: transmit error\n"));
+		}
+
+		if (flags & ENC28J60_RXERIF) {
+			LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_rtos_task: receive error\n"));
+			LINK_STATS_INC(link.drop);
+		}
+
+		enc28j60_interrupt_clear(eth, flags);
+		enc28j60_isr_end(eth);
+	}
+}
+
+static void
+ethernetif_rtos_irq(struct enc28j60 *eth, void *context)
+{
+	struct ethernetif_rtos *rtos = context;
+	BaseType_t woken = pdFALSE;
+
+	LWIP_UNUSED_ARG(eth);
+
+	vTaskNotifyGiveFromISR(rtos->task, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
+/**
+ * linkoutput of interfaces served by a driver task: queue the packet and
+ * wake the task.
+ */
+static err_t
+ethernetif_rtos_output(struct netif *netif, struct pbuf *p)
+{
+	struct enc28j60 *eth = netif->state;
+	struct ethernetif_rtos *rtos = eth->rtos;
+	struct ethernetif_rtos_tx request = {
+		.p = p,
+		.waiter = rtos->tx_wait ? xTaskGetCurrentTaskHandle() : NULL,
+	};
+
+	/* Without waiting the packet outlives the call, so data the caller may reuse is copied */
+	if (request.waiter == NULL) {
+		request.p = ethernetif_hold(p);
+		if (request.p == NULL) {
+			rtos->tx_dropped++;
+			LINK_STATS_INC(link.memerr);
+			LINK_STATS_INC(link.drop);
+			MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+			return ERR_MEM;
+		}
+	} else {
+		pbuf_ref(p);
+	}
+
+	if (xQueueSend(rtos->tx_queue, &request, 0) != pdPASS) {
+		pbuf_free(request.p);
+		rtos->tx_dropped++;
+		LINK_STATS_INC(link.drop);
+		MIB2_STATS_NETIF_INC(netif, ifoutdiscards);
+		return ERR_MEM;
+	}
+
+	xTaskNotifyGive(rtos->task);
+	if (request.waiter != NULL) {
+		ulTaskNotifyTakeIndexed(rtos->tx_notify_index, pdTRUE, portMAX_DELAY);
+	}
+
+	return ERR_OK;
+}
+
+bool
+ethernetif_rtos_start(struct ethernetif_rtos *rtos, struct netif *netif)
+{
+	struct enc28j60 *eth = netif->state;
+
+	if (!rtos->priority) {
+		rtos->priority = configMAX_PRIORITIES - 1;
+	}
+	if (!rtos->stack_size) {
+		rtos->stack_size = ETHERNETIF_RTOS_STACK;
+	}
+	if (!rtos->rx_batch) {
+		rtos->rx_batch = ETHERNETIF_RTOS_RX_BATCH;
+	}
+	if (!rtos->tx_queue_length) {
+		rtos->tx_queue_length = ETHERNETIF_RTOS_TX_QUEUE;
+	}
+	rtos->netif = netif;
+	rtos->rx_posted = false;
+
+	rtos->tx_queue = xQueueCreate(rtos->tx_queue_length, sizeof(struct ethernetif_rtos_tx));
+	rtos->rx_queue = xQueueCreate(2 * rtos->rx_batch, sizeof(struct pbuf *));
+	rtos->rx_message = tcpip_callbackmsg_new(ethernetif_rtos_deliver, rtos);
+	if (rtos->tx_queue == NULL || rtos->rx_queue == NULL || rtos->rx_message == NULL) {
+		return false;
+	}
+
+	eth->rtos = rtos;
+	netif->linkoutput = ethernetif_rtos_output;
+
+	#if configUSE_CORE_AFFINITY && configNUMBER_OF_CORES > 1
+	if (rtos->core_affinity) {
+		if (xTaskCreateAffinitySet(ethernetif_rtos_task, "enc28j60", rtos->stack_size, rtos, rtos->priority,
+				rtos->core_affinity, &rtos->task) != pdPASS) {
+			return false;
+		}
+	} else
+	#endif
+	if (xTaskCreate(ethernetif_rtos_task, "enc28j60", rtos->stack_size, rtos, rtos->priority, &rtos->task) != pdPASS) {
+		return false;
+	}
+
+	return enc28j60_irq_add(eth, rtos->int_pin, ethernetif_rtos_irq, rtos);
+}
@@ -0,0 +1,159 @@
+#include <hardware/gpio.h>
+
+#include <hardware/spi.h>
+#include <pico/critical_section.h>
+#include <pico/stdio.h>
+#include <pico/util/queue.h>
+
+#include "lwipopts.h"
+#include <lwip/init.h>
+#include <lwip/netif.h>
+#include <lwip/timeouts.h>
+
+#include <pico/enc28j60/cmdlist.h>
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/ethernetif.h>
+#include <pico/enc28j60/irq.h>
+
+/* Configuration */
+#define SPI_BAUD 2000000
+#define RX_QUEUE_SIZE 20
+
+/* Port A on spi0 */
+#define A_SCK_PIN 2
+#define A_SI_PIN 3
+#define A_SO_PIN 4
+#define A_CS_PIN 5
+#define A_INT_PIN 6
+#define A_MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x92 }
+#define A_IP_ADDRESS IPADDR4_INIT_BYTES(192, 168, 1, 200)
+#define A_NETWORK_MASK IPADDR4_INIT_BYTES(255, 255, 255, 0)
+#define A_GATEWAY_ADDRESS IPADDR4_INIT_BYTES(192, 168, 1, 1)
+
+/* Port B on spi1 */
+#define B_SCK_PIN 10
+#define B_SI_PIN 11
+#define B_SO_PIN 12
+#define B_CS_PIN 13
+#define B_INT_PIN 14
+#define B_MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x93 }
+#define B_IP_ADDRESS IPADDR4_INIT_BYTES(192, 168, 2, 200)
+#define B_NETWORK_MASK IPADDR4_INIT_BYTES(255, 255, 255, 0)
+#define B_GATEWAY_ADDRESS IPADDR4_INIT_BYTES(0, 0, 0, 0)
+
+struct port {
+	struct enc28j60_bus bus;
+	critical_section_t spi_cs;
+	struct enc28j60 enc28j60;
+	struct enc28j60_cmdlist isr_cmdlist;
+	struct netif netif;
+};
+
+struct rx_entry {
+	struct netif *netif;
+	struct pbuf *packet;
+};
+
+queue_t rx_queue;
+struct port port_a = {
+	.bus = { .spi = spi0 },
+	.enc28j60 = {
+		.bus = &port_a.bus,
+		.cs_pin = A_CS_PIN,
+		.mac_address = A_MAC_ADDRESS,
+	},
+};
+struct port port_b = {
+	.bus = { .spi = spi1 },
+	.enc28j60 = {
+		.bus = &port_b.bus,
+		.cs_pin = B_CS_PIN,
+		.mac_address = B_MAC_ADDRESS,
+	},
+};
+
+void
+eth_irq(struct enc28j60 *self, void *context)
+{
+	struct port *port = context;
+	uint8_t flags = enc28j60_isr_begin_batched(self, &port->isr_cmdlist);
+
+	if (flags & ENC28J60_PKTIF) {
+		struct rx_entry entry = { &port->netif, low_level_input(&port->netif) };
+		if (entry.packet != NULL) {
+			if (!queue_try_add(&rx_queue, &entry)) {
+				pbuf_free(entry.packet);
+			}
+		}
+	}
+
+	enc28j60_isr_end_batched(self, &port->isr_cmdlist, flags);
+}
+
+static void
+port_init(struct port *port, uint sck_pin, uint si_pin, uint so_pin, uint int_pin, const struct ip4_addr *ipaddr,
+		const struct ip4_addr *netmask, const struct ip4_addr *gw)
+{
+	gpio_init(port->enc28j60.cs_pin);
+	gpio_set_dir(port->enc28j60.cs_pin, GPIO_OUT);
+	gpio_put(port->enc28j60.cs_pin, 1);
+	gpio_init(int_pin);
+	gpio_set_dir(int_pin, GPIO_IN);
+
+	gpio_set_function(sck_pin, GPIO_FUNC_SPI);
+	gpio_set_function(si_pin, GPIO_FUNC_SPI);
+	gpio_set_function(so_pin, GPIO_FUNC_SPI);
+	spi_init(port->bus.spi, SPI_BAUD);
+
+	/* Separate buses, so the ports are not serialised against each other */
+	critical_section_init(&port->spi_cs);
+	port->bus.critical_section = &port->spi_cs;
+	enc28j60_cmdlist_init(&port->isr_cmdlist);
+
+	netif_add(&port->netif, ipaddr, netmask, gw, &port->enc28j60, ethernetif_init, netif_input);
+	netif_set_up(&port->netif);
+	netif_set_link_up(&port->netif);
+
+	enc28j60_irq_add(&port->enc28j60, int_pin, eth_irq, port);
+	enc28j60_interrupts(&port->enc28j60, ENC28J60_PKTIE);
+}
+
+int
+main()
+{
+	gpio_init(PICO_DEFAULT_LED_PIN);
+	gpio_set_dir(PICO_DEFAULT_LED_PIN, GPIO_OUT);
+	gpio_put(PICO_DEFAULT_LED_PIN, true);
+
+	stdio_init_all();
+
+	queue_init(&rx_queue, sizeof(struct rx_entry), RX_QUEUE_SIZE);
+	lwip_init();
+
+	const struct ip4_addr a_ipaddr = A_IP_ADDRESS;
+	const struct ip4_addr a_netmask = A_NETWORK_MASK;
+	const struct ip4_addr a_gw = A_GATEWAY_ADDRESS;
+	port_init(&port_a, A_SCK_PIN, A_SI_PIN, A_SO_PIN, A_INT_PIN, &a_ipaddr, &a_netmask, &a_gw);
+
+	const struct ip4_addr b_ipaddr = B_IP_ADDRESS;
+	const struct ip4_addr b_netmask = B_NETWORK_MASK;
+	const struct ip4_addr b_gw = B_GATEWAY_ADDRESS;
+	port_init(&port_b, B_SCK_PIN, B_SI_PIN, B_SO_PIN, B_INT_PIN, &b_ipaddr, &b_netmask, &b_gw);
+
+	netif_set_default(&port_a.netif);
+
+	while (true) {
+		struct rx_entry entry;
+		if (queue_try_remove(&rx_queue, &entry)) {
+			if (entry.netif->input(entry.packet, entry.netif) != ERR_OK) {
+				LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
+				pbuf_free(entry.packet);
+			}
+		}
+
+		sys_check_timeouts();
+		gpio_put(PICO_DEFAULT_LED_PIN, false);
+		best_effort_wfe_or_timeout(make_timeout_time_ms(sys_timeouts_sleeptime()));
+		gpio_put(PICO_DEFAULT_LED_PIN, true);
+	}
+}
@@ -0,0 +1,293 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <hardware/clocks.h>
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+#include <hardware/timer.h>
+#include <pico/stdlib.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#if !PICO_ON_DEVICE
+#include <pico/enc28j60/sim.h>
+#endif
+
+/*
+ * Throughput benchmark of the driver.
+ * Frames of every size are written with enc28j60_transfer_*, looped back by the PHY (or sent to a second port
+ * cabled to the first) and read back with enc28j60_receive_*. Both paths are timed separately and every frame is
+ * verified. The same code runs on a board and, built with -DPICO_ENC28J60_HOST=ON, against the simulated chip on
+ * the host, where all figures are derived from the virtual clock and are reproducible.
+ *
+ * Host usage: loopback [-p] [frames [size ...]], -p for a second port instead of PHY loopback.
+ */
+
+/* Configuration */
+#define SPI_BAUD 16000000
+#define SCK_PIN 2
+#define SI_PIN 3
+#define SO_PIN 4
+#define CS_PIN 10
+#define MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x92 }
+#define FRAMES 2000  /* Frames per size */
+#define FRAME_SIZES { 64, 128, 256, 512, 1024, 1518 }  /* Frame lengths including CRC */
+#define RX_TIMEOUT_US 10000  /* Time a looped back frame may take to arrive */
+#define WIRE_BPS 10000000
+#define WIRE_OVERHEAD 20  /* Preamble, start of frame delimiter and inter packet gap, in bytes */
+
+/* Second port, used instead of PHY loopback if SECOND_PORT is 1 */
+#define SECOND_PORT 0
+#define B_SCK_PIN 14
+#define B_SI_PIN 15
+#define B_SO_PIN 12
+#define B_CS_PIN 13
+#define B_MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x93 }
+
+#define MAX_SIZES 16
+
+/* Time and SPI traffic spent in one path */
+struct path {
+	uint64_t us;
+	uint64_t spi_bytes;
+};
+
+struct result {
+	uint16_t size;
+	uint32_t frames;
+	uint32_t lost;
+	uint32_t corrupted;
+	struct path tx;
+	struct path rx;
+};
+
+struct enc28j60 port_a = {
+	.spi = spi0,
+	.cs_pin = CS_PIN,
+	.mac_address = MAC_ADDRESS,
+};
+struct enc28j60 port_b = {
+	.spi = spi1,
+	.cs_pin = B_CS_PIN,
+	.mac_address = B_MAC_ADDRESS,
+};
+
+#if !PICO_ON_DEVICE
+struct enc28j60_sim sim_a = {
+	.spi = spi0,
+	.cs_pin = CS_PIN,
+};
+struct enc28j60_sim sim_b = {
+	.spi = spi1,
+	.cs_pin = B_CS_PIN,
+};
+#endif
+
+static uint8_t frame[1518];
+static uint8_t received[1518];
+
+/*
+ * Loop transmitted frames back in the PHY.
+ * PHY loopback only works in full duplex (errata: the half duplex loopback is not reliable, enc28j60_init sets
+ * PHCON2.HDLDIS for that reason), so PHCON1.PDPXMD and MACON3.FULDPX are set together, with the full duplex back to
+ * back gap. Some silicon revisions corrupt or drop looped frames, which shows up as lost and corrupted frames below
+ * rather than as wrong throughput figures.
+ */
+static void
+loopback_enable(struct enc28j60 *eth)
+{
+	enc28j60_write_phy(eth, ENC28J60_PHCON1, ENC28J60_PLOOPBK | ENC28J60_PDPXMD);
+	enc28j60_reg_write(eth, ENC28J60_REG_MACON3, enc28j60_reg_read(eth, ENC28J60_REG_MACON3) | ENC28J60_FULDPX);
+	enc28j60_reg_write(eth, ENC28J60_REG_MABBIPG, 0x15);
+}
+
+/* Frame from a to b, numbered so losses and stale data are noticed */
+static void
+frame_fill(const struct enc28j60 *tx, const struct enc28j60 *rx, size_t len, uint32_t sequence)
+{
+	memcpy(frame, rx->mac_address, 6);
+	memcpy(&frame[6], tx->mac_address, 6);
+	frame[12] = 0x88;  /* Local experimental EtherType */
+	frame[13] = 0xB5;
+	for (size_t i = 14; i < len; i++) {
+		frame[i] = (uint8_t) (sequence + i);
+	}
+}
+
+static void
+bench_size(struct enc28j60 *tx, struct enc28j60 *rx, struct result *result)
+{
+	/* Sizes include the CRC appended by the chip */
+	size_t len = result->size - 4;
+
+	for (uint32_t i = 0; i < result->frames; i++) {
+		frame_fill(tx, rx, len, i);
+
+		uint32_t spi_bytes = tx->spi_bytes;
+		uint64_t start = time_us_64();
+		enc28j60_transfer_init(tx);
+		enc28j60_transfer_write(tx, frame, len);
+		enc28j60_transfer_send(tx);
+		result->tx.us += time_us_64() - start;
+		result->tx.spi_bytes += tx->spi_bytes - spi_bytes;
+
+		/* Waiting for the wire is not part of the receive path */
+		start = time_us_64();
+		while (!enc28j60_reg_read(rx, ENC28J60_REG_EPKTCNT)) {
+			if (time_us_64() - start > RX_TIMEOUT_US) {
+				break;
+			}
+			sleep_us(1);
+		}
+		if (!enc28j60_reg_read(rx, ENC28J60_REG_EPKTCNT)) {
+			result->lost++;
+			continue;
+		}
+
+		spi_bytes = rx->spi_bytes;
+		start = time_us_64();
+		uint16_t received_len = enc28j60_receive_init(rx);
+		if (received_len && received_len <= sizeof(received)) {
+			enc28j60_receive_read(rx, received, received_len);
+		}
+		enc28j60_receive_ack(rx);
+		result->rx.us += time_us_64() - start;
+		result->rx.spi_bytes += rx->spi_bytes - spi_bytes;
+
+		/* Short frames come back padded */
+		if (received_len < len || memcmp(received, frame, len)) {
+			result->corrupted++;
+		}
+	}
+}
+
+static void
+report_path(const char *name, const struct result *result, const struct path *path, uint32_t frames)
+{
+	double seconds = path->us / 1e6;
+	double spi_seconds = path->spi_bytes * 8.0 / SPI_BAUD;
+	/* Derived from the path time, not counted: on the host clk_sys is a nominal 125 MHz on the virtual clock */
+	double clocks = (double) path->us * (clock_get_hz(clk_sys) / 1e6);
+
+	char spi[8] = "-";
+
+	if (!frames || !path->us) {
+		printf("%5u %s %10s\n", result->size, name, "-");
+		return;
+	}
+
+	/* A path faster than the wire still cannot move more frames than the link carries */
+	double rate = frames / seconds;
+	double wire_rate = WIRE_BPS / ((result->size + WIRE_OVERHEAD) * 8.0);
+	bool wire_limited = rate > wire_rate;
+	if (wire_limited) {
+		rate = wire_rate;
+	}
+
+	/* On the host virtual time only advances with SPI and the wire, so the utilisation would always read 100% */
+	#if PICO_ON_DEVICE
+	snprintf(spi, sizeof(spi), "%.1f", 100.0 * spi_seconds / seconds);
+	#else
+	(void) spi_seconds;
+	#endif
+
+	/* The driver busy-waits on SPI and the wire, so on a board the whole path time is CPU time */
+	printf("%5u %s %10.0f%s %8.2f %6s %12.0f\n", result->size, name, rate, wire_limited ? "*" : " ",
+			rate * result->size * 8.0 / 1e6, spi, clocks / frames);
+}
+
+static void
+report(const struct result *result)
+{
+	report_path("tx", result, &result->tx, result->frames);
+	report_path("rx", result, &result->rx, result->frames - result->lost);
+	if (result->lost || result->corrupted) {
+		printf("      %lu lost, %lu corrupted\n", (unsigned long) result->lost, (unsigned long) result->corrupted);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	uint16_t sizes[MAX_SIZES] = FRAME_SIZES;
+	size_t size_count = sizeof((uint16_t[]) FRAME_SIZES) / sizeof(uint16_t);
+	uint32_t frames = FRAMES;
+	bool second_port = SECOND_PORT;
+
+	#if !PICO_ON_DEVICE
+	int arg = 1;
+	if (arg < argc && !strcmp(argv[arg], "-p")) {
+		second_port = true;
+		arg++;
+	}
+	if (arg < argc) {
+		frames = strtoul(argv[arg++], NULL, 0);
+	}
+	if (arg < argc) {
+		size_count = 0;
+		while (arg < argc && size_count < MAX_SIZES) {
+			unsigned long size = strtoul(argv[arg++], NULL, 0);
+			sizes[size_count++] = size < 64 ? 64 : size > 1518 ? 1518 : size;
+		}
+	}
+	#endif
+
+	stdio_init_all();
+
+	gpio_init(CS_PIN);
+	gpio_set_dir(CS_PIN, GPIO_OUT);
+	gpio_put(CS_PIN, 1);
+	gpio_set_function(SCK_PIN, GPIO_FUNC_SPI);
+	gpio_set_function(SI_PIN, GPIO_FUNC_SPI);
+	gpio_set_function(SO_PIN, GPIO_FUNC_SPI);
+	spi_init(spi0, SPI_BAUD);
+
+	if (second_port) {
+		gpio_init(B_CS_PIN);
+		gpio_set_dir(B_CS_PIN, GPIO_OUT);
+		gpio_put(B_CS_PIN, 1);
+		gpio_set_function(B_SCK_PIN, GPIO_FUNC_SPI);
+		gpio_set_function(B_SI_PIN, GPIO_FUNC_SPI);
+		gpio_set_function(B_SO_PIN, GPIO_FUNC_SPI);
+		spi_init(spi1, SPI_BAUD);
+	}
+
+	#if !PICO_ON_DEVICE
+	enc28j60_sim_attach(&sim_a);
+	if (second_port) {
+		enc28j60_sim_attach(&sim_b);
+		sim_a.peer = &sim_b;
+		sim_b.peer = &sim_a;
+	}
+	#endif
+
+	struct enc28j60 *tx = &port_a;
+	struct enc28j60 *rx = second_port ? &port_b : &port_a;
+	enc28j60_init(tx);
+	if (second_port) {
+		enc28j60_init(rx);
+	} else {
+		loopback_enable(tx);
+	}
+
+	printf("%s, SPI %d Hz, %lu frames per size\n", second_port ? "Second port" : "PHY loopback", SPI_BAUD,
+			(unsigned long) frames);
+	printf(" size path   frames/s    Mbit/s  SPI %%  clk_sys/frame (path time x clk_sys)\n");
+	for (size_t i = 0; i < size_count; i++) {
+		struct result result = {
+			.size = sizes[i],
+			.frames = frames,
+		};
+		bench_size(tx, rx, &result);
+		report(&result);
+	}
+	printf("* held to the %d Mbit/s wire, the path alone is faster\n", WIRE_BPS / 1000000);
+
+	#if PICO_ON_DEVICE
+	while (true) {
+		tight_loop_contents();
+	}
+	#endif
+
+	return 0;
+}
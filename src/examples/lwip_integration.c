@@ -10,8 +10,12 @@
 #include <lwip/netif.h>
 #include <lwip/timeouts.h>
 
+#include <pico/enc28j60/cmdlist.h>
 #include <pico/enc28j60/enc28j60.h>
 #include <pico/enc28j60/ethernetif.h>
+#include <pico/enc28j60/gro.h>
+#include <pico/enc28j60/irq.h>
+#include <pico/enc28j60/moderation.h>
 
 #include "tcpecho_raw.h"
 
@@ -31,6 +35,7 @@
 
 queue_t rx_queue;
 critical_section_t spi_cs;
+struct enc28j60_cmdlist isr_cmdlist;
 struct netif netif;
 struct enc28j60 enc28j60 = {
 	.spi = SPI,
@@ -39,20 +44,32 @@ struct enc28j60 enc28j60 = {
 	.next_packet = 0,
 	.critical_section = &spi_cs,
 };
+struct enc28j60_moderation moderation = {
+	.eth = &enc28j60,
+};
+struct ethernetif_gro gro;
+
+/* Reads one frame, from the INT pin interrupt or from the poll timer of the interrupt moderation */
+void
+eth_frame(struct enc28j60 *eth, void *context)
+{
+	struct pbuf *packet = low_level_input(&netif);
+	if (packet != NULL) {
+		if (!queue_try_add(&rx_queue, &packet)) {
+			pbuf_free(packet);
+		}
+	}
+}
 
 void
-eth_irq(uint gpio, uint32_t events)
+eth_irq(struct enc28j60 *eth, void *context)
 {
-	enc28j60_isr_begin(&enc28j60);
-	uint8_t flags = enc28j60_interrupt_flags(&enc28j60);
+	uint32_t frames = 0;
+	uint8_t flags = enc28j60_isr_begin_batched(eth, &isr_cmdlist);
 
 	if (flags & ENC28J60_PKTIF) {
-		struct pbuf *packet = low_level_input(&netif);
-		if (packet != NULL) {
-			if (!queue_try_add(&rx_queue, &packet)) {
-				pbuf_free(packet);
-			}
-		}
+		frames++;
+		eth_frame(eth, context);
 	}
 
 	if (flags & ENC28J60_TXERIF) {
@@ -63,8 +80,8 @@ eth_irq(uint gpio, uint32_t events)
 		LWIP_DEBUGF(NETIF_DEBUG, ("eth_irq: receive error\n"));
 	}
 
-	enc28j60_interrupt_clear(&enc28j60, flags);
-	enc28j60_isr_end(&enc28j60);
+	enc28j60_isr_end_batched(eth, &isr_cmdlist, flags);
+	enc28j60_moderation_account(&moderation, frames);
 }
 
 int
@@ -83,6 +100,7 @@ main()
 
 	queue_init(&rx_queue, sizeof(struct pbuf *), RX_QUEUE_SIZE);
 	critical_section_init(&spi_cs);
+	enc28j60_cmdlist_init(&isr_cmdlist);
 
 	const struct ip4_addr ipaddr = IP_ADDRESS;
 	const struct ip4_addr netmask = NETWORK_MASK;
@@ -92,20 +110,19 @@ main()
 	netif_set_up(&netif);
 	netif_set_link_up(&netif);
 
-	gpio_set_irq_enabled_with_callback(INT_PIN, GPIO_IRQ_EDGE_FALL, true, eth_irq);
+	enc28j60_irq_add(&enc28j60, INT_PIN, eth_irq, NULL);
 	enc28j60_interrupts(&enc28j60, ENC28J60_PKTIE | ENC28J60_TXERIE | ENC28J60_RXERIE);
+	enc28j60_moderation_start(&moderation, eth_frame, NULL);
 
 	tcpecho_raw_init();
 
 	while (true) {
+		/* Everything queued since the last pass is one batch, consecutive TCP segments of a flow are merged */
 		struct pbuf* p = NULL;
-		queue_try_remove(&rx_queue, &p);
-		if (p != NULL) {
-			if(netif.input(p, &netif) != ERR_OK) {
-				LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_input: IP input error\n"));
-				pbuf_free(p);
-			}
+		while (queue_try_remove(&rx_queue, &p)) {
+			ethernetif_gro_input(&gro, &netif, p);
 		}
+		ethernetif_gro_flush(&gro, &netif);
 
 		sys_check_timeouts();
 		gpio_put(PICO_DEFAULT_LED_PIN, false);
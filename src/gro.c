@@ -0,0 +1,274 @@
+#include <string.h>
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/prot/tcp.h"
+#include "netif/ethernet.h"
+
+#include <pico/enc28j60/gro.h>
+
+#define ETHERTYPE_IPV4 0x0800
+#define IP_PROTOCOL_TCP 6
+#define IP_HEADER 20
+#define IP_MAX_LEN 0xFFFF
+
+/* Offset of the IPv4 header in a frame */
+#define IP_OFFSET (ETH_PAD_SIZE + SIZEOF_ETH_HDR)
+
+/* Headers of a segment, parsed from its first pbuf */
+struct gro_segment {
+	u8_t *ip;
+	u8_t *tcp;
+	u16_t tcp_header;
+	u16_t payload_len;
+	u32_t seq;
+};
+
+static u16_t
+gro_get16(const u8_t *data)
+{
+	return data[0] << 8 | data[1];
+}
+
+static void
+gro_set16(u8_t *data, u16_t value)
+{
+	data[0] = value >> 8;
+	data[1] = value & 0xFF;
+}
+
+/* Ones' complement sum of 16-bit big-endian words, not folded */
+static u32_t
+gro_sum(const u8_t *data, size_t len, u32_t sum)
+{
+	for (size_t i = 0; i + 1 < len; i += 2) {
+		sum += gro_get16(&data[i]);
+	}
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+
+	return sum;
+}
+
+static u16_t
+gro_fold(u32_t sum)
+{
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+
+	return (u16_t) sum;
+}
+
+/* Sum of the TCP pseudo header */
+static u32_t
+gro_pseudo_sum(const u8_t *ip, u16_t tcp_len)
+{
+	return gro_sum(&ip[12], 8, 0) + IP_PROTOCOL_TCP + tcp_len;
+}
+
+/*
+ * Parse a segment that may be merged: IPv4 without options or fragmentation, TCP carrying data with no flags
+ * other than ACK and PSH. Frame padding is trimmed.
+ * \return true if the segment may be merged
+ */
+static bool
+gro_parse(struct pbuf *p, struct gro_segment *segment)
+{
+	if (p->len < IP_OFFSET + IP_HEADER) {
+		return false;
+	}
+
+	u8_t *frame = (u8_t *) p->payload;
+	u8_t *ip = &frame[IP_OFFSET];
+	if (gro_get16(&frame[ETH_PAD_SIZE + 12]) != ETHERTYPE_IPV4 || ip[0] != 0x45 || ip[9] != IP_PROTOCOL_TCP
+			|| (gro_get16(&ip[6]) & 0x3FFF)) {
+		return false;
+	}
+
+	u16_t ip_len = gro_get16(&ip[2]);
+	if (ip_len < IP_HEADER + 20 || IP_OFFSET + ip_len > p->tot_len) {
+		return false;
+	}
+
+	u8_t *tcp = &ip[IP_HEADER];
+	u16_t tcp_header = (tcp[12] >> 4) * 4;
+	if (tcp_header < 20 || IP_OFFSET + IP_HEADER + tcp_header > p->len || IP_HEADER + tcp_header >= ip_len
+			|| (tcp[13] & ~TCP_PSH) != TCP_ACK || gro_get16(&tcp[18])) {
+		return false;
+	}
+
+	if (IP_OFFSET + ip_len < p->tot_len) {
+		pbuf_realloc(p, IP_OFFSET + ip_len);
+	}
+
+	segment->ip = ip;
+	segment->tcp = tcp;
+	segment->tcp_header = tcp_header;
+	segment->payload_len = ip_len - IP_HEADER - tcp_header;
+	segment->seq = (u32_t) gro_get16(&tcp[4]) << 16 | gro_get16(&tcp[6]);
+
+	return true;
+}
+
+/* Ones' complement sum of the payload of a segment, derived from its checksum */
+static u16_t
+gro_payload_sum(const struct gro_segment *segment)
+{
+	u32_t sum = gro_pseudo_sum(segment->ip, segment->tcp_header + segment->payload_len);
+
+	return (u16_t) ~gro_fold(gro_sum(segment->tcp, segment->tcp_header, sum));
+}
+
+static bool
+gro_same_flow(const struct ethernetif_gro_flow *flow, const struct gro_segment *segment)
+{
+	return !memcmp(flow->addresses, &segment->ip[12], 8) && flow->ports[0] == gro_get16(&segment->tcp[0])
+		&& flow->ports[1] == gro_get16(&segment->tcp[2]);
+}
+
+static void
+gro_deliver(struct ethernetif_gro *gro, struct netif *netif, struct pbuf *p)
+{
+	gro->delivered++;
+	if (netif->input(p, netif) != ERR_OK) {
+		LWIP_DEBUGF(NETIF_DEBUG, ("ethernetif_gro: IP input error\n"));
+		pbuf_free(p);
+	}
+}
+
+/* Rewrite the headers of a merged segment and hand it to lwIP */
+static void
+gro_flush_flow(struct ethernetif_gro *gro, struct netif *netif, struct ethernetif_gro_flow *flow)
+{
+	if (flow->p == NULL) {
+		return;
+	}
+
+	if (flow->segments > 1) {
+		u8_t *ip = &((u8_t *) flow->p->payload)[IP_OFFSET];
+		u8_t *tcp = &ip[IP_HEADER];
+		u16_t tcp_header = (tcp[12] >> 4) * 4;
+		u16_t tcp_len = tcp_header + flow->payload_len;
+
+		gro_set16(&ip[2], IP_HEADER + tcp_len);
+		gro_set16(&ip[10], 0);
+		gro_set16(&ip[10], (u16_t) ~gro_fold(gro_sum(ip, IP_HEADER, 0)));
+
+		tcp[13] = flow->flags;
+		gro_set16(&tcp[16], 0);
+		u32_t sum = gro_sum(tcp, tcp_header, gro_pseudo_sum(ip, tcp_len)) + flow->payload_sum;
+		gro_set16(&tcp[16], (u16_t) ~gro_fold(sum));
+	}
+
+	struct pbuf *p = flow->p;
+	flow->p = NULL;
+	gro_deliver(gro, netif, p);
+}
+
+static void
+gro_start(struct ethernetif_gro_flow *flow, struct pbuf *p, const struct gro_segment *segment)
+{
+	flow->p = p;
+	memcpy(flow->addresses, &segment->ip[12], 8);
+	flow->ports[0] = gro_get16(&segment->tcp[0]);
+	flow->ports[1] = gro_get16(&segment->tcp[2]);
+	flow->next_seq = segment->seq + segment->payload_len;
+	flow->mss = segment->payload_len;
+	flow->payload_len = segment->payload_len;
+	flow->payload_sum = gro_payload_sum(segment);
+	flow->segments = 1;
+	flow->flags = segment->tcp[13];
+}
+
+/*
+ * Append a segment to its flow if it continues it.
+ * \return true if the segment was merged
+ */
+static bool
+gro_merge(struct ethernetif_gro *gro, struct ethernetif_gro_flow *flow, struct pbuf *p,
+		const struct gro_segment *segment)
+{
+	const u8_t *ip = &((const u8_t *) flow->p->payload)[IP_OFFSET];
+	const u8_t *tcp = &ip[IP_HEADER];
+	u8_t max_segments = gro->max_segments ? gro->max_segments : 8;
+
+	/* In order, after full sized segments, with the same ACK, window, options, TOS and TTL */
+	if (segment->seq != flow->next_seq || flow->payload_len != flow->mss * flow->segments
+			|| segment->payload_len > flow->mss || (flow->flags & TCP_PSH) || flow->segments >= max_segments
+			|| IP_HEADER + segment->tcp_header + flow->payload_len + segment->payload_len > IP_MAX_LEN - IP_OFFSET
+			|| segment->tcp_header != (tcp[12] >> 4) * 4 || memcmp(&segment->tcp[8], &tcp[8], 4)
+			|| memcmp(&segment->tcp[14], &tcp[14], 2) || memcmp(&segment->tcp[20], &tcp[20], segment->tcp_header - 20)
+			|| segment->ip[1] != ip[1] || segment->ip[8] != ip[8]) {
+		return false;
+	}
+
+	u16_t sum = gro_payload_sum(segment);
+	if (flow->payload_len & 1) {
+		/* Appended at an odd offset, its words are shifted by one byte */
+		sum = (u16_t) (sum << 8 | sum >> 8);
+	}
+	flow->payload_sum = gro_fold(flow->payload_sum + sum);
+	flow->payload_len += segment->payload_len;
+	flow->next_seq += segment->payload_len;
+	flow->flags |= segment->tcp[13] & TCP_PSH;
+	flow->segments++;
+
+	pbuf_remove_header(p, IP_OFFSET + IP_HEADER + segment->tcp_header);
+	pbuf_cat(flow->p, p);
+	gro->merged++;
+
+	return true;
+}
+
+void
+ethernetif_gro_input(struct ethernetif_gro *gro, struct netif *netif, struct pbuf *p)
+{
+	struct gro_segment segment;
+
+	gro->received++;
+
+	if (!gro_parse(p, &segment)) {
+		/* Held segments go first, the packet may belong to their flow */
+		if (p->len >= IP_OFFSET + IP_HEADER && gro_get16(&((u8_t *) p->payload)[ETH_PAD_SIZE + 12]) == ETHERTYPE_IPV4
+				&& ((u8_t *) p->payload)[IP_OFFSET + 9] == IP_PROTOCOL_TCP) {
+			ethernetif_gro_flush(gro, netif);
+		}
+		gro->passed++;
+		gro_deliver(gro, netif, p);
+		return;
+	}
+
+	struct ethernetif_gro_flow *empty = NULL;
+	for (size_t i = 0; i < ETHERNETIF_GRO_FLOWS; i++) {
+		struct ethernetif_gro_flow *flow = &gro->flows[i];
+		if (flow->p == NULL) {
+			if (empty == NULL) {
+				empty = flow;
+			}
+		} else if (gro_same_flow(flow, &segment)) {
+			if (gro_merge(gro, flow, p, &segment)) {
+				return;
+			}
+			gro_flush_flow(gro, netif, flow);
+			gro_start(flow, p, &segment);
+			return;
+		}
+	}
+
+	if (empty == NULL) {
+		empty = &gro->flows[gro->victim];
+		gro->victim = (gro->victim + 1) % ETHERNETIF_GRO_FLOWS;
+		gro_flush_flow(gro, netif, empty);
+	}
+	gro_start(empty, p, &segment);
+}
+
+void
+ethernetif_gro_flush(struct ethernetif_gro *gro, struct netif *netif)
+{
+	for (size_t i = 0; i < ETHERNETIF_GRO_FLOWS; i++) {
+		gro_flush_flow(gro, netif, &gro->flows[i]);
+	}
+}
@@ -0,0 +1,52 @@
+#include <hardware/gpio.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/irq.h>
+
+static struct {
+	struct enc28j60 *instance;
+	enc28j60_irq_handler_t handler;
+	void *context;
+	uint8_t pin;
+} enc28j60_irq_routes[ENC28J60_IRQ_MAX_INSTANCES];
+
+static void
+enc28j60_irq_dispatch(uint gpio, uint32_t events)
+{
+	(void) events;
+
+	for (size_t i = 0; i < ENC28J60_IRQ_MAX_INSTANCES; i++) {
+		if (enc28j60_irq_routes[i].instance != NULL && enc28j60_irq_routes[i].pin == gpio) {
+			enc28j60_irq_routes[i].handler(enc28j60_irq_routes[i].instance, enc28j60_irq_routes[i].context);
+			return;
+		}
+	}
+}
+
+bool
+enc28j60_irq_add(struct enc28j60 *self, uint8_t int_pin, enc28j60_irq_handler_t handler, void *context)
+{
+	for (size_t i = 0; i < ENC28J60_IRQ_MAX_INSTANCES; i++) {
+		if (enc28j60_irq_routes[i].instance == NULL) {
+			enc28j60_irq_routes[i].handler = handler;
+			enc28j60_irq_routes[i].context = context;
+			enc28j60_irq_routes[i].pin = int_pin;
+			enc28j60_irq_routes[i].instance = self;
+			gpio_set_irq_enabled_with_callback(int_pin, GPIO_IRQ_EDGE_FALL, true, enc28j60_irq_dispatch);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+enc28j60_irq_remove(struct enc28j60 *self)
+{
+	for (size_t i = 0; i < ENC28J60_IRQ_MAX_INSTANCES; i++) {
+		if (enc28j60_irq_routes[i].instance == self) {
+			gpio_set_irq_enabled(enc28j60_irq_routes[i].pin, GPIO_IRQ_EDGE_FALL, false);
+			enc28j60_irq_routes[i].instance = NULL;
+		}
+	}
+}
@@ -0,0 +1,81 @@
+#include <hardware/timer.h>
+#include <pico/time.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/moderation.h>
+
+static bool
+enc28j60_moderation_poll(repeating_timer_t *timer)
+{
+	struct enc28j60_moderation *moderation = timer->user_data;
+
+	/* Frames only, the interrupt sequence of the INT pin is not needed without the interrupt */
+	uint8_t pending = enc28j60_reg_read(moderation->eth, ENC28J60_REG_EPKTCNT);
+	for (uint8_t i = 0; i < pending; i++) {
+		moderation->handler(moderation->eth, moderation->context);
+	}
+	enc28j60_moderation_account(moderation, pending);
+
+	moderation->polling = moderation->mode == ENC28J60_MODERATION_POLL;
+	return moderation->polling;
+}
+
+void
+enc28j60_moderation_start(struct enc28j60_moderation *moderation, enc28j60_irq_handler_t handler, void *context)
+{
+	if (!moderation->poll_rate) {
+		moderation->poll_rate = 5000;
+	}
+	if (!moderation->interrupt_rate) {
+		moderation->interrupt_rate = moderation->poll_rate / 4;
+	}
+	if (!moderation->poll_interval_us) {
+		moderation->poll_interval_us = 500;
+	}
+	if (!moderation->window_us) {
+		moderation->window_us = 10000;
+	}
+
+	moderation->handler = handler;
+	moderation->context = context;
+	moderation->mode = ENC28J60_MODERATION_INTERRUPT;
+	moderation->rate = 0;
+	moderation->window_start = time_us_32();
+	moderation->window_packets = 0;
+	moderation->polling = false;
+
+	enc28j60_reg_set(moderation->eth, ENC28J60_REG_EIE, ENC28J60_PKTIE);
+}
+
+void
+enc28j60_moderation_account(struct enc28j60_moderation *moderation, uint32_t frames)
+{
+	uint32_t now = time_us_32();
+	uint32_t elapsed = now - moderation->window_start;
+
+	moderation->window_packets += frames;
+	if (elapsed < moderation->window_us) {
+		return;
+	}
+
+	moderation->rate = (uint32_t) ((uint64_t) moderation->window_packets * 1000000 / elapsed);
+	moderation->window_start = now;
+	moderation->window_packets = 0;
+
+	if (moderation->mode == ENC28J60_MODERATION_INTERRUPT && moderation->rate >= moderation->poll_rate) {
+		enc28j60_reg_clear(moderation->eth, ENC28J60_REG_EIE, ENC28J60_PKTIE);
+		moderation->mode = ENC28J60_MODERATION_POLL;
+		moderation->switches++;
+		if (!moderation->polling) {
+			/* Otherwise the timer of the previous poll phase has not stopped yet and carries on */
+			moderation->polling = true;
+			add_repeating_timer_us(-(int64_t) moderation->poll_interval_us, enc28j60_moderation_poll, moderation,
+					&moderation->timer);
+		}
+	} else if (moderation->mode == ENC28J60_MODERATION_POLL && moderation->rate < moderation->interrupt_rate) {
+		/* The timer stops on its next return. PKTIF is still set if frames are pending, so INT fires right away. */
+		moderation->mode = ENC28J60_MODERATION_INTERRUPT;
+		moderation->switches++;
+		enc28j60_reg_set(moderation->eth, ENC28J60_REG_EIE, ENC28J60_PKTIE);
+	}
+}
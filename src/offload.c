@@ -0,0 +1,136 @@
+#include <string.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/offload.h>
+
+#define ETHERTYPE_IPV4 0x0800
+#define ETHERTYPE_ARP 0x0806
+#define IP_PROTOCOL_ICMP 1
+#define ICMP_ECHO_REQUEST 8
+
+static const uint8_t *
+enc28j60_offload_local(const struct enc28j60_offload *offload, const uint8_t *ip_address)
+{
+	for (uint8_t i = 0; i < offload->ip_address_count; i++) {
+		if (!memcmp(offload->ip_addresses[i], ip_address, 4)) {
+			return offload->ip_addresses[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void
+enc28j60_offload_arp_reply(struct enc28j60 *self, const uint8_t *request, const uint8_t *ip_address)
+{
+	uint8_t reply[42];
+
+	/* Ethernet */
+	memcpy(&reply[0], &request[6], 6);
+	memcpy(&reply[6], self->mac_address, 6);
+	memcpy(&reply[12], &request[12], 8);  /* EtherType, hardware and protocol type and length */
+
+	/* ARP reply */
+	reply[20] = 0;
+	reply[21] = 2;
+	memcpy(&reply[22], self->mac_address, 6);
+	memcpy(&reply[28], ip_address, 4);
+	memcpy(&reply[32], &request[22], 10);  /* Requester hardware and protocol address */
+
+	enc28j60_transfer_init(self);
+	enc28j60_transfer_write(self, reply, sizeof(reply));
+	enc28j60_transfer_send(self);
+}
+
+static void
+enc28j60_offload_echo_reply(struct enc28j60 *self, const uint8_t *request, uint16_t len, uint16_t icmp)
+{
+	uint16_t tx_frame = enc28j60_rx_buffer_size(self) + 1;
+	uint8_t addresses[12];
+	uint8_t ip_addresses[8];
+	uint8_t icmp_header[4];
+
+	memcpy(&addresses[0], &request[6], 6);
+	memcpy(&addresses[6], self->mac_address, 6);
+	memcpy(&ip_addresses[0], &request[30], 4);
+	memcpy(&ip_addresses[4], &request[26], 4);
+
+	/*
+	 * Echo reply: type 8 becomes 0, update the checksum incrementally (RFC 1624) so the payload need not be summed.
+	 * Swapping the IP addresses keeps the IP header checksum valid.
+	 */
+	uint16_t checksum = request[icmp + 2] << 8 | request[icmp + 3];
+	uint32_t sum = (uint16_t) ~checksum + (uint16_t) ~(ICMP_ECHO_REQUEST << 8);
+	sum = (sum & 0xFFFF) + (sum >> 16);
+	checksum = ~((sum & 0xFFFF) + (sum >> 16));
+	icmp_header[0] = 0;
+	icmp_header[1] = request[icmp + 1];
+	icmp_header[2] = checksum >> 8;
+	icmp_header[3] = checksum & 0xFF;
+
+	/* Wait for a transmission in progress before the transaction, which disables interrupts */
+	enc28j60_transfer_init(self);
+	enc28j60_transaction_begin(self);
+
+	/* Copy the request from the receive buffer */
+	enc28j60_dma_copy(self, tx_frame, self->rx_start, len);
+
+	enc28j60_reg_write(self, ENC28J60_REG_EWRPT, tx_frame);
+	enc28j60_write(self, ENC28J60_WBM | ENC28J60_BM_ARG, addresses, sizeof(addresses));
+	enc28j60_reg_write(self, ENC28J60_REG_EWRPT, tx_frame + 26);
+	enc28j60_write(self, ENC28J60_WBM | ENC28J60_BM_ARG, ip_addresses, sizeof(ip_addresses));
+	enc28j60_reg_write(self, ENC28J60_REG_EWRPT, tx_frame + icmp);
+	enc28j60_write(self, ENC28J60_WBM | ENC28J60_BM_ARG, icmp_header, sizeof(icmp_header));
+	enc28j60_reg_write(self, ENC28J60_REG_ETXND, tx_frame + len - 1);
+	enc28j60_transaction_end(self);
+
+	enc28j60_transfer_send(self);
+}
+
+uint16_t
+enc28j60_offload_input(struct enc28j60_offload *offload, struct enc28j60 *self)
+{
+	uint8_t frame[42];
+
+	uint16_t len = enc28j60_receive_init(self);
+	if (!len) {
+		enc28j60_receive_ack(self);
+		return 0;
+	}
+	if (len < sizeof(frame)) {
+		enc28j60_receive_seek(self, 0);
+		return len;
+	}
+	enc28j60_receive_read(self, frame, sizeof(frame));
+
+	/* Interrupted while a frame is written to the transmit buffer, leave the request to lwIP */
+	if (enc28j60_buffer_held(self, ENC28J60_BUFFER_TX)) {
+		enc28j60_receive_seek(self, 0);
+		return len;
+	}
+
+	uint16_t ethertype = frame[12] << 8 | frame[13];
+	const uint8_t *ip_address;
+
+	if (offload->arp && ethertype == ETHERTYPE_ARP && frame[20] == 0 && frame[21] == 1
+			&& (ip_address = enc28j60_offload_local(offload, &frame[38])) != NULL) {
+		enc28j60_offload_arp_reply(self, frame, ip_address);
+		enc28j60_receive_ack(self);
+		offload->arp_replies++;
+		return 0;
+	}
+
+	uint16_t icmp = 14 + (frame[14] & 0x0F) * 4;
+	if (offload->icmp && ethertype == ETHERTYPE_IPV4 && (frame[14] >> 4) == 4 && frame[23] == IP_PROTOCOL_ICMP
+			&& !(frame[20] & 0x3F) && !frame[21]  /* Not fragmented */
+			&& (size_t) icmp + 4 <= sizeof(frame) && icmp + 8 <= len && frame[icmp] == ICMP_ECHO_REQUEST
+			&& enc28j60_offload_local(offload, &frame[30]) != NULL && !(frame[0] & 1)) {
+		enc28j60_offload_echo_reply(self, frame, len, icmp);
+		enc28j60_receive_ack(self);
+		offload->echo_replies++;
+		return 0;
+	}
+
+	enc28j60_receive_seek(self, 0);
+	return len;
+}
@@ -0,0 +1,111 @@
+#include <math.h>
+
+#include <hardware/clocks.h>
+#include <hardware/pio.h>
+
+#include <pico/enc28j60/pio.h>
+
+#include "pio_spi.pio.h"
+
+/* Program offset in every PIO block, and a bit per block the program is loaded into */
+static uint enc28j60_pio_offsets[NUM_PIOS];
+static uint32_t enc28j60_pio_loaded;
+
+bool
+enc28j60_pio_init(struct enc28j60_pio *self, PIO pio, uint sck_pin, uint mosi_pin, uint miso_pin, uint cs_pin,
+		uint32_t baudrate)
+{
+	uint index = pio_get_index(pio);
+	bool loaded = enc28j60_pio_loaded & (1u << index);
+
+	if (!loaded && !pio_can_add_program(pio, &enc28j60_spi_program)) {
+		return false;
+	}
+
+	int sm = pio_claim_unused_sm(pio, false);
+	if (sm < 0) {
+		return false;
+	}
+
+	if (!loaded) {
+		enc28j60_pio_offsets[index] = pio_add_program(pio, &enc28j60_spi_program);
+		enc28j60_pio_loaded |= 1u << index;
+	}
+
+	self->pio = pio;
+	self->sm = (uint) sm;
+	self->offset = enc28j60_pio_offsets[index];
+
+	/* 4 PIO cycles per bit, the chip select timing needs PIO cycles of at least 12.5 ns */
+	if (baudrate > ENC28J60_PIO_MAX_BAUDRATE) {
+		baudrate = ENC28J60_PIO_MAX_BAUDRATE;
+	}
+	float clkdiv = (float) clock_get_hz(clk_sys) / (4.0f * (float) baudrate);
+	if (clkdiv < 1.0f) {
+		clkdiv = 1.0f;
+	}
+	clkdiv = ceilf(clkdiv * 256.0f) / 256.0f;  /* The divider has 8 fractional bits, never round it down */
+
+	enc28j60_spi_program_init(pio, self->sm, self->offset, sck_pin, mosi_pin, miso_pin, cs_pin, clkdiv);
+
+	return true;
+}
+
+void
+enc28j60_pio_command(const struct enc28j60_pio *self, uint8_t instruction, const uint8_t *tx, size_t tx_len,
+		uint8_t *rx, size_t rx_len)
+{
+	size_t total = 1 + tx_len + rx_len;
+	size_t tx_i = 0;
+	size_t rx_i = 0;
+
+	pio_sm_put_blocking(self->pio, self->sm, 8 * total - 1);
+
+	while (rx_i < total) {
+		if (tx_i < total && !pio_sm_is_tx_fifo_full(self->pio, self->sm)) {
+			uint8_t byte = 0;
+			if (tx_i == 0) {
+				byte = instruction;
+			} else if (tx_i <= tx_len) {
+				byte = tx[tx_i - 1];
+			}
+			pio_sm_put(self->pio, self->sm, (uint32_t) byte << 24);
+			tx_i++;
+		}
+		if (!pio_sm_is_rx_fifo_empty(self->pio, self->sm)) {
+			uint8_t byte = (uint8_t) pio_sm_get(self->pio, self->sm);
+			if (rx_i > tx_len) {
+				rx[rx_i - tx_len - 1] = byte;
+			}
+			rx_i++;
+		}
+	}
+}
+
+void
+enc28j60_pio_commands(const struct enc28j60_pio *self, const uint8_t (*commands)[2], size_t count)
+{
+	/* Every command is three FIFO words: bit count, instruction, argument */
+	size_t words = 3 * count;
+	size_t tx_i = 0;
+	size_t rx_left = 2 * count;
+
+	while (rx_left) {
+		if (tx_i < words && !pio_sm_is_tx_fifo_full(self->pio, self->sm)) {
+			const uint8_t *command = commands[tx_i / 3];
+			switch (tx_i % 3) {
+			case 0:
+				pio_sm_put(self->pio, self->sm, 15);
+				break;
+			default:
+				pio_sm_put(self->pio, self->sm, (uint32_t) command[tx_i % 3 - 1] << 24);
+				break;
+			}
+			tx_i++;
+		}
+		if (!pio_sm_is_rx_fifo_empty(self->pio, self->sm)) {
+			pio_sm_get(self->pio, self->sm);
+			rx_left--;
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#include <hardware/gpio.h>
+#include <pico/sleep.h>
+#include <pico/stdlib.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/power.h>
+
+void
+enc28j60_wake_pattern(struct enc28j60 *self, uint16_t offset, const uint8_t *pattern, const uint8_t *mask)
+{
+	/* Checksum of the selected bytes, as one contiguous stream */
+	uint32_t sum = 0;
+	size_t selected = 0;
+	for (size_t i = 0; i < ENC28J60_PATTERN_SIZE; i++) {
+		if (mask[i / 8] & (1 << (i % 8))) {
+			sum += (selected++ & 1) ? pattern[i] : pattern[i] << 8;
+		}
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+
+	enc28j60_transaction_begin(self);
+	for (uint8_t i = 0; i < 8; i++) {
+		enc28j60_reg_write(self, ENC28J60_REG(ENC28J60_EPMM + i, 1, 0), mask[i]);
+	}
+	enc28j60_reg_write(self, ENC28J60_REG_EPMCS, (uint16_t) ~sum);
+	enc28j60_reg_write(self, ENC28J60_REG_EPMO, offset);
+	enc28j60_transaction_end(self);
+}
+
+void
+enc28j60_wake_filters(struct enc28j60 *self, uint8_t filters)
+{
+	uint8_t erxfcon = 0;
+
+	if (filters) {
+		/* OR combination of the enabled filters, frames with bad CRC are dropped */
+		erxfcon = ENC28J60_CRCEN;
+		if (filters & ENC28J60_WAKE_UNICAST) {
+			erxfcon |= ENC28J60_UCEN;
+		}
+		if (filters & ENC28J60_WAKE_MAGIC) {
+			erxfcon |= ENC28J60_MPEN;
+		}
+		if (filters & ENC28J60_WAKE_PATTERN) {
+			erxfcon |= ENC28J60_PMEN;
+		}
+		if (filters & ENC28J60_WAKE_BROADCAST) {
+			erxfcon |= ENC28J60_BCEN;
+		}
+	}
+
+	enc28j60_reg_write(self, ENC28J60_REG_ERXFCON, erxfcon);
+}
+
+void
+enc28j60_power_idle(struct enc28j60_power *power)
+{
+	struct enc28j60 *eth = power->eth;
+
+	uint8_t eie = enc28j60_reg_read(eth, ENC28J60_REG_EIE);
+	enc28j60_wake_filters(eth, power->filters);
+	enc28j60_reg_write(eth, ENC28J60_REG_EIE, ENC28J60_INTIE | ENC28J60_PKTIE);
+
+	if (!enc28j60_reg_read(eth, ENC28J60_REG_EPKTCNT) && gpio_get(power->int_pin)) {
+		/* INT is active low, waking on the level catches a frame that arrived before going dormant */
+		sleep_run_from_xosc();
+		sleep_goto_dormant_until_pin(power->int_pin, false, false);
+		power->resumed_us = time_us_32();
+		power->resuming = true;
+		sleep_power_up();
+		power->sleeps++;
+	}
+
+	enc28j60_wake_filters(eth, 0);
+	enc28j60_reg_write(eth, ENC28J60_REG_EIE, eie);
+}
+
+void
+enc28j60_power_received(struct enc28j60_power *power)
+{
+	if (!power->resuming) {
+		return;
+	}
+
+	power->resuming = false;
+	power->last_resume_us = time_us_32() - power->resumed_us;
+	if (power->last_resume_us > power->max_resume_us) {
+		power->max_resume_us = power->last_resume_us;
+	}
+}
+
+void
+enc28j60_power_down(struct enc28j60 *self)
+{
+	enc28j60_reg_clear(self, ENC28J60_REG_ECON1, ENC28J60_RXEN);
+	while (enc28j60_reg_read(self, ENC28J60_REG_ESTAT) & ENC28J60_RXBUSY) {
+		sleep_us(1);
+	}
+	while (enc28j60_transfer_busy(self)) {
+		sleep_us(1);
+	}
+
+	enc28j60_reg_set(self, ENC28J60_REG_ECON2, ENC28J60_VRPS);
+	enc28j60_reg_set(self, ENC28J60_REG_ECON2, ENC28J60_PWRSV);
+}
+
+void
+enc28j60_power_up(struct enc28j60 *self)
+{
+	enc28j60_reg_clear(self, ENC28J60_REG_ECON2, ENC28J60_PWRSV);
+	while (!(enc28j60_reg_read(self, ENC28J60_REG_ESTAT) & ENC28J60_CLKRDY)) {
+		sleep_us(1);
+	}
+
+	enc28j60_reg_set(self, ENC28J60_REG_ECON1, ENC28J60_RXEN);
+}
@@ -0,0 +1,193 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+
+#include <pico/enc28j60/bridge.h>
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/sim.h>
+
+/*
+ * Test of the layer 2 bridge on two simulated ENC28J60.
+ * Frames injected on either port check learning, ageing, filtering, flooding of unknown and group destinations,
+ * local delivery and that reserved IEEE 802.1D group addresses are never relayed. Forwarded frames of every length
+ * class go through the bounce buffer in several chunks and are compared byte by byte with what was injected.
+ * Exits with status 1 on the first mismatch.
+ */
+
+/* Configuration */
+#define SPI_HZ 20000000
+#define AGEING_MS 1000
+
+static const uint8_t station_a[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x0A };  /* Behind port 0 */
+static const uint8_t station_b[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x0B };  /* Behind port 1 */
+static const uint8_t station_c[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x0C };  /* Behind port 0 */
+static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+static const uint8_t stp[6] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x00 };
+static const uint8_t lacp[6] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x02 };
+static const uint8_t not_reserved[6] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x10 };
+
+/* A port: the simulated chip, its driver instance and the last frame it sent */
+struct port {
+	struct enc28j60_sim chip;
+	struct enc28j60 eth;
+	uint8_t sent[1518];
+	size_t sent_len;
+	uint32_t sent_count;
+};
+
+static struct port ports[2] = {
+	{
+		.chip = { .spi = spi0, .cs_pin = 10 },
+		.eth = { .spi = spi0, .cs_pin = 10, .mac_address = { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x0A } },
+	},
+	{
+		.chip = { .spi = spi0, .cs_pin = 11 },
+		.eth = { .spi = spi0, .cs_pin = 11, .mac_address = { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x0B } },
+	},
+};
+
+static struct enc28j60_bridge bridge = {
+	.ports = { &ports[0].eth, &ports[1].eth },
+	.ageing_ms = AGEING_MS,
+};
+
+static uint8_t frame[1514];
+static uint32_t sequence;
+static bool ok = true;
+
+static void
+transmitted(struct enc28j60_sim *sim, const uint8_t *data, size_t len, void *context)
+{
+	struct port *port = context;
+
+	(void) sim;
+
+	memcpy(port->sent, data, len < sizeof(port->sent) ? len : sizeof(port->sent));
+	port->sent_len = len;
+	port->sent_count++;
+}
+
+static void
+check(bool condition, const char *what)
+{
+	if (!condition) {
+		fprintf(stderr, "frame %lu: %s\n", (unsigned long) sequence, what);
+		ok = false;
+	}
+}
+
+/*
+ * A frame arrives on a port and is bridged.
+ * \param forwarded whether the frame has to leave on the other port
+ * \param local whether the frame has to be delivered locally
+ */
+static void
+bridge_frame(uint8_t port, const uint8_t *destination, const uint8_t *source, uint16_t len, bool forwarded,
+		bool local)
+{
+	struct port *peer = &ports[!port];
+	uint32_t sent_count = peer->sent_count;
+	uint8_t received[sizeof(frame)];
+
+	sequence++;
+	memcpy(frame, destination, 6);
+	memcpy(&frame[6], source, 6);
+	frame[12] = 0x88;  /* Local experimental EtherType */
+	frame[13] = 0xB5;
+	for (size_t i = 14; i < len; i++) {
+		frame[i] = (uint8_t) (sequence * 13 + i);
+	}
+
+	check(enc28j60_sim_receive(&ports[port].chip, frame, len), "not accepted by the chip");
+	uint16_t local_len = enc28j60_bridge_input(&bridge, port);
+
+	if (forwarded) {
+		check(peer->sent_count == sent_count + 1, "not forwarded");
+		check(peer->sent_len == len && !memcmp(peer->sent, frame, len), "forwarded frame differs");
+	} else {
+		check(peer->sent_count == sent_count, "forwarded");
+	}
+
+	if (local) {
+		check(local_len == len, "not delivered locally");
+		if (local_len == len) {
+			enc28j60_receive_read(&ports[port].eth, received, len);
+			check(!memcmp(received, frame, len), "delivered frame differs");
+		}
+		enc28j60_receive_ack(&ports[port].eth);
+	} else {
+		check(!local_len, "delivered locally");
+	}
+
+	check(!enc28j60_sim_packets(&ports[port].chip), "frame left pending");
+}
+
+int
+main(void)
+{
+	static const uint16_t lengths[] = { 60, 61, 78, 127, 128, 129, 1000, 1513, 1514 };
+
+	spi_init(spi0, SPI_HZ);
+	for (size_t i = 0; i < 2; i++) {
+		ports[i].chip.on_transmit = transmitted;
+		ports[i].chip.context = &ports[i];
+		enc28j60_sim_attach(&ports[i].chip);
+		gpio_init(ports[i].eth.cs_pin);
+		gpio_set_dir(ports[i].eth.cs_pin, GPIO_OUT);
+		gpio_put(ports[i].eth.cs_pin, 1);
+		enc28j60_init(&ports[i].eth);
+	}
+	enc28j60_bridge_init(&bridge);
+
+	/* Unknown destination: flooded, and the source is learned */
+	bridge_frame(0, station_b, station_a, 1514, true, false);
+	check(bridge.flooded == 1, "flood not counted");
+
+	/* Learned destination on the other port: forwarded, for every length class through the bounce buffer */
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+		bridge_frame(1, station_a, station_b, lengths[i], true, false);
+		bridge_frame(0, station_b, station_a, lengths[i], true, false);
+	}
+	check(bridge.forwarded == 2 * sizeof(lengths) / sizeof(lengths[0]), "forwards not counted");
+
+	/* Destination learned on the receiving port: filtered */
+	bridge_frame(0, station_a, station_c, 100, false, false);
+	check(bridge.filtered == 1, "filter not counted");
+
+	/* Station moved: relearned on the other port */
+	bridge_frame(1, station_b, station_c, 100, false, false);
+	bridge_frame(0, station_c, station_a, 100, true, false);
+
+	/* Broadcast and plain multicast: flooded and delivered locally */
+	bridge_frame(0, broadcast, station_a, 342, true, true);
+	bridge_frame(1, not_reserved, station_b, 64, true, true);
+
+	/* Reserved group addresses: delivered locally, never relayed */
+	uint32_t flooded = bridge.flooded;
+	bridge_frame(0, stp, station_a, 60, false, true);
+	bridge_frame(1, lacp, station_b, 124, false, true);
+	check(bridge.reserved == 2 && bridge.flooded == flooded, "reserved frames not counted");
+
+	/* Addressed to a port: delivered locally only */
+	bridge_frame(0, ports[0].eth.mac_address, station_a, 98, false, true);
+	bridge_frame(0, ports[1].eth.mac_address, station_a, 98, false, true);
+
+	/* Ageing: A has not been seen for longer than the ageing time, so frames to it are flooded again */
+	enc28j60_sim_advance((AGEING_MS + 1) * 1000000ull);
+	flooded = bridge.flooded;
+	bridge_frame(1, station_a, station_b, 200, true, false);
+	check(bridge.flooded == flooded + 1, "aged entry still forwarded");
+	bridge_frame(0, station_b, station_a, 200, true, false);
+	bridge_frame(1, station_a, station_b, 200, true, false);
+	check(bridge.flooded == flooded + 1, "relearned entry flooded");
+
+	printf("forwarded %lu, flooded %lu, filtered %lu, reserved %lu: %s\n", (unsigned long) bridge.forwarded,
+			(unsigned long) bridge.flooded, (unsigned long) bridge.filtered, (unsigned long) bridge.reserved,
+			ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
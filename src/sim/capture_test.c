@@ -0,0 +1,222 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <pico/enc28j60/capture.h>
+
+/*
+ * Test of the pcapng capture ring.
+ * Frames of varying lengths are captured in two parts, as from a pbuf chain, with a snap length and an EtherType
+ * filter. The stream is read in odd-sized chunks, so blocks wrap around the end of the ring, and at times not at
+ * all, so the ring overflows and frames are dropped. The stream is then parsed block by block and every Enhanced
+ * Packet Block is compared with the frame it was made from. Exits with status 1 on the first mismatch.
+ */
+
+/* Configuration */
+#define RING_SIZE 1024
+#define SNAPLEN 100
+#define FRAMES 400
+#define READ_CHUNK 77
+#define STREAM_SIZE (64 * 1024)
+
+/* Frame expected in the stream */
+struct expected {
+	uint32_t sequence;
+	uint32_t len;
+	uint64_t timestamp_us;
+	uint32_t flags;
+};
+
+static uint8_t ring[RING_SIZE];
+static uint8_t stream[STREAM_SIZE];
+static size_t stream_len;
+static struct expected expected[FRAMES];
+static size_t expected_count;
+
+static void
+frame_fill(uint8_t *frame, uint32_t sequence, uint32_t len)
+{
+	for (uint32_t i = 0; i < len; i++) {
+		frame[i] = (uint8_t) (sequence * 7 + i);
+	}
+	frame[12] = sequence % 5 ? 0x08 : 0x86;  /* Every fifth frame is IPv6, which the filter rejects */
+	frame[13] = sequence % 5 ? 0x00 : 0xDD;
+}
+
+static void
+drain(struct enc28j60_capture *capture)
+{
+	size_t n;
+
+	while ((n = enc28j60_capture_read(capture, &stream[stream_len], READ_CHUNK)) != 0) {
+		stream_len += n;
+		if (stream_len + READ_CHUNK > STREAM_SIZE) {
+			fprintf(stderr, "stream buffer full\n");
+			return;
+		}
+	}
+}
+
+static uint32_t
+word(size_t offset)
+{
+	uint32_t value;
+
+	memcpy(&value, &stream[offset], 4);
+	return value;
+}
+
+static uint16_t
+half(size_t offset)
+{
+	uint16_t value;
+
+	memcpy(&value, &stream[offset], 2);
+	return value;
+}
+
+static bool
+check(bool condition, const char *what, size_t offset)
+{
+	if (!condition) {
+		fprintf(stderr, "%s at stream offset %zu\n", what, offset);
+	}
+	return condition;
+}
+
+/* \return true if the stream holds exactly the section header, the interface and the expected frames */
+static bool
+parse(void)
+{
+	uint8_t frame[1514];
+	size_t offset = 0;
+	size_t frames = 0;
+
+	/* Section Header Block, version 1.0, section length unknown */
+	if (!check(stream_len >= 28 && word(0) == 0x0A0D0D0A && word(4) == 28 && word(8) == 0x1A2B3C4D
+			&& half(12) == 1 && half(14) == 0 && word(16) == 0xFFFFFFFF && word(20) == 0xFFFFFFFF
+			&& word(24) == 28, "bad section header block", 0)) {
+		return false;
+	}
+	offset = 28;
+
+	/* Interface Description Block, Ethernet, if_tsresol 6 */
+	if (!check(stream_len >= offset + 32 && word(offset) == 1 && word(offset + 4) == 32 && half(offset + 8) == 1
+			&& word(offset + 12) == SNAPLEN && half(offset + 16) == 9 && half(offset + 18) == 1
+			&& stream[offset + 20] == 6 && word(offset + 24) == 0 && word(offset + 28) == 32,
+			"bad interface description block", offset)) {
+		return false;
+	}
+	offset += 32;
+
+	while (offset < stream_len) {
+		if (!check(stream_len - offset >= 44 && word(offset) == 6, "bad enhanced packet block", offset)) {
+			return false;
+		}
+
+		uint32_t block_len = word(offset + 4);
+		if (!check(block_len % 4 == 0 && block_len <= stream_len - offset
+				&& word(offset + block_len - 4) == block_len, "bad block length", offset)) {
+			return false;
+		}
+		if (!check(frames < expected_count, "unexpected frame", offset)) {
+			return false;
+		}
+
+		const struct expected *e = &expected[frames];
+		uint32_t captured_len = e->len > SNAPLEN ? SNAPLEN : e->len;
+		uint32_t padded = (captured_len + 3) & ~3u;
+		uint64_t timestamp = (uint64_t) word(offset + 12) << 32 | word(offset + 16);
+		if (!check(word(offset + 8) == 0 && timestamp == e->timestamp_us && word(offset + 20) == captured_len
+				&& word(offset + 24) == e->len && block_len == 28 + padded + 16, "bad packet header", offset)) {
+			return false;
+		}
+
+		frame_fill(frame, e->sequence, e->len);
+		if (!check(!memcmp(&stream[offset + 28], frame, captured_len), "bad packet data", offset)) {
+			return false;
+		}
+		for (uint32_t i = captured_len; i < padded; i++) {
+			if (!check(stream[offset + 28 + i] == 0, "bad padding", offset)) {
+				return false;
+			}
+		}
+
+		/* epb_flags with the direction, then the end of options */
+		size_t options = offset + 28 + padded;
+		if (!check(half(options) == 2 && half(options + 2) == 4 && word(options + 4) == e->flags
+				&& word(options + 8) == 0, "bad packet options", offset)) {
+			return false;
+		}
+
+		offset += block_len;
+		frames++;
+	}
+
+	return check(frames == expected_count, "frames missing", offset);
+}
+
+int
+main(void)
+{
+	struct enc28j60_capture capture = {
+		.buffer = ring,
+		.size = sizeof(ring),
+		.snaplen = SNAPLEN,
+		.filter = { { .offset = 12, .mask = 0xFF, .value = 0x08 } },
+		.filter_count = 1,
+	};
+	uint8_t frame[1514];
+	uint32_t filtered = 0;
+
+	enc28j60_capture_init(&capture);
+
+	for (uint32_t sequence = 0; sequence < FRAMES; sequence++) {
+		uint32_t len = 60 + (sequence * 37) % 1455;
+		uint64_t timestamp_us = 1000003ull * sequence + 17;
+		uint32_t flags = sequence & 1 ? ENC28J60_CAPTURE_OUTBOUND : ENC28J60_CAPTURE_INBOUND;
+
+		frame_fill(frame, sequence, len);
+		if (frame[12] != 0x08) {
+			filtered++;
+		}
+
+		/* Headers and payload appended separately, like a pbuf chain */
+		if (enc28j60_capture_begin(&capture, frame, 14, len, timestamp_us, flags)) {
+			enc28j60_capture_append(&capture, frame, 14);
+			enc28j60_capture_append(&capture, &frame[14], len - 14);
+			enc28j60_capture_commit(&capture);
+			expected[expected_count++] = (struct expected) { sequence, len, timestamp_us, flags };
+		}
+
+		/* A consumer falling behind: no reads for a while, so the ring overflows */
+		if (sequence % 50 < 40 && sequence % 3 == 0) {
+			drain(&capture);
+		}
+	}
+
+	/* A frame arriving while another one is being captured is dropped */
+	drain(&capture);
+	frame_fill(frame, 1, 60);
+	uint32_t dropped = capture.dropped;
+	bool busy_ok = enc28j60_capture_begin(&capture, frame, 60, 60, 0, ENC28J60_CAPTURE_INBOUND)
+			&& !enc28j60_capture_begin(&capture, frame, 60, 60, 0, ENC28J60_CAPTURE_INBOUND)
+			&& capture.dropped == dropped + 1;
+	enc28j60_capture_append(&capture, frame, 60);
+	enc28j60_capture_commit(&capture);
+	expected[expected_count++] = (struct expected) { 1, 60, 0, ENC28J60_CAPTURE_INBOUND };
+
+	drain(&capture);
+
+	bool ok = parse();
+	ok = check(busy_ok, "frame captured while busy", 0) && ok;
+	ok = check(capture.captured == expected_count && capture.filtered == filtered
+			&& capture.captured + capture.filtered + capture.dropped == FRAMES + 2, "bad counters", 0) && ok;
+	ok = check(capture.dropped > 1, "ring never overflowed", 0) && ok;
+
+	printf("captured %lu, filtered %lu, dropped %lu, stream %zu bytes: %s\n", (unsigned long) capture.captured,
+			(unsigned long) capture.filtered, (unsigned long) capture.dropped, stream_len, ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,153 @@
+#include <cstdio>
+#include <cstring>
+
+#include <hardware/spi.h>
+#include <pico/stdlib.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/mock.hpp>
+#include <pico/enc28j60/sim.h>
+
+/*
+ * The C++ driver template instantiated with the host policies against the simulated ENC28J60.
+ * Frames of every length are received and transmitted through Enc28j60<MockSpi, MockCs, NoLock, MockBufferPartition>
+ * and verified byte by byte, then the same receive and transmit sequence is run through the C driver on a second
+ * chip and the SPI traffic of both is compared.
+ *
+ * Exits with status 1 on any mismatch.
+ */
+
+/* Configuration */
+#define CS_PIN 10
+#define C_CS_PIN 11
+#define MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x92 }
+#define MIN_LEN 60  /* Frame lengths without CRC */
+#define MAX_LEN 1514
+#define STEP 7
+
+using namespace pico::enc28j60;
+
+using Spi = MockSpi<0>;
+using Eth = Enc28j60<Spi, MockCs<CS_PIN>, NoLock, MockBufferPartition<>>;
+
+static struct enc28j60_sim chip = {};
+static struct enc28j60_sim c_chip = {};
+static uint8_t sent[MAX_LEN];
+static size_t sent_len;
+static uint32_t failures;
+
+static void
+transmitted(struct enc28j60_sim *sim, const uint8_t *frame, size_t len, void *context)
+{
+	(void) sim;
+	(void) context;
+
+	memcpy(sent, frame, len);
+	sent_len = len;
+}
+
+static void
+check(bool condition, const char *what, uint16_t len)
+{
+	if (!condition) {
+		fprintf(stderr, "cpp_driver: %s, frame of %u bytes\n", what, len);
+		failures++;
+	}
+}
+
+static void
+fill(uint8_t *frame, uint16_t len)
+{
+	const uint8_t destination[] = MAC_ADDRESS;
+
+	memcpy(frame, destination, 6);
+	memset(&frame[6], 0x02, 6);
+	frame[12] = 0x88;  /* Local experimental EtherType */
+	frame[13] = 0xB5;
+	for (uint16_t i = 14; i < len; i++) {
+		frame[i] = (uint8_t) (len + i);
+	}
+}
+
+int
+main()
+{
+	const uint8_t mac_address[] = MAC_ADDRESS;
+	uint8_t frame[MAX_LEN];
+	uint8_t received[MAX_LEN];
+	uint8_t status[7];
+
+	spi_init(spi0, 8000000);
+	chip.spi = spi0;
+	chip.cs_pin = CS_PIN;
+	chip.on_transmit = transmitted;
+	enc28j60_sim_attach(&chip);
+	c_chip.spi = spi0;
+	c_chip.cs_pin = C_CS_PIN;
+	c_chip.on_transmit = transmitted;
+	enc28j60_sim_attach(&c_chip);
+
+	Eth eth(mac_address);
+	eth.init();
+	eth.interrupts(ENC28J60_PKTIE);
+
+	struct enc28j60 c_eth = {};
+	c_eth.spi = spi0;
+	c_eth.cs_pin = C_CS_PIN;
+	memcpy(c_eth.mac_address, mac_address, 6);
+	enc28j60_init(&c_eth);
+
+	uint64_t cpp_bytes = 0;
+	uint64_t c_bytes = 0;
+	uint32_t frames = 0;
+
+	for (uint16_t len = MIN_LEN; len <= MAX_LEN; len += STEP) {
+		fill(frame, len);
+
+		/* Receive */
+		check(enc28j60_sim_receive(&chip, frame, len), "frame not accepted", len);
+		check(eth.interrupt_flags() & ENC28J60_PKTIF, "PKTIF not set", len);
+		Spi::bytes = 0;
+		uint16_t received_len = eth.receive_init();
+		check(received_len == len, "wrong length received", len);
+		eth.receive_read(received, received_len);
+		eth.receive_ack();
+		cpp_bytes += Spi::bytes;
+		check(!memcmp(received, frame, len), "received frame differs", len);
+		check(enc28j60_sim_packets(&chip) == 0 && enc28j60_sim_rx_used(&chip) == 0, "frame not freed", len);
+
+		/* Transmit */
+		sent_len = 0;
+		Spi::bytes = 0;
+		eth.transfer_init();
+		eth.transfer_write(frame, 14);
+		eth.transfer_write(&frame[14], len - 14);
+		eth.transfer_send();
+		cpp_bytes += Spi::bytes;
+		eth.transfer_status(status);
+		check(sent_len == len && !memcmp(sent, frame, len), "transmitted frame differs", len);
+		check(ENC28J60_TX_STATUS_BIT(status, 23), "transmission not done", len);
+
+		/* Same sequence through the C driver */
+		enc28j60_sim_receive(&c_chip, frame, len);
+		c_eth.spi_bytes = 0;
+		enc28j60_receive_read(&c_eth, received, enc28j60_receive_init(&c_eth));
+		enc28j60_receive_ack(&c_eth);
+		enc28j60_transfer_init(&c_eth);
+		enc28j60_transfer_write(&c_eth, frame, 14);
+		enc28j60_transfer_write(&c_eth, &frame[14], len - 14);
+		enc28j60_transfer_send(&c_eth);
+		c_bytes += c_eth.spi_bytes;
+
+		frames++;
+	}
+
+	printf("%lu frames received and transmitted\n", (unsigned long) frames);
+	printf("SPI bytes per frame: C++ %.1f, C %.1f\n", (double) cpp_bytes / frames, (double) c_bytes / frames);
+	if (failures) {
+		printf("%lu failures\n", (unsigned long) failures);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,590 @@
+#include <string.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/sim.h>
+
+#define SIM_WIRE_NS_PER_BYTE 800  /* 10 Mbit/s */
+#define SIM_PREAMBLE 8  /* Preamble and start of frame delimiter */
+#define SIM_IPG 12  /* Inter packet gap */
+#define SIM_MII_NS 10240  /* MISTAT.BUSY time of a PHY register access */
+
+/* Receive status vector bits, as in the status word of the receive header */
+#define SIM_RSV_RECEIVED_OK 0x0080
+#define SIM_RSV_MULTICAST 0x0100
+#define SIM_RSV_BROADCAST 0x0200
+#define SIM_RSV_VLAN 0x4000
+
+static struct enc28j60_sim *enc28j60_sim_chips[ENC28J60_SIM_CHIPS];
+static uint64_t enc28j60_sim_now;
+
+/* Register storage of an address in the bank selected by ECON1 */
+static uint8_t *
+enc28j60_sim_register(struct enc28j60_sim *sim, uint8_t address)
+{
+	if (address >= 0x1B) {
+		return &sim->registers[0][address];
+	}
+
+	return &sim->registers[sim->registers[0][ENC28J60_ECON1] & 0x03][address];
+}
+
+static uint16_t
+enc28j60_sim_get16(const struct enc28j60_sim *sim, uint8_t bank, uint8_t address)
+{
+	return sim->registers[bank][address] | (uint16_t) sim->registers[bank][address + 1] << 8;
+}
+
+static void
+enc28j60_sim_set16(struct enc28j60_sim *sim, uint8_t bank, uint8_t address, uint16_t value)
+{
+	sim->registers[bank][address] = value & 0xFF;
+	sim->registers[bank][address + 1] = value >> 8;
+}
+
+/* MAC and MII registers return a dummy byte before their value */
+static bool
+enc28j60_sim_is_mac(const struct enc28j60_sim *sim, uint8_t address)
+{
+	uint8_t bank = sim->registers[0][ENC28J60_ECON1] & 0x03;
+
+	if (address >= 0x1B) {
+		return false;
+	}
+
+	return bank == 2 || (bank == 3 && (address <= ENC28J60_MAADR2 || address == ENC28J60_MISTAT));
+}
+
+static void
+enc28j60_sim_reset(struct enc28j60_sim *sim)
+{
+	memset(sim->registers, 0, sizeof(sim->registers));
+	memset(sim->phy, 0, sizeof(sim->phy));
+
+	sim->registers[0][ENC28J60_ECON2] = ENC28J60_AUTOINC;
+	sim->registers[0][ENC28J60_ESTAT] = ENC28J60_CLKRDY;
+	enc28j60_sim_set16(sim, 0, ENC28J60_ERDPT, 0x05FA);
+	enc28j60_sim_set16(sim, 0, ENC28J60_ERXST, 0x05FA);
+	enc28j60_sim_set16(sim, 0, ENC28J60_ERXND, 0x1FFF);
+	enc28j60_sim_set16(sim, 0, ENC28J60_ERXRDPT, 0x05FA);
+	enc28j60_sim_set16(sim, 0, ENC28J60_ERXWRPT, 0x05FA);
+	sim->registers[1][ENC28J60_ERXFCON] = ENC28J60_UCEN | ENC28J60_CRCEN | ENC28J60_BCEN;
+	enc28j60_sim_set16(sim, 2, ENC28J60_MAMXFL, 1536);
+	sim->registers[3][ENC28J60_EREVID] = 0x06;  /* Rev. B7 */
+
+	sim->phy[ENC28J60_PHID1] = 0x0083;
+	sim->phy[ENC28J60_PHID2] = 0x1400;
+	sim->phy[ENC28J60_PHSTAT2] = 0x0400;  /* LSTAT: the cable is plugged in */
+
+	sim->packets = 0;
+	sim->tx_done_ns = 0;
+	sim->mii_done_ns = 0;
+}
+
+void
+enc28j60_sim_attach(struct enc28j60_sim *sim)
+{
+	memset(sim->memory, 0, sizeof(sim->memory));
+	enc28j60_sim_reset(sim);
+	sim->selected = false;
+
+	for (size_t i = 0; i < ENC28J60_SIM_CHIPS; i++) {
+		if (enc28j60_sim_chips[i] == NULL) {
+			enc28j60_sim_chips[i] = sim;
+			return;
+		}
+	}
+}
+
+void
+enc28j60_sim_detach(struct enc28j60_sim *sim)
+{
+	for (size_t i = 0; i < ENC28J60_SIM_CHIPS; i++) {
+		if (enc28j60_sim_chips[i] == sim) {
+			enc28j60_sim_chips[i] = NULL;
+		}
+	}
+}
+
+static uint32_t
+enc28j60_sim_crc32(const uint8_t *data, size_t len)
+{
+	uint32_t crc = 0xFFFFFFFF;
+
+	for (size_t i = 0; i < len; i++) {
+		crc ^= data[i];
+		for (int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+		}
+	}
+
+	return ~crc;
+}
+
+static uint16_t
+enc28j60_sim_rx_size(const struct enc28j60_sim *sim)
+{
+	return enc28j60_sim_get16(sim, 0, ENC28J60_ERXND) - enc28j60_sim_get16(sim, 0, ENC28J60_ERXST) + 1;
+}
+
+/* Free bytes between the write pointer and ERXRDPT, the whole buffer if they are equal */
+static uint16_t
+enc28j60_sim_rx_free(const struct enc28j60_sim *sim)
+{
+	uint16_t size = enc28j60_sim_rx_size(sim);
+	uint16_t write = enc28j60_sim_get16(sim, 0, ENC28J60_ERXWRPT);
+	uint16_t read = enc28j60_sim_get16(sim, 0, ENC28J60_ERXRDPT);
+	uint16_t free = (uint16_t) ((read + size - write) % size);
+
+	return free ? free : size;
+}
+
+uint16_t
+enc28j60_sim_rx_used(const struct enc28j60_sim *sim)
+{
+	uint16_t free = enc28j60_sim_rx_free(sim);
+	uint16_t size = enc28j60_sim_rx_size(sim);
+
+	/* ERXRDPT trails the next frame by one byte (errata issue 14), which does not count as used */
+	return free == size ? 0 : size - free - 1;
+}
+
+uint16_t
+enc28j60_sim_rx_read_pointer(const struct enc28j60_sim *sim)
+{
+	return enc28j60_sim_get16(sim, 0, ENC28J60_ERXRDPT);
+}
+
+uint16_t
+enc28j60_sim_rx_write_pointer(const struct enc28j60_sim *sim)
+{
+	return enc28j60_sim_get16(sim, 0, ENC28J60_ERXWRPT);
+}
+
+uint8_t
+enc28j60_sim_packets(const struct enc28j60_sim *sim)
+{
+	return sim->packets;
+}
+
+/* Next address of the receive buffer, wrapping from ERXND to ERXST */
+static uint16_t
+enc28j60_sim_rx_next(const struct enc28j60_sim *sim, uint16_t address)
+{
+	if (address == enc28j60_sim_get16(sim, 0, ENC28J60_ERXND)) {
+		return enc28j60_sim_get16(sim, 0, ENC28J60_ERXST);
+	}
+
+	return (address + 1) % ENC28J60_SIM_MEMORY;
+}
+
+static bool
+enc28j60_sim_accept(const struct enc28j60_sim *sim, const uint8_t *frame)
+{
+	uint8_t filters = sim->registers[1][ENC28J60_ERXFCON];
+	const uint8_t mac[6] = {
+		sim->registers[3][ENC28J60_MAADR1], sim->registers[3][ENC28J60_MAADR2], sim->registers[3][ENC28J60_MAADR3],
+		sim->registers[3][ENC28J60_MAADR4], sim->registers[3][ENC28J60_MAADR5], sim->registers[3][ENC28J60_MAADR6],
+	};
+	static const uint8_t broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	bool and = filters & ENC28J60_ANDOR;
+	bool any = false;
+	bool all = true;
+
+	/* Promiscuous, CRCEN alone does not reject anything as frames are never corrupted */
+	if (!(filters & ~(ENC28J60_ANDOR | ENC28J60_CRCEN))) {
+		return true;
+	}
+
+	const struct {
+		uint8_t filter;
+		bool match;
+	} tests[] = {
+		{ ENC28J60_UCEN, !memcmp(frame, mac, 6) },
+		{ ENC28J60_BCEN, !memcmp(frame, broadcast, 6) },
+		{ ENC28J60_MCEN, (frame[0] & 0x01) && memcmp(frame, broadcast, 6) },
+		{ ENC28J60_PMEN, false },
+		{ ENC28J60_MPEN, false },
+		{ ENC28J60_HTEN, false },
+	};
+	for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+		if (filters & tests[i].filter) {
+			any |= tests[i].match;
+			all &= tests[i].match;
+		}
+	}
+
+	return and ? all : any;
+}
+
+bool
+enc28j60_sim_receive(struct enc28j60_sim *sim, const uint8_t *frame, size_t len)
+{
+	if (!(sim->registers[0][ENC28J60_ECON1] & ENC28J60_RXEN) || len < 14
+			|| len + 4 > enc28j60_sim_get16(sim, 2, ENC28J60_MAMXFL) || !enc28j60_sim_accept(sim, frame)) {
+		sim->rx_filtered++;
+		return false;
+	}
+
+	if (sim->packets == 255) {
+		sim->rx_saturated++;
+		sim->registers[0][ENC28J60_EIR] |= ENC28J60_RXERIF;
+		return false;
+	}
+
+	/* Header, frame and CRC, the next frame starts at an even address */
+	size_t count = len + 4;
+	size_t needed = 6 + count + (count & 1);
+	if (needed >= enc28j60_sim_rx_free(sim)) {
+		sim->rx_overflows++;
+		sim->registers[0][ENC28J60_EIR] |= ENC28J60_RXERIF;
+		sim->registers[0][ENC28J60_ESTAT] |= ENC28J60_BUFER;
+		return false;
+	}
+
+	uint16_t write = enc28j60_sim_get16(sim, 0, ENC28J60_ERXWRPT);
+	uint16_t next = write;
+	for (size_t i = 0; i < needed; i++) {
+		next = enc28j60_sim_rx_next(sim, next);
+	}
+
+	uint16_t status = SIM_RSV_RECEIVED_OK;
+	if (frame[0] & 0x01) {
+		status |= memcmp(frame, "\xFF\xFF\xFF\xFF\xFF\xFF", 6) ? SIM_RSV_MULTICAST : SIM_RSV_BROADCAST;
+	}
+	if (frame[12] == 0x81 && frame[13] == 0x00) {
+		status |= SIM_RSV_VLAN;
+	}
+
+	uint32_t crc = enc28j60_sim_crc32(frame, len);
+	uint8_t header[6] = { next & 0xFF, next >> 8, count & 0xFF, count >> 8, status & 0xFF, status >> 8 };
+	uint8_t trailer[4] = { crc & 0xFF, crc >> 8 & 0xFF, crc >> 16 & 0xFF, crc >> 24 };
+	for (size_t i = 0; i < 6 + count; i++) {
+		if (i < 6) {
+			sim->memory[write] = header[i];
+		} else if (i < 6 + len) {
+			sim->memory[write] = frame[i - 6];
+		} else {
+			sim->memory[write] = trailer[i - 6 - len];
+		}
+		write = enc28j60_sim_rx_next(sim, write);
+	}
+
+	enc28j60_sim_set16(sim, 0, ENC28J60_ERXWRPT, next);
+	sim->packets++;
+	sim->registers[0][ENC28J60_EIR] |= ENC28J60_PKTIF;
+	sim->rx_frames++;
+
+	uint16_t used = enc28j60_sim_rx_used(sim);
+	if (used > sim->rx_max_used) {
+		sim->rx_max_used = used;
+	}
+
+	return true;
+}
+
+bool
+enc28j60_sim_interrupt(struct enc28j60_sim *sim)
+{
+	uint8_t eie = sim->registers[0][ENC28J60_EIE];
+
+	return (eie & ENC28J60_INTIE) && (eie & sim->registers[0][ENC28J60_EIR] & 0x7F);
+}
+
+/*
+ * Pad a frame as configured in MACON3 or overridden by its per packet control byte.
+ * \param crc set if a CRC is appended on the wire
+ * \return length of the padded frame, without CRC
+ */
+static size_t
+enc28j60_sim_pad(const struct enc28j60_sim *sim, uint8_t *frame, size_t len, uint8_t control, bool *crc)
+{
+	uint8_t macon3 = sim->registers[2][ENC28J60_MACON3];
+	bool pad = macon3 & 0x20;
+	size_t min = 60;
+
+	*crc = macon3 & ENC28J60_TXCRCEN;
+	if (control & 0x01) {
+		/* POVERRIDE: PCRCEN and PPADEN replace the MACON3 settings */
+		*crc = control & 0x02;
+		pad = control & 0x04;
+	} else if ((macon3 & 0xE0) == ENC28J60_PADCFG_64) {
+		min = 64;
+	} else if ((macon3 & 0xE0) == ENC28J60_PADCFG_VLAN && len >= 14 && frame[12] == 0x81 && frame[13] == 0x00) {
+		min = 64;
+	}
+
+	if (pad) {
+		*crc = true;
+		while (len < min) {
+			frame[len++] = 0;
+		}
+	}
+
+	return len;
+}
+
+static void
+enc28j60_sim_transmit(struct enc28j60_sim *sim)
+{
+	uint16_t start = enc28j60_sim_get16(sim, 0, ENC28J60_ETXST);
+	uint16_t end = enc28j60_sim_get16(sim, 0, ENC28J60_ETXND);
+	size_t len = end >= start ? end - start : 0;
+	uint8_t frame[ENC28J60_SIM_MEMORY + 64];
+	bool crc;
+
+	memcpy(frame, &sim->memory[start + 1], len);
+	len = enc28j60_sim_pad(sim, frame, len, sim->memory[start], &crc);
+	size_t wire_len = len + (crc ? 4 : 0);
+
+	/* Status vector after the frame */
+	uint8_t status[7] = { 0 };
+	status[0] = wire_len & 0xFF;
+	status[1] = wire_len >> 8;
+	status[2] = 0x80;  /* Transmit Done */
+	if (len && (frame[0] & 0x01)) {
+		status[3] = memcmp(frame, "\xFF\xFF\xFF\xFF\xFF\xFF", 6) ? 0x01 : 0x02;
+	}
+	status[4] = (wire_len + SIM_PREAMBLE) & 0xFF;
+	status[5] = (wire_len + SIM_PREAMBLE) >> 8;
+	for (size_t i = 0; i < sizeof(status); i++) {
+		sim->memory[(end + 1 + i) % ENC28J60_SIM_MEMORY] = status[i];
+	}
+
+	sim->registers[0][ENC28J60_ECON1] &= ~ENC28J60_TXRTS;
+	sim->registers[0][ENC28J60_EIR] |= ENC28J60_TXIF;
+	sim->tx_frames++;
+
+	if (sim->phy[ENC28J60_PHCON1] & ENC28J60_PLOOPBK) {
+		enc28j60_sim_receive(sim, frame, len);
+	} else if (sim->peer != NULL) {
+		enc28j60_sim_receive(sim->peer, frame, len);
+	}
+	if (sim->on_transmit != NULL) {
+		sim->on_transmit(sim, frame, len, sim->context);
+	}
+}
+
+/* Start a transmission, the frame leaves the wire after its wire time */
+static void
+enc28j60_sim_transmit_start(struct enc28j60_sim *sim)
+{
+	uint16_t start = enc28j60_sim_get16(sim, 0, ENC28J60_ETXST);
+	uint16_t end = enc28j60_sim_get16(sim, 0, ENC28J60_ETXND);
+	size_t len = end >= start ? end - start : 0;
+
+	if (len < 60) {
+		len = 60;
+	}
+	sim->tx_done_ns = enc28j60_sim_now + (SIM_PREAMBLE + len + 4 + SIM_IPG) * SIM_WIRE_NS_PER_BYTE;
+}
+
+static void
+enc28j60_sim_dma(struct enc28j60_sim *sim)
+{
+	uint16_t source = enc28j60_sim_get16(sim, 0, ENC28J60_EDMAST);
+	uint16_t end = enc28j60_sim_get16(sim, 0, ENC28J60_EDMAND);
+	uint16_t destination = enc28j60_sim_get16(sim, 0, ENC28J60_EDMADST);
+	bool checksum = sim->registers[0][ENC28J60_ECON1] & ENC28J60_CSUMEN;
+	uint32_t sum = 0;
+	size_t index = 0;
+
+	for (;;) {
+		uint8_t data = sim->memory[source];
+		if (checksum) {
+			sum += (index & 1) ? data : (uint32_t) data << 8;
+		} else {
+			sim->memory[destination] = data;
+			destination = (destination + 1) % ENC28J60_SIM_MEMORY;
+		}
+		index++;
+
+		if (source == end) {
+			break;
+		}
+		source = enc28j60_sim_rx_next(sim, source);
+	}
+
+	if (checksum) {
+		while (sum >> 16) {
+			sum = (sum & 0xFFFF) + (sum >> 16);
+		}
+		/* EDMACS holds the checksum big endian, as it is written into packets */
+		sim->registers[0][ENC28J60_EDMACS] = ~sum >> 8 & 0xFF;
+		sim->registers[0][ENC28J60_EDMACS + 1] = ~sum & 0xFF;
+	}
+
+	sim->registers[0][ENC28J60_ECON1] &= ~ENC28J60_DMAST;
+	sim->registers[0][ENC28J60_EIR] |= ENC28J60_DMAIF;
+}
+
+/* Side effects of changing a control register from old to its current value */
+static void
+enc28j60_sim_written(struct enc28j60_sim *sim, uint8_t address, uint8_t old)
+{
+	uint8_t bank = sim->registers[0][ENC28J60_ECON1] & 0x03;
+	uint8_t *reg = enc28j60_sim_register(sim, address);
+	uint8_t set = *reg & ~old;
+
+	if (address == ENC28J60_ECON1) {
+		if (*reg & ENC28J60_TXRST) {
+			*reg &= ~ENC28J60_TXRTS;
+			sim->tx_done_ns = 0;
+		} else if (set & ENC28J60_TXRTS) {
+			enc28j60_sim_transmit_start(sim);
+		}
+		if (set & ENC28J60_DMAST) {
+			enc28j60_sim_dma(sim);
+		}
+	} else if (address == ENC28J60_ECON2) {
+		if (*reg & ENC28J60_PKTDEC) {
+			*reg &= ~ENC28J60_PKTDEC;
+			if (sim->packets) {
+				sim->packets--;
+			}
+		}
+	} else if (address == ENC28J60_EIR) {
+		/* PKTIF is read-only and follows EPKTCNT */
+		*reg = (*reg & ~ENC28J60_PKTIF) | (sim->packets ? ENC28J60_PKTIF : 0);
+	} else if (bank == 0 && (address == ENC28J60_ERXST || address == ENC28J60_ERXST + 1)) {
+		enc28j60_sim_set16(sim, 0, ENC28J60_ERXWRPT, enc28j60_sim_get16(sim, 0, ENC28J60_ERXST));
+	} else if (bank == 0 && (address == ENC28J60_ERXWRPT || address == ENC28J60_ERXWRPT + 1)) {
+		*reg = old;  /* Read-only */
+	} else if (bank == 2 && address == ENC28J60_MICMD && (set & ENC28J60_MIIRD)) {
+		uint8_t phy = sim->registers[2][ENC28J60_MIREGADR] & 0x1F;
+		enc28j60_sim_set16(sim, 2, ENC28J60_MIRD, sim->phy[phy]);
+		sim->mii_done_ns = enc28j60_sim_now + SIM_MII_NS;
+	} else if (bank == 2 && address == ENC28J60_MIWR + 1) {
+		/* Writing MIWRH starts the PHY write */
+		uint8_t phy = sim->registers[2][ENC28J60_MIREGADR] & 0x1F;
+		uint16_t value = enc28j60_sim_get16(sim, 2, ENC28J60_MIWR);
+		sim->phy[phy] = phy == ENC28J60_PHCON1 ? value & ~ENC28J60_PRST : value;
+		sim->mii_done_ns = enc28j60_sim_now + SIM_MII_NS;
+	}
+}
+
+static uint8_t
+enc28j60_sim_read_register(struct enc28j60_sim *sim, uint8_t address)
+{
+	uint8_t bank = sim->registers[0][ENC28J60_ECON1] & 0x03;
+
+	if (address == ENC28J60_EIR) {
+		uint8_t *eir = enc28j60_sim_register(sim, address);
+		*eir = (*eir & ~ENC28J60_PKTIF) | (sim->packets ? ENC28J60_PKTIF : 0);
+	} else if (bank == 1 && address == ENC28J60_EPKTCNT) {
+		return sim->packets;
+	} else if (bank == 3 && address == ENC28J60_MISTAT) {
+		return enc28j60_sim_now < sim->mii_done_ns ? ENC28J60_BUSY : 0;
+	}
+
+	return *enc28j60_sim_register(sim, address);
+}
+
+static uint8_t
+enc28j60_sim_byte(struct enc28j60_sim *sim, uint8_t mosi)
+{
+	size_t position = sim->position++;
+	uint8_t address = sim->instruction & 0x1F;
+
+	if (position == 0) {
+		sim->instruction = mosi;
+		if ((mosi & 0xE0) == ENC28J60_SRC) {
+			enc28j60_sim_reset(sim);
+		}
+		return 0xFF;
+	}
+
+	switch (sim->instruction & 0xE0) {
+	case ENC28J60_RCR:
+		if (position == 1 && enc28j60_sim_is_mac(sim, address)) {
+			return 0x00;  /* Dummy byte */
+		}
+		return enc28j60_sim_read_register(sim, address);
+	case ENC28J60_WCR:
+		if (position == 1) {
+			uint8_t *reg = enc28j60_sim_register(sim, address);
+			uint8_t old = *reg;
+			*reg = mosi;
+			enc28j60_sim_written(sim, address, old);
+		}
+		return 0xFF;
+	case ENC28J60_BFS:
+	case ENC28J60_BFC:
+		if (position == 1) {
+			uint8_t *reg = enc28j60_sim_register(sim, address);
+			uint8_t old = *reg;
+			*reg = (sim->instruction & 0xE0) == ENC28J60_BFS ? old | mosi : old & ~mosi;
+			enc28j60_sim_written(sim, address, old);
+		}
+		return 0xFF;
+	case ENC28J60_RBM: {
+		uint16_t pointer = enc28j60_sim_get16(sim, 0, ENC28J60_ERDPT);
+		uint8_t data = sim->memory[pointer];
+		if (sim->registers[0][ENC28J60_ECON2] & ENC28J60_AUTOINC) {
+			enc28j60_sim_set16(sim, 0, ENC28J60_ERDPT, enc28j60_sim_rx_next(sim, pointer));
+		}
+		return data;
+	}
+	case ENC28J60_WBM: {
+		uint16_t pointer = enc28j60_sim_get16(sim, 0, ENC28J60_EWRPT);
+		sim->memory[pointer] = mosi;
+		if (sim->registers[0][ENC28J60_ECON2] & ENC28J60_AUTOINC) {
+			enc28j60_sim_set16(sim, 0, ENC28J60_EWRPT, (pointer + 1) % ENC28J60_SIM_MEMORY);
+		}
+		return 0xFF;
+	}
+	default:
+		return 0xFF;
+	}
+}
+
+uint64_t
+enc28j60_sim_time_ns(void)
+{
+	return enc28j60_sim_now;
+}
+
+void
+enc28j60_sim_advance(uint64_t ns)
+{
+	enc28j60_sim_now += ns;
+
+	for (size_t i = 0; i < ENC28J60_SIM_CHIPS; i++) {
+		struct enc28j60_sim *sim = enc28j60_sim_chips[i];
+		if (sim != NULL && sim->tx_done_ns && sim->tx_done_ns <= enc28j60_sim_now) {
+			sim->tx_done_ns = 0;
+			enc28j60_sim_transmit(sim);
+		}
+		if (sim != NULL && sim->on_advance != NULL) {
+			sim->on_advance(sim, enc28j60_sim_now, sim->context);
+		}
+	}
+}
+
+void
+enc28j60_sim_select(uint8_t cs_pin, bool selected)
+{
+	for (size_t i = 0; i < ENC28J60_SIM_CHIPS; i++) {
+		struct enc28j60_sim *sim = enc28j60_sim_chips[i];
+		if (sim != NULL && sim->cs_pin == cs_pin) {
+			sim->selected = selected;
+			sim->position = 0;
+		}
+	}
+}
+
+uint8_t
+enc28j60_sim_spi_transfer(struct spi_inst *spi, uint32_t baudrate, uint8_t mosi)
+{
+	uint8_t miso = 0xFF;
+
+	enc28j60_sim_advance(8000000000ull / (baudrate ? baudrate : 1000000));
+
+	for (size_t i = 0; i < ENC28J60_SIM_CHIPS; i++) {
+		struct enc28j60_sim *sim = enc28j60_sim_chips[i];
+		if (sim != NULL && sim->selected && sim->spi == spi) {
+			miso = enc28j60_sim_byte(sim, mosi);
+		}
+	}
+
+	return miso;
+}
@@ -0,0 +1,21 @@
+#ifndef ENC28J60_SIM_HARDWARE_CLOCKS_H
+#define ENC28J60_SIM_HARDWARE_CLOCKS_H
+
+#include <pico/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum clock_index {
+	clk_sys = 5,
+};
+
+/* Frequency of the modelled RP2040, the SDK default of 125 MHz */
+uint32_t clock_get_hz(enum clock_index clk_index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef ENC28J60_SIM_HARDWARE_DMA_H
+#define ENC28J60_SIM_HARDWARE_DMA_H
+
+#include <pico/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * DMA is only used by command lists on the PIO transport, which is not simulated. Channels can be claimed so
+ * enc28j60_cmdlist_init works, command lists then run on the SPI path.
+ */
+enum dma_channel_transfer_size {
+	DMA_SIZE_8 = 0,
+	DMA_SIZE_16 = 1,
+	DMA_SIZE_32 = 2,
+};
+
+typedef struct {
+	uint32_t ctrl;
+} dma_channel_config;
+
+int dma_claim_unused_channel(bool required);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+		const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_start_channel_mask(uint32_t chan_mask);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_wait_for_finish_blocking(uint channel);
+
+static inline dma_channel_config
+dma_channel_get_default_config(uint channel)
+{
+	(void) channel;
+
+	return (dma_channel_config) { 0 };
+}
+
+static inline void
+channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+	(void) c;
+	(void) size;
+}
+
+static inline void
+channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+	(void) c;
+	(void) incr;
+}
+
+static inline void
+channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+	(void) c;
+	(void) incr;
+}
+
+static inline void
+channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+	(void) c;
+	(void) dreq;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef ENC28J60_SIM_HARDWARE_PIO_H
+#define ENC28J60_SIM_HARDWARE_PIO_H
+
+#include <pico/types.h>
+
+/* The PIO transport is not simulated, the types only exist so pico/enc28j60/pio.h and src/cmdlist.c compile */
+typedef struct pio_hw {
+	uint32_t txf[4];
+	uint32_t rxf[4];
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+
+static inline uint
+pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+	(void) pio;
+
+	return (is_tx ? 0 : 4) + sm;
+}
+
+#endif
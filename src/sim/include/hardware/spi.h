@@ -0,0 +1,30 @@
+#ifndef ENC28J60_SIM_HARDWARE_SPI_H
+#define ENC28J60_SIM_HARDWARE_SPI_H
+
+#include <pico/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* SPI instance of the host build: every byte advances the virtual clock by 8 SPI clock periods */
+typedef struct spi_inst {
+	uint baudrate;
+} spi_inst_t;
+
+extern spi_inst_t enc28j60_sim_spi[2];
+
+#define spi0 (&enc28j60_sim_spi[0])
+#define spi1 (&enc28j60_sim_spi[1])
+
+uint spi_init(spi_inst_t *spi, uint baudrate);
+uint spi_set_baudrate(spi_inst_t *spi, uint baudrate);
+int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len);
+int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len);
+int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
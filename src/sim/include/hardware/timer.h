@@ -0,0 +1,22 @@
+#ifndef ENC28J60_SIM_HARDWARE_TIMER_H
+#define ENC28J60_SIM_HARDWARE_TIMER_H
+
+#include <pico/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t time_us_64(void);
+
+static inline uint32_t
+time_us_32(void)
+{
+	return (uint32_t) time_us_64();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
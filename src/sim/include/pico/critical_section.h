@@ -0,0 +1,27 @@
+#ifndef ENC28J60_SIM_PICO_CRITICAL_SECTION_H
+#define ENC28J60_SIM_PICO_CRITICAL_SECTION_H
+
+/* The host build runs single threaded, critical sections only keep their bookkeeping */
+typedef struct critical_section {
+	int depth;
+} critical_section_t;
+
+static inline void
+critical_section_init(critical_section_t *crit_sec)
+{
+	crit_sec->depth = 0;
+}
+
+static inline void
+critical_section_enter_blocking(critical_section_t *crit_sec)
+{
+	crit_sec->depth++;
+}
+
+static inline void
+critical_section_exit(critical_section_t *crit_sec)
+{
+	crit_sec->depth--;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef ENC28J60_MOCK_HPP
+#define ENC28J60_MOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <hardware/spi.h>
+
+#include <pico/enc28j60/enc28j60.hpp>
+#include <pico/enc28j60/sim.h>
+
+/*
+ * Host policies for pico::enc28j60::Enc28j60, see pico/enc28j60/enc28j60.hpp.
+ * The bus and chip select go to the simulated chips (see pico/enc28j60/sim.h), delays advance the virtual clock.
+ */
+
+namespace pico {
+namespace enc28j60 {
+
+/* SPI bus of the shim (0 for spi0, 1 for spi1) at its configured baud rate, counting the clocked bytes. */
+template <unsigned Index>
+struct MockSpi {
+	static_assert(Index < 2, "the shim has spi0 and spi1");
+
+	/* Bytes clocked since start, write 0 to restart the measurement. */
+	static uint64_t bytes;
+
+	static void
+	transfer(const uint8_t *tx, uint8_t *rx, size_t len)
+	{
+		spi_inst_t *spi = &enc28j60_sim_spi[Index];
+
+		for (size_t i = 0; i < len; i++) {
+			uint8_t byte = enc28j60_sim_spi_transfer(spi, spi->baudrate, tx != nullptr ? tx[i] : 0);
+			if (rx != nullptr) {
+				rx[i] = byte;
+			}
+		}
+		bytes += len;
+	}
+};
+
+template <unsigned Index>
+uint64_t MockSpi<Index>::bytes = 0;
+
+/* Chip select of the simulated chip attached to Pin. */
+template <unsigned Pin>
+struct MockCs {
+	static void select() { enc28j60_sim_select(Pin, true); }
+	static void deselect() { enc28j60_sim_select(Pin, false); }
+};
+
+inline void
+sim_delay_us(uint32_t us)
+{
+	enc28j60_sim_advance((uint64_t) us * 1000);
+}
+
+/* Buffer partition with a receive buffer of RxBufferSize bytes, delays on the virtual clock. */
+template <uint16_t RxBufferSize = 6666>
+using MockBufferPartition = BufferPartition<RxBufferSize, sim_delay_us>;
+
+} // namespace enc28j60
+} // namespace pico
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef ENC28J60_SIM_H
+#define ENC28J60_SIM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ENC28J60_SIM_MEMORY 8192  /* Buffer memory of the chip */
+#define ENC28J60_SIM_CHIPS 8  /* Most chips attached at once */
+
+struct spi_inst;
+
+/*
+ * Simulated ENC28J60 for host builds.
+ * The chip is driven byte by byte over the SPI shim (src/sim/pico.c), so the unmodified driver runs against it.
+ * Modelled: the SPI instruction set, banked control registers, buffer memory with the receive ring and its
+ * wrap-around, receive filters (unicast, broadcast, multicast), the receive status vector, EPKTCNT with its limit of
+ * 255, PKTDEC, transmission with padding, CRC and status vector, the DMA copy and checksum engine, PHY registers
+ * through the MII interface, PHY loopback and the interrupt flags.
+ * Not modelled: pattern, hash and magic packet filters, flow control, power saving and the PIO transport.
+ *
+ * Time is virtual. Every SPI byte takes 8 clock periods of its bus, sleep_us advances the clock, and a transmitted
+ * frame occupies the 10 Mbit/s wire for its preamble, CRC and inter packet gap. Host CPU time is not counted, so
+ * results do not depend on the machine running them.
+ */
+struct enc28j60_sim {
+
+	/* SPI bus (spi0 or spi1 of the shim) and chip select pin the chip is attached to. */
+	struct spi_inst *spi;
+	uint8_t cs_pin;
+
+	/* Chip receiving the frames this chip transmits while PHY loopback is off, NULL if the cable is unplugged. */
+	struct enc28j60_sim *peer;
+
+	/*
+	 * Called for every transmitted frame, without CRC, when the frame leaves the wire.
+	 * Set to NULL if not needed.
+	 */
+	void (*on_transmit)(struct enc28j60_sim *sim, const uint8_t *frame, size_t len, void *context);
+
+	/*
+	 * Called every time the clock advances, including once per SPI byte, for example to deliver frames arriving
+	 * from the wire at their arrival time. MUST NOT advance the clock itself.
+	 * Set to NULL if not needed.
+	 */
+	void (*on_advance)(struct enc28j60_sim *sim, uint64_t now_ns, void *context);
+
+	/* Context of on_transmit and on_advance. */
+	void *context;
+
+	/*
+	 * Counters: frames transmitted, frames written to the receive buffer, frames rejected by the receive filters,
+	 * dropped for lack of buffer space and dropped because EPKTCNT was 255.
+	 */
+	uint32_t tx_frames;
+	uint32_t rx_frames;
+	uint32_t rx_filtered;
+	uint32_t rx_overflows;
+	uint32_t rx_saturated;
+
+	/* Highest number of bytes held in the receive buffer. */
+	uint16_t rx_max_used;
+
+	/* Chip state. Managed by the simulator. */
+	uint8_t memory[ENC28J60_SIM_MEMORY];
+	uint8_t registers[4][32];  /* Common registers 0x1B-0x1F are kept in bank 0 */
+	uint16_t phy[32];
+	uint8_t packets;  /* EPKTCNT */
+	bool selected;
+	uint8_t instruction;
+	size_t position;
+	uint64_t tx_done_ns;  /* Wire time of the frame being transmitted, 0 if idle */
+	uint64_t mii_done_ns;
+
+};
+
+/* Power-on reset the chip and attach it to its SPI bus and chip select pin. */
+void enc28j60_sim_attach(struct enc28j60_sim *sim);
+
+/* Detach a chip, so its chip select pin can be reused. */
+void enc28j60_sim_detach(struct enc28j60_sim *sim);
+
+/*
+ * A frame arrives from the wire now.
+ * \param frame destination address to the end of the payload, without CRC
+ * \return true if the frame was written to the receive buffer
+ */
+bool enc28j60_sim_receive(struct enc28j60_sim *sim, const uint8_t *frame, size_t len);
+
+/* \return true while the INT pin is asserted (an enabled interrupt flag is set and EIE.INTIE is set) */
+bool enc28j60_sim_interrupt(struct enc28j60_sim *sim);
+
+/* \return number of bytes of received frames held in the receive buffer, between ERXRDPT and the write pointer */
+uint16_t enc28j60_sim_rx_used(const struct enc28j60_sim *sim);
+
+/* \return address up to which the receive buffer is reserved for frames not read yet (ERXRDPT) */
+uint16_t enc28j60_sim_rx_read_pointer(const struct enc28j60_sim *sim);
+
+/* \return address at which the chip writes the next received frame (ERXWRPT) */
+uint16_t enc28j60_sim_rx_write_pointer(const struct enc28j60_sim *sim);
+
+/* \return number of received frames not decremented with PKTDEC yet (EPKTCNT) */
+uint8_t enc28j60_sim_packets(const struct enc28j60_sim *sim);
+
+/* Virtual time since start, in nanoseconds. */
+uint64_t enc28j60_sim_time_ns(void);
+
+/* Advance the virtual clock, completing transmissions and other timed operations of all attached chips. */
+void enc28j60_sim_advance(uint64_t ns);
+
+/*
+ * Raise a GPIO interrupt, calling the callback set with gpio_set_irq_enabled_with_callback if any of the events is
+ * enabled on the pin. The simulator does not drive INT pins itself; poll enc28j60_sim_interrupt to find edges.
+ */
+void enc28j60_sim_gpio_irq(uint8_t gpio, uint32_t events);
+
+/* Select or deselect the chip attached to a chip select pin. Called by the GPIO shim. */
+void enc28j60_sim_select(uint8_t cs_pin, bool selected);
+
+/*
+ * Clock one byte over a bus, exchanging it with the selected chip if any.
+ * Called by the SPI shim.
+ * \return byte clocked in on MISO
+ */
+uint8_t enc28j60_sim_spi_transfer(struct spi_inst *spi, uint32_t baudrate, uint8_t mosi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef ENC28J60_SIM_PICO_PLATFORM_H
+#define ENC28J60_SIM_PICO_PLATFORM_H
+
+#include <pico/types.h>
+
+static inline void
+tight_loop_contents(void)
+{
+}
+
+/* The host build runs everything on core 0 */
+static inline uint
+get_core_num(void)
+{
+	return 0;
+}
+
+#endif
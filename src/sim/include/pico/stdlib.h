@@ -0,0 +1,18 @@
+#ifndef ENC28J60_SIM_PICO_STDLIB_H
+#define ENC28J60_SIM_PICO_STDLIB_H
+
+#include <stdio.h>
+
+#include <hardware/gpio.h>
+#include <hardware/timer.h>
+#include <pico/platform.h>
+#include <pico/time.h>
+#include <pico/types.h>
+
+static inline bool
+stdio_init_all(void)
+{
+	return true;
+}
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef ENC28J60_SIM_PICO_TIME_H
+#define ENC28J60_SIM_PICO_TIME_H
+
+#include <pico/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Host replacements of the Pico SDK time functions, running on the virtual clock of the simulator. */
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+absolute_time_t get_absolute_time(void);
+
+static inline uint64_t
+to_us_since_boot(absolute_time_t t)
+{
+	return t;
+}
+
+static inline uint32_t
+to_ms_since_boot(absolute_time_t t)
+{
+	return (uint32_t) (t / 1000);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
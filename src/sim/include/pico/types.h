@@ -0,0 +1,11 @@
+#ifndef ENC28J60_SIM_PICO_TYPES_H
+#define ENC28J60_SIM_PICO_TYPES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#endif
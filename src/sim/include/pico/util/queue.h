@@ -0,0 +1,66 @@
+#ifndef ENC28J60_SIM_PICO_UTIL_QUEUE_H
+#define ENC28J60_SIM_PICO_UTIL_QUEUE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <pico/types.h>
+
+/* The host build runs single threaded, the queue is a plain ring of fixed-size elements */
+typedef struct {
+	uint8_t *data;
+	uint element_size;
+	uint element_count;
+	uint read;
+	uint level;
+} queue_t;
+
+static inline void
+queue_init(queue_t *q, uint element_size, uint element_count)
+{
+	q->data = calloc(element_count, element_size);
+	q->element_size = element_size;
+	q->element_count = element_count;
+	q->read = 0;
+	q->level = 0;
+}
+
+static inline void
+queue_free(queue_t *q)
+{
+	free(q->data);
+	q->data = NULL;
+}
+
+static inline uint
+queue_get_level_unsafe(queue_t *q)
+{
+	return q->level;
+}
+
+static inline bool
+queue_try_add(queue_t *q, const void *data)
+{
+	if (q->level == q->element_count) {
+		return false;
+	}
+	memcpy(&q->data[(q->read + q->level) % q->element_count * q->element_size], data, q->element_size);
+	q->level++;
+
+	return true;
+}
+
+static inline bool
+queue_try_remove(queue_t *q, void *data)
+{
+	if (!q->level) {
+		return false;
+	}
+	memcpy(data, &q->data[q->read * q->element_size], q->element_size);
+	q->read = (q->read + 1) % q->element_count;
+	q->level--;
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef ENC28J60_SIM_ARCH_CC_H
+#define ENC28J60_SIM_ARCH_CC_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* lwIP port of the host benchmark, the defaults of lwip/arch.h cover the rest */
+#define LWIP_RAND() ((u32_t) rand())
+
+#endif
@@ -0,0 +1,266 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "lwip/init.h"
+#include "lwip/pbuf.h"
+
+#include <pico/stdlib.h>
+
+#include <pico/enc28j60/dispatch.h>
+
+/*
+ * Test of the flow hash of the receive dispatcher.
+ * Frames are built as low_level_input delivers them, after ETH_PAD_SIZE bytes of padding that are filled with
+ * garbage, and split over two pbufs at every offset. The hash has to be symmetric, ignore an 802.1Q tag and IP
+ * options, hash every fragment of a datagram alike, and depend on the TCP and UDP ports. Built once without and once
+ * with ETH_PAD_SIZE (see CMakeLists.txt). Exits with status 1 on the first mismatch.
+ */
+
+/* Configuration */
+#define FLOWS 256
+#define FRAME_MAX 128
+
+/* Two endpoints of a flow */
+struct flow {
+	u8_t mac[2][6];
+	u8_t ip[2][4];
+	u8_t protocol;
+	u16_t port[2];
+};
+
+/* Shape of a frame */
+struct shape {
+	u16_t ethertype;
+	u16_t vlan;  /* VLAN identifier, 0 if untagged */
+	u8_t options;  /* IP option bytes, a multiple of 4 */
+	u16_t fragment;  /* Flags and fragment offset */
+	u8_t fill;  /* Seed of the transport bytes of non-first fragments */
+};
+
+static u32_t sequence;
+static bool ok = true;
+
+static void
+check(bool condition, const char *what)
+{
+	if (!condition) {
+		fprintf(stderr, "flow %lu: %s\n", (unsigned long) sequence, what);
+		ok = false;
+	}
+}
+
+static void
+put16(u8_t *data, u16_t value)
+{
+	data[0] = value >> 8;
+	data[1] = value & 0xFF;
+}
+
+/*
+ * Build a frame of a flow.
+ * \param from endpoint sending the frame
+ * \return length of the frame
+ */
+static u16_t
+build(u8_t *frame, const struct flow *flow, u8_t from, const struct shape *shape)
+{
+	u8_t to = !from;
+	u16_t offset = 12;
+
+	memcpy(frame, flow->mac[to], 6);
+	memcpy(&frame[6], flow->mac[from], 6);
+	if (shape->vlan) {
+		put16(&frame[12], 0x8100);
+		put16(&frame[14], shape->vlan);
+		offset += 4;
+	}
+	put16(&frame[offset], shape->ethertype);
+	offset += 2;
+
+	if (shape->ethertype != 0x0800) {
+		for (u16_t i = offset; i < 60; i++) {
+			frame[i] = (u8_t) (i * 7);
+		}
+		return 60;
+	}
+
+	u8_t *ip = &frame[offset];
+	u8_t ip_len = 20 + shape->options;
+	memset(ip, 0, ip_len);
+	ip[0] = 0x40 | ip_len / 4;
+	put16(&ip[2], ip_len + 8);
+	put16(&ip[6], shape->fragment);
+	ip[8] = 64;
+	ip[9] = flow->protocol;
+	memcpy(&ip[12], flow->ip[from], 4);
+	memcpy(&ip[16], flow->ip[to], 4);
+	for (u8_t i = 0; i < shape->options; i++) {
+		ip[20 + i] = 1;  /* No operation */
+	}
+
+	/* Ports, or data of a fragment other than the first */
+	u8_t *transport = &ip[ip_len];
+	if (shape->fragment & 0x1FFF) {
+		for (u8_t i = 0; i < 8; i++) {
+			transport[i] = (u8_t) (shape->fill * 29 + i);
+		}
+	} else {
+		put16(&transport[0], flow->port[from]);
+		put16(&transport[2], flow->port[to]);
+		put16(&transport[4], 8);
+		put16(&transport[6], 0);
+	}
+
+	u16_t len = offset + ip_len + 8;
+	if (len < 60) {
+		memset(&frame[len], 0, 60 - len);
+		len = 60;
+	}
+	return len;
+}
+
+/*
+ * Hash a frame in a pbuf chain split at every offset, as delivered with padding.
+ * \return hash, the same for every split
+ */
+static u32_t
+hash(const u8_t *frame, u16_t len)
+{
+	u8_t padded[ETH_PAD_SIZE + FRAME_MAX];
+	u16_t total = ETH_PAD_SIZE + len;
+	u32_t first = 0;
+
+	#if ETH_PAD_SIZE
+	memset(padded, 0xA5, ETH_PAD_SIZE);  /* Never part of the hash */
+	#endif
+	memcpy(&padded[ETH_PAD_SIZE], frame, len);
+
+	for (u16_t split = 0; split < total; split++) {
+		struct pbuf *p = pbuf_alloc(PBUF_RAW, split ? split : total, PBUF_RAM);
+		if (split) {
+			pbuf_cat(p, pbuf_alloc(PBUF_RAW, total - split, PBUF_RAM));
+		}
+		pbuf_take(p, padded, total);
+
+		u32_t value = ethernetif_dispatch_hash(p);
+		pbuf_free(p);
+		if (!split) {
+			first = value;
+		} else if (value != first) {
+			check(false, "hash depends on the pbuf split");
+			break;
+		}
+	}
+
+	return first;
+}
+
+/* Hash of a flow in one direction */
+static u32_t
+flow_hash(const struct flow *flow, u8_t from, const struct shape *shape)
+{
+	u8_t frame[FRAME_MAX];
+
+	return hash(frame, build(frame, flow, from, shape));
+}
+
+static void
+flow_init(struct flow *flow, u32_t n, u8_t protocol)
+{
+	for (u8_t i = 0; i < 2; i++) {
+		u8_t mac[6] = { 0x02, 0x00, 0x00, (u8_t) (n >> 8), (u8_t) n, (u8_t) (i + 1) };
+		u32_t host = n * (i + 1);
+		u8_t ip[4] = { 10, (u8_t) i, (u8_t) (host >> 8), (u8_t) host };
+		memcpy(flow->mac[i], mac, 6);
+		memcpy(flow->ip[i], ip, 4);
+	}
+	flow->protocol = protocol;
+	flow->port[0] = (u16_t) (1024 + n * 7);
+	flow->port[1] = n & 1 ? 80 : 5000;
+}
+
+u32_t
+sys_now(void)
+{
+	return to_ms_since_boot(get_absolute_time());
+}
+
+int
+main(void)
+{
+	static const u8_t protocols[] = { 6, 17, 1 };  /* TCP, UDP, ICMP */
+	static const struct shape plain = { .ethertype = 0x0800 };
+	struct flow flow;
+
+	lwip_init();
+
+	for (size_t i = 0; i < sizeof(protocols) / sizeof(protocols[0]); i++) {
+		u32_t queues[ETHERNETIF_DISPATCH_QUEUES] = { 0 };
+
+		for (u32_t n = 0; n < FLOWS; n++) {
+			sequence = n;
+			flow_init(&flow, n, protocols[i]);
+			u32_t forward = flow_hash(&flow, 0, &plain);
+			queues[forward % ETHERNETIF_DISPATCH_QUEUES]++;
+
+			/* Both directions, tagged or not, with or without options */
+			check(flow_hash(&flow, 1, &plain) == forward, "not symmetric");
+			for (u8_t options = 0; options <= 8; options += 4) {
+				u16_t vlan = (u16_t) (1 + n % 4094);
+				struct shape tagged = { .ethertype = 0x0800, .vlan = vlan, .options = options };
+				struct shape untagged = { .ethertype = 0x0800, .options = options };
+				check(flow_hash(&flow, 0, &tagged) == forward, "802.1Q tag changes the hash");
+				check(flow_hash(&flow, 1, &tagged) == forward, "tagged not symmetric");
+				check(flow_hash(&flow, 1, &untagged) == forward, "IP options change the hash");
+			}
+
+			/* Fragments of a datagram, the first with ports, the others without */
+			struct shape first = { .ethertype = 0x0800, .fragment = 0x2000 };
+			struct shape middle = { .ethertype = 0x0800, .fragment = 0x2000 | 185, .fill = (u8_t) n };
+			struct shape last = { .ethertype = 0x0800, .vlan = 7, .fragment = 370, .fill = (u8_t) (n + 1) };
+			u32_t fragment = flow_hash(&flow, 0, &first);
+			check(flow_hash(&flow, 0, &middle) == fragment, "fragments hashed apart");
+			check(flow_hash(&flow, 1, &last) == fragment, "fragments hashed apart or not symmetric");
+
+			/* Ports are part of the hash of TCP and UDP only */
+			struct flow other = flow;
+			other.port[0] ^= 0x5A5A;
+			if (protocols[i] == 1) {
+				check(flow_hash(&other, 0, &plain) == forward, "ICMP hashed by its first bytes");
+			}
+
+			/* Other EtherTypes: MAC addresses, symmetric */
+			struct shape arp = { .ethertype = 0x0806 };
+			check(flow_hash(&flow, 0, &arp) == flow_hash(&flow, 1, &arp), "ARP not symmetric");
+		}
+
+		/* Flows between the same hosts that only differ in ports spread over the queues */
+		if (protocols[i] != 1) {
+			u32_t port_queues[ETHERNETIF_DISPATCH_QUEUES] = { 0 };
+			flow_init(&flow, 1, protocols[i]);
+			for (u32_t n = 0; n < FLOWS; n++) {
+				sequence = n;
+				flow.port[0] = (u16_t) (49152 + n);
+				port_queues[flow_hash(&flow, 0, &plain) % ETHERNETIF_DISPATCH_QUEUES]++;
+			}
+			for (size_t q = 0; q < ETHERNETIF_DISPATCH_QUEUES; q++) {
+				check(port_queues[q] > FLOWS / ETHERNETIF_DISPATCH_QUEUES / 2, "ports not hashed");
+			}
+		}
+
+		for (size_t q = 0; q < ETHERNETIF_DISPATCH_QUEUES; q++) {
+			check(queues[q] > FLOWS / ETHERNETIF_DISPATCH_QUEUES / 2, "flows not spread over the queues");
+		}
+		printf("protocol %u: %lu/%lu flows per queue\n", protocols[i], (unsigned long) queues[0],
+				(unsigned long) queues[1]);
+	}
+
+	/* Runts have no flow */
+	u8_t runt[13] = { 0 };
+	check(hash(runt, sizeof(runt)) == 0, "runt hashed");
+
+	printf("ETH_PAD_SIZE %d: %s\n", ETH_PAD_SIZE, ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,638 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/stats.h"
+#include "lwip/tcp.h"
+#include "lwip/timeouts.h"
+#include "lwip/udp.h"
+#include "netif/ethernet.h"
+
+#include <hardware/spi.h>
+#include <hardware/timer.h>
+#include <pico/stdlib.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/ethernetif.h>
+#include <pico/enc28j60/gro.h>
+#include <pico/enc28j60/sim.h>
+
+#include "peer.h"
+
+/*
+ * End-to-end benchmark of ethernetif and lwIP against the simulated ENC28J60.
+ * The device under test is the driver with ethernetif, serviced from its INT pin like in the lwip_integration
+ * example. A scripted peer on the other end of a 10 Mbit/s full duplex link runs TCP bulk transfers in both
+ * directions, TCP request/response transactions and a UDP flood. The peer runs its own lwIP instance with fixed
+ * options (see peer.h), so only the device is built with the options of lwipopts.h. All times are virtual, see
+ * pico/enc28j60/sim.h.
+ *
+ * Usage: lwip_bench [-g] [-s spi_hz] [-c cpu_us] [-b bytes] [-n transactions] [-r request] [-u datagrams]
+ *                   [-l length], -g to coalesce received TCP segments (see pico/enc28j60/gro.h)
+ */
+
+/* Configuration */
+#define CS_PIN 10
+#define MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x92 }
+#define PEER_MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x01 }
+#define IP_ADDRESS { 10, 0, 0, 1 }
+#define PEER_IP_ADDRESS { 10, 0, 0, 2 }
+#define NETWORK_MASK IPADDR4_INIT_BYTES(255, 255, 255, 0)
+#define GATEWAY_ADDRESS IPADDR4_INIT_BYTES(0, 0, 0, 0)
+
+#define SINK_PORT 5001  /* Device receives bulk data */
+#define SOURCE_PORT 5002  /* Device sends bulk data */
+#define ECHO_PORT 7
+#define UDP_PORT 5003
+
+#define WIRE_NS_PER_BYTE 800
+#define WIRE_OVERHEAD 24  /* Preamble, CRC and inter packet gap */
+#define WIRE_QUEUE 64  /* Frames of the peer waiting for the wire */
+#define IDLE_STEP_NS 5000  /* Clock advance when nothing is due */
+#define TIMEOUT_US 120000000
+#define MAX_TRANSACTIONS 100000
+
+/* Frame in flight between the peer and the chip */
+struct wire_frame {
+	uint64_t due_ns;  /* Time its last bit arrives */
+	uint16_t len;
+	uint8_t data[1518];
+};
+
+struct wire {
+	struct wire_frame frames[WIRE_QUEUE];
+	size_t head;
+	size_t count;
+	uint64_t free_ns;  /* Time the wire becomes idle */
+	uint32_t dropped;
+};
+
+struct options {
+	bool gro;
+	uint32_t spi_hz;
+	uint32_t cpu_us;
+	uint32_t bulk_bytes;
+	uint32_t transactions;
+	uint32_t request;
+	uint32_t datagrams;
+	uint16_t datagram_len;
+};
+
+static struct enc28j60 enc28j60 = {
+	.spi = spi0,
+	.cs_pin = CS_PIN,
+	.mac_address = MAC_ADDRESS,
+};
+static struct enc28j60_sim chip = {
+	.spi = spi0,
+	.cs_pin = CS_PIN,
+};
+static struct netif netif;
+static struct ethernetif_gro gro;
+static netif_linkoutput_fn driver_output;
+
+static struct wire to_device;  /* Peer transmissions on their way to the chip */
+static struct wire to_peer;  /* Chip transmissions, handed to the peer as they leave the wire */
+static struct bench_workload workload;
+static struct options options;
+static uint8_t pattern[TCP_MSS];
+
+/* Charge the modelled CPU time of a frame handled by the device */
+static void
+cpu_charge(void)
+{
+	if (options.cpu_us) {
+		sleep_us(options.cpu_us);
+	}
+}
+
+static void
+wire_put(struct wire *wire, const uint8_t *data, size_t len, uint64_t due_ns)
+{
+	if (wire->count == WIRE_QUEUE) {
+		wire->dropped++;
+		return;
+	}
+
+	struct wire_frame *frame = &wire->frames[(wire->head + wire->count) % WIRE_QUEUE];
+	frame->due_ns = due_ns;
+	frame->len = len;
+	memcpy(frame->data, data, len);
+	wire->count++;
+}
+
+static struct wire_frame *
+wire_due(struct wire *wire)
+{
+	if (!wire->count || wire->frames[wire->head].due_ns > enc28j60_sim_time_ns()) {
+		return NULL;
+	}
+
+	return &wire->frames[wire->head];
+}
+
+static void
+wire_pop(struct wire *wire)
+{
+	wire->head = (wire->head + 1) % WIRE_QUEUE;
+	wire->count--;
+}
+
+/* The chip finished transmitting a frame, the peer handles it in the main loop */
+static void
+chip_transmit(struct enc28j60_sim *sim, const uint8_t *frame, size_t len, void *context)
+{
+	(void) sim;
+	(void) context;
+
+	wire_put(&to_peer, frame, len, enc28j60_sim_time_ns());
+}
+
+/* The peer sent a frame: it is serialised on the wire after the ones before it */
+static void
+peer_transmit(const uint8_t *data, size_t len)
+{
+	uint64_t now = enc28j60_sim_time_ns();
+	uint64_t start = to_device.free_ns > now ? to_device.free_ns : now;
+
+	to_device.free_ns = start + (uint64_t) ((len < 60 ? 60 : len) + WIRE_OVERHEAD) * WIRE_NS_PER_BYTE;
+	wire_put(&to_device, data, len, to_device.free_ns);
+}
+
+/* linkoutput of the device: the driver plus the modelled CPU time */
+static err_t
+device_output(struct netif *netif, struct pbuf *p)
+{
+	err_t err = driver_output(netif, p);
+	cpu_charge();
+
+	return err;
+}
+
+/* Interrupt service of the device, as eth_irq of the lwip_integration example */
+static void
+device_service(void)
+{
+	enc28j60_isr_begin(&enc28j60);
+	uint8_t flags = enc28j60_interrupt_flags(&enc28j60);
+
+	if (flags & ENC28J60_PKTIF) {
+		uint8_t pending = enc28j60_reg_read(&enc28j60, ENC28J60_REG_EPKTCNT);
+		while (pending--) {
+			struct pbuf *p = low_level_input(&netif);
+			if (p != NULL && options.gro) {
+				ethernetif_gro_input(&gro, &netif, p);
+			} else if (p != NULL && netif.input(p, &netif) != ERR_OK) {
+				pbuf_free(p);
+			}
+			cpu_charge();
+		}
+		if (options.gro) {
+			ethernetif_gro_flush(&gro, &netif);
+		}
+	}
+
+	enc28j60_interrupt_clear(&enc28j60, flags);
+	enc28j60_isr_end(&enc28j60);
+}
+
+/* One step of the simulation: wire deliveries, device, peer and timers */
+static void
+bench_poll(void)
+{
+	bool busy = false;
+	struct wire_frame *frame;
+
+	while ((frame = wire_due(&to_device)) != NULL) {
+		enc28j60_sim_receive(&chip, frame->data, frame->len);
+		wire_pop(&to_device);
+	}
+
+	if (enc28j60_sim_interrupt(&chip)) {
+		device_service();
+		busy = true;
+	}
+
+	while ((frame = wire_due(&to_peer)) != NULL) {
+		bench_peer_input(frame->data, frame->len);
+		wire_pop(&to_peer);
+		busy = true;
+	}
+
+	sys_check_timeouts();
+	bench_peer_poll();
+
+	if (!busy) {
+		uint64_t now = enc28j60_sim_time_ns();
+		uint64_t next = now + IDLE_STEP_NS;
+		if (to_device.count && to_device.frames[to_device.head].due_ns < next) {
+			next = to_device.frames[to_device.head].due_ns;
+		}
+		enc28j60_sim_advance(next > now ? next - now : 1);
+	}
+}
+
+/* Run the simulation until the workload is done or fails */
+static bool
+bench_run(uint64_t timeout_us)
+{
+	uint64_t deadline = time_us_64() + timeout_us;
+
+	while (!workload.done && !workload.failed && time_us_64() < deadline) {
+		bench_poll();
+	}
+
+	return workload.done;
+}
+
+/* Let the simulation run, to finish closing connections and drain the queues */
+static void
+bench_settle(uint64_t us)
+{
+	uint64_t end = time_us_64() + us;
+
+	while (time_us_64() < end) {
+		bench_poll();
+	}
+}
+
+u32_t
+sys_now(void)
+{
+	return to_ms_since_boot(get_absolute_time());
+}
+
+/* --- Device applications --- */
+
+static err_t
+sink_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	if (p == NULL) {
+		tcp_close(pcb);
+		return ERR_OK;
+	}
+
+	workload.received += p->tot_len;
+	workload.end_us = time_us_64();
+	if (workload.received >= workload.size) {
+		workload.done = true;
+	}
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+
+	return ERR_OK;
+}
+
+static err_t
+sink_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	tcp_recv(pcb, sink_recv);
+
+	return ERR_OK;
+}
+
+/* Queue as much of the bulk transfer as the send buffer takes */
+static void
+bulk_send(struct tcp_pcb *pcb)
+{
+	while (workload.sent < workload.size) {
+		u32_t len = workload.size - workload.sent;
+		if (len > sizeof(pattern)) {
+			len = sizeof(pattern);
+		}
+		if (len > tcp_sndbuf(pcb)) {
+			len = tcp_sndbuf(pcb);
+		}
+		if (!len || tcp_write(pcb, pattern, (u16_t) len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+			break;
+		}
+		workload.sent += len;
+	}
+
+	tcp_output(pcb);
+}
+
+static err_t
+bulk_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+	bulk_send(pcb);
+
+	return ERR_OK;
+}
+
+static err_t
+source_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	workload.start_us = time_us_64();
+	tcp_nagle_disable(pcb);
+	tcp_sent(pcb, bulk_sent);
+	bulk_send(pcb);
+
+	return ERR_OK;
+}
+
+static err_t
+echo_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	if (p == NULL) {
+		tcp_close(pcb);
+		return ERR_OK;
+	}
+
+	for (struct pbuf *q = p; q != NULL; q = q->next) {
+		tcp_write(pcb, q->payload, q->len, TCP_WRITE_FLAG_COPY);
+	}
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+	tcp_output(pcb);
+
+	return ERR_OK;
+}
+
+static err_t
+echo_accept(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	tcp_nagle_disable(pcb);
+	tcp_recv(pcb, echo_recv);
+
+	return ERR_OK;
+}
+
+static void
+udp_sink(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+	workload.received++;
+	workload.end_us = time_us_64();
+	pbuf_free(p);
+}
+
+static void
+device_listen(u16_t port, tcp_accept_fn accept)
+{
+	struct tcp_pcb *pcb = tcp_new();
+
+	tcp_bind_netif(pcb, &netif);
+	tcp_bind(pcb, netif_ip_addr4(&netif), port);
+	pcb = tcp_listen(pcb);
+	tcp_accept(pcb, accept);
+}
+
+/* Close the connection of the peer and let the simulation finish closing it and drain the queues */
+static void
+peer_close(void)
+{
+	bench_peer_close();
+	bench_settle(500000);
+}
+
+/* --- Reports --- */
+
+static void
+workload_reset(uint32_t size)
+{
+	memset(&workload, 0, sizeof(workload));
+	workload.size = size;
+}
+
+/* Drop counters, sampled before and after a workload */
+struct drops {
+	uint32_t chip;  /* Receive buffer full or EPKTCNT saturated */
+	uint32_t pool;  /* No pbuf for a received frame */
+	uint32_t wire;  /* Peer transmit queue full */
+	uint32_t tcp;
+	uint32_t udp;
+};
+
+static void
+drops_sample(struct drops *drops)
+{
+	drops->chip = chip.rx_overflows + chip.rx_saturated;
+	drops->pool = lwip_stats.link.memerr;
+	drops->wire = to_device.dropped + to_peer.dropped;
+	drops->tcp = lwip_stats.tcp.drop;
+	drops->udp = lwip_stats.udp.drop;
+}
+
+static void
+drops_print(const struct drops *before)
+{
+	struct drops after;
+
+	drops_sample(&after);
+	printf("  drops: chip %lu, pool %lu, wire %lu, tcp %lu, udp %lu\n", (unsigned long) (after.chip - before->chip),
+			(unsigned long) (after.pool - before->pool), (unsigned long) (after.wire - before->wire),
+			(unsigned long) (after.tcp - before->tcp), (unsigned long) (after.udp - before->udp));
+}
+
+static uint32_t
+goodput_kbps(uint32_t bytes, uint64_t start_us, uint64_t end_us)
+{
+	return bytes && end_us > start_us ? (uint32_t) (bytes * 8000ull / (end_us - start_us)) : 0;
+}
+
+static int
+compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *) a;
+	uint32_t y = *(const uint32_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+static uint32_t
+percentile(const uint32_t *sorted, uint32_t count, uint32_t percent)
+{
+	return count ? sorted[(count - 1) * percent / 100] : 0;
+}
+
+/* --- Workloads --- */
+
+static uint32_t
+bench_bulk_rx(void)
+{
+	struct drops drops;
+	uint32_t received = gro.received;
+	uint32_t delivered = gro.delivered;
+	uint32_t acks = chip.tx_frames;
+
+	drops_sample(&drops);
+	workload_reset(options.bulk_bytes);
+	bench_peer_bulk_send(SINK_PORT);
+	bool done = bench_run(TIMEOUT_US);
+	uint32_t kbps = goodput_kbps(workload.received, workload.start_us, workload.end_us);
+
+	printf("bulk-rx  %lu bytes, goodput %lu kbit/s%s, %lu frames sent\n", (unsigned long) workload.received,
+			(unsigned long) kbps, done ? "" : " (incomplete)", (unsigned long) (chip.tx_frames - acks));
+	if (options.gro) {
+		received = gro.received - received;
+		delivered = gro.delivered - delivered;
+		printf("  coalescing: %lu frames into %lu packets, ratio %lu.%02lu\n", (unsigned long) received,
+				(unsigned long) delivered, (unsigned long) (delivered ? received / delivered : 0),
+				(unsigned long) (delivered ? received * 100ull / delivered % 100 : 0));
+	}
+	peer_close();
+	drops_print(&drops);
+
+	return done ? kbps : 0;
+}
+
+static uint32_t
+bench_bulk_tx(void)
+{
+	struct drops drops;
+
+	drops_sample(&drops);
+	workload_reset(options.bulk_bytes);
+	bench_peer_bulk_receive(SOURCE_PORT);
+	bool done = bench_run(TIMEOUT_US);
+	uint32_t kbps = goodput_kbps(workload.received, workload.start_us, workload.end_us);
+
+	printf("bulk-tx  %lu bytes, goodput %lu kbit/s%s\n", (unsigned long) workload.received, (unsigned long) kbps,
+			done ? "" : " (incomplete)");
+	peer_close();
+	drops_print(&drops);
+
+	return done ? kbps : 0;
+}
+
+static uint32_t
+bench_rr(void)
+{
+	struct drops drops;
+	static uint32_t rtt_us[MAX_TRANSACTIONS];
+
+	drops_sample(&drops);
+	workload_reset(options.request);
+	workload.transactions = options.transactions;
+	workload.rtt_us = rtt_us;
+	bench_peer_rr(ECHO_PORT);
+	bench_run(TIMEOUT_US);
+
+	uint32_t count = workload.sent;
+	qsort(rtt_us, count, sizeof(rtt_us[0]), compare_u32);
+	printf("rr       %lu x %lu bytes, rtt p50 %lu us, p90 %lu us, p99 %lu us, max %lu us\n", (unsigned long) count,
+			(unsigned long) workload.size, (unsigned long) percentile(rtt_us, count, 50),
+			(unsigned long) percentile(rtt_us, count, 90), (unsigned long) percentile(rtt_us, count, 99),
+			(unsigned long) percentile(rtt_us, count, 100));
+	peer_close();
+	drops_print(&drops);
+
+	return percentile(rtt_us, count, 99);
+}
+
+/* Datagrams at line rate: the peer keeps two frames queued for the wire */
+static uint32_t
+bench_udp(void)
+{
+	struct drops drops;
+	struct udp_pcb *sink = udp_new();
+	uint32_t sent = 0;
+
+	udp_bind_netif(sink, &netif);
+	udp_bind(sink, netif_ip_addr4(&netif), UDP_PORT);
+	udp_recv(sink, udp_sink, NULL);
+
+	drops_sample(&drops);
+	workload_reset(options.datagram_len);
+	workload.start_us = time_us_64();
+	while (sent < options.datagrams) {
+		if (to_device.count < 2) {
+			bench_peer_udp_send(UDP_PORT, options.datagram_len, (uint8_t) sent);
+			sent++;
+		}
+		bench_poll();
+	}
+	bench_settle(100000);
+
+	uint32_t kbps = goodput_kbps(workload.received * options.datagram_len, workload.start_us, workload.end_us);
+	uint32_t loss = sent ? (sent - workload.received) * 10000ull / sent : 0;
+	printf("udp      %lu x %u bytes, received %lu, goodput %lu kbit/s, loss %lu.%02lu%%\n", (unsigned long) sent,
+			options.datagram_len, (unsigned long) workload.received, (unsigned long) kbps,
+			(unsigned long) (loss / 100), (unsigned long) (loss % 100));
+	drops_print(&drops);
+
+	udp_remove(sink);
+
+	return loss;
+}
+
+int
+main(int argc, char **argv)
+{
+	const uint8_t ip_address[] = IP_ADDRESS;
+	const uint8_t peer_ip_address[] = PEER_IP_ADDRESS;
+	const uint8_t peer_mac_address[] = PEER_MAC_ADDRESS;
+	const struct ip4_addr netmask = NETWORK_MASK;
+	const struct ip4_addr gw = GATEWAY_ADDRESS;
+	int option;
+
+	options = (struct options) {
+		.spi_hz = 16000000,
+		.bulk_bytes = 1000000,
+		.transactions = 1000,
+		.request = 64,
+		.datagrams = 2000,
+		.datagram_len = 1472,
+	};
+	while ((option = getopt(argc, argv, "gs:c:b:n:r:u:l:")) != -1) {
+		uint32_t value = optarg != NULL ? strtoul(optarg, NULL, 0) : 0;
+		switch (option) {
+		case 'g': options.gro = true; break;
+		case 's': options.spi_hz = value; break;
+		case 'c': options.cpu_us = value; break;
+		case 'b': options.bulk_bytes = value; break;
+		case 'n': options.transactions = value > MAX_TRANSACTIONS ? MAX_TRANSACTIONS : value; break;
+		case 'r': options.request = value < 1 ? 1 : value > TCP_MSS ? TCP_MSS : value; break;
+		case 'u': options.datagrams = value; break;
+		case 'l': options.datagram_len = value < 1 ? 1 : value > 1472 ? 1472 : value; break;
+		default:
+			fprintf(stderr, "usage: %s [-g] [-s spi_hz] [-c cpu_us] [-b bytes] [-n transactions] [-r request] "
+					"[-u datagrams] [-l length]\n", argv[0]);
+			return 2;
+		}
+	}
+	for (size_t i = 0; i < sizeof(pattern); i++) {
+		pattern[i] = (uint8_t) i;
+	}
+
+	spi_init(spi0, options.spi_hz);
+	gpio_init(CS_PIN);
+	gpio_set_dir(CS_PIN, GPIO_OUT);
+	gpio_put(CS_PIN, 1);
+	chip.on_transmit = chip_transmit;
+	enc28j60_sim_attach(&chip);
+
+	struct ip4_addr ipaddr;
+	IP4_ADDR(&ipaddr, ip_address[0], ip_address[1], ip_address[2], ip_address[3]);
+	lwip_init();
+	netif_add(&netif, &ipaddr, &netmask, &gw, &enc28j60, ethernetif_init, netif_input);
+	driver_output = netif.linkoutput;
+	netif.linkoutput = device_output;
+	netif_set_up(&netif);
+	netif_set_link_up(&netif);
+	bench_peer_init(&workload, peer_mac_address, peer_ip_address, ip_address, peer_transmit);
+	enc28j60_interrupts(&enc28j60, ENC28J60_PKTIE | ENC28J60_TXERIE | ENC28J60_RXERIE);
+
+	device_listen(SINK_PORT, sink_accept);
+	device_listen(SOURCE_PORT, source_accept);
+	device_listen(ECHO_PORT, echo_accept);
+
+	printf("TCP_WND %u, TCP_SND_BUF %u, PBUF_POOL_SIZE %u, SPI %lu Hz, CPU %lu us per frame\n", TCP_WND, TCP_SND_BUF,
+			PBUF_POOL_SIZE, (unsigned long) options.spi_hz, (unsigned long) options.cpu_us);
+
+	uint32_t bulk_rx = bench_bulk_rx();
+	uint32_t bulk_tx = bench_bulk_tx();
+	uint32_t rtt_p99 = bench_rr();
+	uint32_t udp_loss = bench_udp();
+
+	/* One line per configuration, collected by the sweep */
+	printf("summary wnd=%u snd_buf=%u pool=%u bulk_rx=%lu bulk_tx=%lu rtt_p99=%lu udp_loss=%lu\n", BENCH_TCP_WND,
+			BENCH_TCP_SND_BUF, BENCH_PBUF_POOL_SIZE, (unsigned long) bulk_rx, (unsigned long) bulk_tx,
+			(unsigned long) rtt_p99, (unsigned long) udp_loss);
+
+	return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+/*
+ * lwIP options of the host benchmark (lwip_bench).
+ * The swept options are given in segments or frames by BENCH_* definitions, set by CMake for every configuration
+ * of the sweep. They apply to the device only, the peer has its own lwIP instance with the options of
+ * peer/lwipopts.h.
+ */
+
+#ifndef BENCH_TCP_WND
+#define BENCH_TCP_WND 4  /* Receive window, in segments */
+#endif
+#ifndef BENCH_TCP_SND_BUF
+#define BENCH_TCP_SND_BUF 4  /* Send buffer, in segments */
+#endif
+#ifndef BENCH_PBUF_POOL_SIZE
+#define BENCH_PBUF_POOL_SIZE 16  /* Receive pbufs of the driver */
+#endif
+
+#define NO_SYS 1
+#define SYS_LIGHTWEIGHT_PROT 0
+#define LWIP_NETCONN 0
+#define LWIP_SOCKET 0
+#define MEM_ALIGNMENT 4
+#define MEM_SIZE (64 * 1024)
+#define LWIP_RAW 0
+#define LWIP_DHCP 0
+#define LWIP_ICMP 1
+#define LWIP_UDP 1
+#define LWIP_TCP 1
+#define LWIP_IPV6 0
+#define LWIP_SINGLE_NETIF 0
+#ifndef ETH_PAD_SIZE
+#define ETH_PAD_SIZE 0  /* Set by CMake to build the padded paths too */
+#endif
+
+#define TCP_MSS (1500 /*mtu*/ - 20 /*iphdr*/ - 20 /*tcphhr*/)
+#define TCP_WND (BENCH_TCP_WND * TCP_MSS)
+#define TCP_SND_BUF (BENCH_TCP_SND_BUF * TCP_MSS)
+#define TCP_SND_QUEUELEN ((4 * TCP_SND_BUF + TCP_MSS - 1) / TCP_MSS)
+#define TCP_QUEUE_OOSEQ 1
+#define MEMP_NUM_TCP_SEG (2 * TCP_SND_QUEUELEN + 2 * BENCH_TCP_WND)
+#define MEMP_NUM_TCP_PCB 8
+#define MEMP_NUM_PBUF 64
+#define PBUF_POOL_SIZE BENCH_PBUF_POOL_SIZE
+
+/* The sweep deliberately includes windows larger than the pool */
+#define LWIP_DISABLE_TCP_SANITY_CHECKS 1
+
+#define LWIP_STATS 1
+#define LINK_STATS 1
+#define TCP_STATS 1
+#define UDP_STATS 1
+#define LWIP_STATS_DISPLAY 0
+
+#endif /* __LWIPOPTS_H__ */
@@ -0,0 +1,276 @@
+#include <string.h>
+
+#include "lwip/etharp.h"
+#include "lwip/init.h"
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/timeouts.h"
+#include "lwip/udp.h"
+#include "netif/ethernet.h"
+
+#include <hardware/timer.h>
+#include <pico/stdlib.h>
+
+#include "peer.h"
+
+/*
+ * Scripted peer of the host benchmark, on its own lwIP instance (see peer.h).
+ * Every function and variable here, lwIP included, is private to the peer object except bench_peer_*.
+ */
+
+static struct netif peer;
+static uint8_t peer_mac_address[ETHARP_HWADDR_LEN];
+static ip4_addr_t device_ip;
+static struct bench_workload *workload;
+static bench_peer_transmit_fn transmit;
+static struct tcp_pcb *connection;
+static struct udp_pcb *flood;
+static uint8_t pattern[TCP_MSS];
+
+u32_t
+sys_now(void)
+{
+	return to_ms_since_boot(get_absolute_time());
+}
+
+/* linkoutput of the peer: the frame goes to the wire model of the benchmark */
+static err_t
+peer_output(struct netif *netif, struct pbuf *p)
+{
+	uint8_t data[1518];
+	uint16_t len = pbuf_copy_partial(p, data, sizeof(data), 0);
+
+	transmit(data, len);
+
+	return ERR_OK;
+}
+
+static err_t
+peer_init(struct netif *netif)
+{
+	netif->name[0] = 'p';
+	netif->name[1] = 'r';
+	netif->hwaddr_len = ETHARP_HWADDR_LEN;
+	memcpy(netif->hwaddr, peer_mac_address, ETHARP_HWADDR_LEN);
+	netif->mtu = 1500;
+	netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+	netif->output = etharp_output;
+	netif->linkoutput = peer_output;
+
+	return ERR_OK;
+}
+
+static void
+peer_error(void *arg, err_t err)
+{
+	connection = NULL;
+	workload->failed = true;
+}
+
+/* Queue as much of the bulk transfer as the send buffer takes */
+static void
+bulk_send(struct tcp_pcb *pcb)
+{
+	while (workload->sent < workload->size) {
+		u32_t len = workload->size - workload->sent;
+		if (len > sizeof(pattern)) {
+			len = sizeof(pattern);
+		}
+		if (len > tcp_sndbuf(pcb)) {
+			len = tcp_sndbuf(pcb);
+		}
+		if (!len || tcp_write(pcb, pattern, (u16_t) len, TCP_WRITE_FLAG_COPY) != ERR_OK) {
+			break;
+		}
+		workload->sent += len;
+	}
+
+	tcp_output(pcb);
+}
+
+static err_t
+bulk_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+	bulk_send(pcb);
+
+	return ERR_OK;
+}
+
+static err_t
+bulk_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	workload->start_us = time_us_64();
+	tcp_nagle_disable(pcb);
+	tcp_sent(pcb, bulk_sent);
+	bulk_send(pcb);
+
+	return ERR_OK;
+}
+
+static err_t
+sink_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	if (p == NULL) {
+		return ERR_OK;
+	}
+
+	workload->received += p->tot_len;
+	workload->end_us = time_us_64();
+	if (workload->received >= workload->size) {
+		workload->done = true;
+	}
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+
+	return ERR_OK;
+}
+
+static void
+request_send(struct tcp_pcb *pcb)
+{
+	workload->request_us = time_us_64();
+	workload->received = 0;
+	tcp_write(pcb, pattern, (u16_t) workload->size, TCP_WRITE_FLAG_COPY);
+	tcp_output(pcb);
+}
+
+static err_t
+rr_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+	if (p == NULL) {
+		workload->failed = true;
+		return ERR_OK;
+	}
+
+	workload->received += p->tot_len;
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+
+	if (workload->received >= workload->size) {
+		workload->rtt_us[workload->sent++] = (uint32_t) (time_us_64() - workload->request_us);
+		if (workload->sent == workload->transactions) {
+			workload->done = true;
+		} else {
+			request_send(pcb);
+		}
+	}
+
+	return ERR_OK;
+}
+
+static err_t
+rr_connected(void *arg, struct tcp_pcb *pcb, err_t err)
+{
+	tcp_nagle_disable(pcb);
+	request_send(pcb);
+
+	return ERR_OK;
+}
+
+static void
+peer_connect(u16_t port, tcp_connected_fn connected, tcp_recv_fn recv)
+{
+	struct tcp_pcb *pcb = tcp_new();
+
+	tcp_bind_netif(pcb, &peer);
+	tcp_bind(pcb, netif_ip_addr4(&peer), 0);
+	tcp_err(pcb, peer_error);
+	if (recv != NULL) {
+		tcp_recv(pcb, recv);
+	}
+	tcp_connect(pcb, &device_ip, port, connected);
+	connection = pcb;
+}
+
+void
+bench_peer_init(struct bench_workload *bench_workload, const uint8_t *mac_address, const uint8_t *ip_address,
+		const uint8_t *device_ip_address, bench_peer_transmit_fn bench_transmit)
+{
+	ip4_addr_t ipaddr, netmask, gw;
+
+	workload = bench_workload;
+	transmit = bench_transmit;
+	memcpy(peer_mac_address, mac_address, ETHARP_HWADDR_LEN);
+	for (size_t i = 0; i < sizeof(pattern); i++) {
+		pattern[i] = (uint8_t) i;
+	}
+
+	IP4_ADDR(&ipaddr, ip_address[0], ip_address[1], ip_address[2], ip_address[3]);
+	IP4_ADDR(&device_ip, device_ip_address[0], device_ip_address[1], device_ip_address[2], device_ip_address[3]);
+	IP4_ADDR(&netmask, 255, 255, 255, 0);
+	ip4_addr_set_zero(&gw);
+
+	lwip_init();
+	netif_add(&peer, &ipaddr, &netmask, &gw, NULL, peer_init, netif_input);
+	netif_set_up(&peer);
+	netif_set_link_up(&peer);
+
+	flood = udp_new();
+	udp_bind_netif(flood, &peer);
+	udp_bind(flood, netif_ip_addr4(&peer), 0);
+}
+
+void
+bench_peer_input(const uint8_t *frame, size_t len)
+{
+	struct pbuf *p = pbuf_alloc(PBUF_RAW, (u16_t) len, PBUF_RAM);
+
+	if (p != NULL) {
+		pbuf_take(p, frame, (u16_t) len);
+		if (peer.input(p, &peer) != ERR_OK) {
+			pbuf_free(p);
+		}
+	}
+}
+
+void
+bench_peer_poll(void)
+{
+	sys_check_timeouts();
+}
+
+void
+bench_peer_bulk_send(uint16_t port)
+{
+	peer_connect(port, bulk_connected, NULL);
+}
+
+void
+bench_peer_bulk_receive(uint16_t port)
+{
+	peer_connect(port, NULL, sink_recv);
+}
+
+void
+bench_peer_rr(uint16_t port)
+{
+	peer_connect(port, rr_connected, rr_recv);
+}
+
+void
+bench_peer_close(void)
+{
+	if (connection != NULL) {
+		tcp_err(connection, NULL);
+		if (tcp_close(connection) != ERR_OK) {
+			tcp_abort(connection);
+		}
+		connection = NULL;
+	}
+}
+
+bool
+bench_peer_udp_send(uint16_t port, uint16_t len, uint8_t fill)
+{
+	struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+
+	if (p == NULL) {
+		return false;
+	}
+	memset(p->payload, fill, len);
+	udp_sendto(flood, p, &device_ip, port);
+	pbuf_free(p);
+
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef ENC28J60_SIM_LWIP_PEER_H
+#define ENC28J60_SIM_LWIP_PEER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Scripted peer of the host benchmark (lwip_bench).
+ * The peer runs its own lwIP instance, built from peer.c with the fixed options of peer/lwipopts.h and linked into
+ * every benchmark with only the bench_peer_* functions global (see CMakeLists.txt). So the swept options of the
+ * device never change the peer, and this interface uses no lwIP types.
+ */
+
+/* State of the workload being run, shared by the device applications and the peer scripts */
+struct bench_workload {
+	bool done;
+	bool failed;
+	uint32_t size;  /* Bytes to transfer, or bytes per request */
+	uint32_t sent;
+	uint32_t received;
+	uint64_t start_us;
+	uint64_t end_us;
+	uint64_t request_us;
+	uint32_t transactions;
+	uint32_t *rtt_us;
+};
+
+/* Frame sent by the peer, to be serialised on the wire */
+typedef void (*bench_peer_transmit_fn)(const uint8_t *frame, size_t len);
+
+/*
+ * Bring up the peer interface.
+ * \param addresses in network byte order
+ */
+void bench_peer_init(struct bench_workload *workload, const uint8_t *mac_address, const uint8_t *ip_address,
+		const uint8_t *device_ip_address, bench_peer_transmit_fn transmit);
+
+/* A frame arrived from the wire. */
+void bench_peer_input(const uint8_t *frame, size_t len);
+
+/* Run the timers of the peer. */
+void bench_peer_poll(void);
+
+/* Connect to the device and send size bytes of the workload (bulk transfer to the device). */
+void bench_peer_bulk_send(uint16_t port);
+
+/* Connect to the device and count what it sends until size bytes are received (bulk transfer from the device). */
+void bench_peer_bulk_receive(uint16_t port);
+
+/* Connect to the device and run request/response transactions, recording the round trips in rtt_us. */
+void bench_peer_rr(uint16_t port);
+
+/* Close the connection of the workload. */
+void bench_peer_close(void);
+
+/*
+ * Send a datagram of len bytes filled with fill to the device.
+ * \return false if it could not be allocated
+ */
+bool bench_peer_udp_send(uint16_t port, uint16_t len, uint8_t fill);
+
+#endif
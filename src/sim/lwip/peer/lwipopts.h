@@ -0,0 +1,37 @@
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+/*
+ * lwIP options of the scripted peer of the host benchmark (see ../peer.h).
+ * Fixed for every configuration of the sweep and sized so the peer never limits the device: a window and send
+ * buffer of 16 segments and room for them in memory. Received frames are copied into PBUF_RAM, not the pool.
+ */
+
+#define NO_SYS 1
+#define SYS_LIGHTWEIGHT_PROT 0
+#define LWIP_NETCONN 0
+#define LWIP_SOCKET 0
+#define MEM_ALIGNMENT 4
+#define MEM_SIZE (128 * 1024)
+#define LWIP_RAW 0
+#define LWIP_DHCP 0
+#define LWIP_ICMP 1
+#define LWIP_UDP 1
+#define LWIP_TCP 1
+#define LWIP_IPV6 0
+#define LWIP_SINGLE_NETIF 0
+#define ETH_PAD_SIZE 0
+
+#define TCP_MSS (1500 /*mtu*/ - 20 /*iphdr*/ - 20 /*tcphhr*/)
+#define TCP_WND (16 * TCP_MSS)
+#define TCP_SND_BUF (16 * TCP_MSS)
+#define TCP_SND_QUEUELEN ((4 * TCP_SND_BUF + TCP_MSS - 1) / TCP_MSS)
+#define TCP_QUEUE_OOSEQ 1
+#define MEMP_NUM_TCP_SEG (2 * TCP_SND_QUEUELEN + 32)
+#define MEMP_NUM_TCP_PCB 8
+#define MEMP_NUM_PBUF 64
+#define PBUF_POOL_SIZE 4
+
+#define LWIP_STATS 0
+
+#endif /* __LWIPOPTS_H__ */
@@ -0,0 +1,41 @@
+# Run every configuration of the lwip_bench sweep and report the best one.
+# Invoked by the lwip_sweep target with BENCHES set to the executables separated by |, and BENCH_ARGS to their
+# options. Configurations are ranked by the sum of both bulk goodputs, the lowest request/response p99 is reported
+# separately.
+
+string(REPLACE "|" ";" benches "${BENCHES}")
+separate_arguments(args UNIX_COMMAND "${BENCH_ARGS}")
+
+set(best_goodput -1)
+set(best_rtt -1)
+foreach (bench ${benches})
+    execute_process(COMMAND ${bench} ${args} OUTPUT_VARIABLE output RESULT_VARIABLE result)
+    string(REGEX MATCH "summary [^\n]*" summary "${output}")
+    if (NOT result EQUAL 0 OR NOT summary)
+        message("${bench}: failed")
+        continue()
+    endif ()
+
+    string(REGEX REPLACE "^summary " "" summary "${summary}")
+    message("${summary}")
+
+    string(REGEX MATCH "bulk_rx=([0-9]+)" match "${summary}")
+    set(bulk_rx ${CMAKE_MATCH_1})
+    string(REGEX MATCH "bulk_tx=([0-9]+)" match "${summary}")
+    set(bulk_tx ${CMAKE_MATCH_1})
+    string(REGEX MATCH "rtt_p99=([0-9]+)" match "${summary}")
+    set(rtt ${CMAKE_MATCH_1})
+
+    math(EXPR goodput "${bulk_rx} + ${bulk_tx}")
+    if (goodput GREATER best_goodput)
+        set(best_goodput ${goodput})
+        set(best_goodput_summary "${summary}")
+    endif ()
+    if (best_rtt LESS 0 OR rtt LESS best_rtt)
+        set(best_rtt ${rtt})
+        set(best_rtt_summary "${summary}")
+    endif ()
+endforeach ()
+
+message("best goodput: ${best_goodput_summary}")
+message("best latency: ${best_rtt_summary}")
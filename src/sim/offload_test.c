@@ -0,0 +1,321 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/offload.h>
+#include <pico/enc28j60/sim.h>
+
+/*
+ * Test of the ARP and ICMP echo responder on a simulated ENC28J60.
+ * ARP requests and echo requests of every length class, with IP options and with request checksums around the carry
+ * of the incremental update, are answered. The replies are checked field by field: swapped addresses, valid IPv4
+ * header checksum, valid ICMP checksum after the incremental update (RFC 1624) and the echo payload copied through
+ * the receive buffer, which wraps around. Requests that must not be answered (foreign
+ * address, fragment, multicast, disabled responder, held transmit buffer) have to be delivered unchanged.
+ * Exits with status 1 on the first mismatch.
+ */
+
+/* Configuration */
+#define SPI_HZ 20000000
+#define ECHOES 600
+
+static const uint8_t peer_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+static const uint8_t peer_ip[4] = { 192, 168, 1, 10 };
+static const uint8_t local_ip[4] = { 192, 168, 1, 200 };
+static const uint8_t second_ip[4] = { 10, 0, 0, 1 };
+static const uint8_t foreign_ip[4] = { 192, 168, 1, 201 };
+
+static struct enc28j60_sim chip = { .spi = spi0, .cs_pin = 10 };
+
+static struct enc28j60 eth = {
+	.spi = spi0,
+	.cs_pin = 10,
+	.mac_address = { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x0A },
+};
+
+static struct enc28j60_offload offload = {
+	.ip_addresses = { { 192, 168, 1, 200 }, { 10, 0, 0, 1 } },
+	.ip_address_count = 2,
+	.arp = true,
+	.icmp = true,
+};
+
+static uint8_t frame[1514];
+static uint8_t sent[1518];
+static size_t sent_len;
+static uint32_t sent_count;
+static uint32_t sequence;
+static bool ok = true;
+
+static void
+transmitted(struct enc28j60_sim *sim, const uint8_t *data, size_t len, void *context)
+{
+	(void) sim;
+	(void) context;
+
+	memcpy(sent, data, len < sizeof(sent) ? len : sizeof(sent));
+	sent_len = len;
+	sent_count++;
+}
+
+static void
+check(bool condition, const char *what)
+{
+	if (!condition) {
+		fprintf(stderr, "frame %lu: %s\n", (unsigned long) sequence, what);
+		ok = false;
+	}
+}
+
+/* One's complement sum of 16-bit big endian words, folded */
+static uint16_t
+checksum(const uint8_t *data, size_t len)
+{
+	uint32_t sum = 0;
+
+	for (size_t i = 0; i + 1 < len; i += 2) {
+		sum += data[i] << 8 | data[i + 1];
+	}
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return sum;
+}
+
+static void
+put16(uint8_t *data, uint16_t value)
+{
+	data[0] = value >> 8;
+	data[1] = value & 0xFF;
+}
+
+/* Build an ARP request for an address */
+static uint16_t
+arp_request(const uint8_t *target)
+{
+	memset(frame, 0, 60);
+	memset(frame, 0xFF, 6);
+	memcpy(&frame[6], peer_mac, 6);
+	put16(&frame[12], 0x0806);
+	put16(&frame[14], 1);  /* Ethernet */
+	put16(&frame[16], 0x0800);
+	frame[18] = 6;
+	frame[19] = 4;
+	put16(&frame[20], 1);  /* Request */
+	memcpy(&frame[22], peer_mac, 6);
+	memcpy(&frame[28], peer_ip, 4);
+	memcpy(&frame[38], target, 4);
+
+	return 60;
+}
+
+/*
+ * Build an ICMP echo request.
+ * \param options IP option bytes, a multiple of 4
+ * \param payload echo data bytes after the identifier and sequence number
+ */
+static uint16_t
+echo_request(const uint8_t *destination_mac, const uint8_t *destination, uint8_t options, uint16_t payload,
+		uint16_t identifier, uint16_t number)
+{
+	uint16_t ip_len = 20 + options;
+	uint16_t icmp = 14 + ip_len;
+	uint16_t len = icmp + 8 + payload;
+
+	memcpy(frame, destination_mac, 6);
+	memcpy(&frame[6], peer_mac, 6);
+	put16(&frame[12], 0x0800);
+
+	uint8_t *ip = &frame[14];
+	memset(ip, 0, ip_len);
+	ip[0] = 0x40 | ip_len / 4;
+	put16(&ip[2], ip_len + 8 + payload);
+	put16(&ip[4], (uint16_t) sequence);
+	ip[8] = 64;
+	ip[9] = 1;  /* ICMP */
+	memcpy(&ip[12], peer_ip, 4);
+	memcpy(&ip[16], destination, 4);
+	for (uint8_t i = 0; i < options; i++) {
+		ip[20 + i] = 1;  /* No operation */
+	}
+	put16(&ip[10], ~checksum(ip, ip_len));
+
+	frame[icmp] = 8;
+	frame[icmp + 1] = 0;
+	put16(&frame[icmp + 2], 0);
+	put16(&frame[icmp + 4], identifier);
+	put16(&frame[icmp + 6], number);
+	for (uint16_t i = 0; i < payload; i++) {
+		frame[icmp + 8 + i] = (uint8_t) (sequence * 31 + i);
+	}
+	put16(&frame[icmp + 2], ~checksum(&frame[icmp], 8 + payload));
+
+	/* Pad as the sender would */
+	if (len < 60) {
+		memset(&frame[len], 0, 60 - len);
+		len = 60;
+	}
+	return len;
+}
+
+/*
+ * A frame arrives and goes through the responder.
+ * \return true if it was answered, else it is checked to be delivered unchanged and acknowledged
+ */
+static bool
+offload_frame(uint16_t len)
+{
+	uint32_t sent_count_before = sent_count;
+	uint8_t received[sizeof(frame)];
+
+	sequence++;
+	check(enc28j60_sim_receive(&chip, frame, len), "not accepted by the chip");
+	uint16_t local_len = enc28j60_offload_input(&offload, &eth);
+
+	if (local_len) {
+		check(local_len == len, "delivered with another length");
+		check(sent_count == sent_count_before, "delivered and answered");
+		if (local_len == len) {
+			enc28j60_receive_read(&eth, received, len);
+			check(!memcmp(received, frame, len), "delivered frame differs");
+		}
+		enc28j60_receive_ack(&eth);
+	} else {
+		check(sent_count == sent_count_before + 1, "neither delivered nor answered");
+	}
+
+	check(!enc28j60_sim_packets(&chip), "frame left pending");
+	return !local_len;
+}
+
+/* Check the reply to the ARP request in frame */
+static void
+check_arp_reply(const uint8_t *target)
+{
+	check(sent_len == 60, "ARP reply length");
+	check(!memcmp(sent, peer_mac, 6) && !memcmp(&sent[6], eth.mac_address, 6), "ARP reply MAC addresses");
+	check(!memcmp(&sent[12], &frame[12], 8), "ARP reply types");
+	check(sent[20] == 0 && sent[21] == 2, "ARP reply operation");
+	check(!memcmp(&sent[22], eth.mac_address, 6) && !memcmp(&sent[28], target, 4), "ARP reply sender");
+	check(!memcmp(&sent[32], peer_mac, 6) && !memcmp(&sent[38], peer_ip, 4), "ARP reply target");
+}
+
+/* Check the reply to the echo request in frame */
+static void
+check_echo_reply(uint16_t len)
+{
+	uint16_t icmp = 14 + (frame[14] & 0x0F) * 4;
+	uint16_t icmp_len = (frame[16] << 8 | frame[17]) - (icmp - 14);
+
+	check(sent_len == len, "echo reply length");
+	check(!memcmp(sent, peer_mac, 6) && !memcmp(&sent[6], eth.mac_address, 6), "echo reply MAC addresses");
+
+	const uint8_t *ip = &sent[14];
+	check(!memcmp(&ip[12], &frame[30], 4) && !memcmp(&ip[16], peer_ip, 4), "echo reply IP addresses");
+	check(!memcmp(ip, &frame[14], 12) && !memcmp(&ip[20], &frame[34], icmp - 34), "echo reply IP header");
+	check(checksum(ip, icmp - 14) == 0xFFFF, "echo reply IP header checksum");
+
+	check(sent[icmp] == 0 && sent[icmp + 1] == frame[icmp + 1], "echo reply type and code");
+	check(checksum(&sent[icmp], icmp_len) == 0xFFFF, "echo reply ICMP checksum");
+	check(!memcmp(&sent[icmp + 4], &frame[icmp + 4], len - icmp - 4), "echo reply payload");
+}
+
+int
+main(void)
+{
+	static const uint16_t payloads[] = { 0, 1, 17, 18, 19, 56, 100, 511, 1000, 1471, 1472 };
+
+	spi_init(spi0, SPI_HZ);
+	chip.on_transmit = transmitted;
+	enc28j60_sim_attach(&chip);
+	gpio_init(eth.cs_pin);
+	gpio_set_dir(eth.cs_pin, GPIO_OUT);
+	gpio_put(eth.cs_pin, 1);
+	enc28j60_init(&eth);
+
+	/* ARP requests for both local addresses are answered, for a foreign address delivered */
+	check(offload_frame(arp_request(local_ip)), "ARP request not answered");
+	check_arp_reply(local_ip);
+	check(offload_frame(arp_request(second_ip)), "ARP request for the second address not answered");
+	check_arp_reply(second_ip);
+	check(!offload_frame(arp_request(foreign_ip)), "ARP request for a foreign address answered");
+
+	/*
+	 * Echo requests: every length class, with and without options, the identifier and sequence number sweep the
+	 * request checksum
+	 */
+	for (uint32_t n = 0; n < ECHOES; n++) {
+		uint8_t options = n % 4 == 3 ? 4 : 0;
+		uint16_t payload = payloads[n % (sizeof(payloads) / sizeof(payloads[0]))];
+		if (payload > 1472 - options) {
+			payload = 1472 - options;
+		}
+		uint16_t len = echo_request(eth.mac_address, n & 1 ? second_ip : local_ip, options, payload,
+				(uint16_t) (n * 0x0101), (uint16_t) (0xF7FF - n * 0x3D));
+		check(offload_frame(len), "echo request not answered");
+		check_echo_reply(len);
+	}
+
+	/*
+	 * Request checksums around the carry of the update (0xF7FF) and around 0 and 0xFFFF: the sequence number is
+	 * searched so the request has exactly the wanted checksum, where one exists
+	 */
+	uint32_t carries = 0;
+	for (uint32_t n = 0; n < 64; n++) {
+		uint16_t wanted = n < 32 ? 0xF7F0 + n : (uint16_t) (0xFFF0 + n - 32);
+		uint16_t len = echo_request(eth.mac_address, local_ip, 0, 0, (uint16_t) n, 0);
+		for (uint32_t number = 0; number <= 0xFFFF; number++) {
+			put16(&frame[36], 0);
+			put16(&frame[40], (uint16_t) number);
+			uint16_t request_checksum = ~checksum(&frame[34], 8);
+			if (request_checksum == wanted) {
+				put16(&frame[36], wanted);
+				check(offload_frame(len), "echo request not answered");
+				check_echo_reply(len);
+				carries++;
+				break;
+			}
+		}
+	}
+
+	/* Not for the responder: delivered unchanged */
+	uint32_t echo_replies = offload.echo_replies;
+	check(!offload_frame(echo_request(eth.mac_address, foreign_ip, 0, 56, 1, 1)), "foreign echo request answered");
+	uint8_t multicast[6] = { 0x01, 0x00, 0x5E, 0x00, 0x00, 0x01 };
+	check(!offload_frame(echo_request(multicast, local_ip, 0, 56, 1, 2)), "multicast echo request answered");
+	uint16_t len = echo_request(eth.mac_address, local_ip, 0, 56, 1, 3);
+	frame[20] = 0x20;  /* More fragments */
+	frame[24] = frame[25] = 0;
+	put16(&frame[24], ~checksum(&frame[14], 20));
+	check(!offload_frame(len), "fragmented echo request answered");
+	check(!offload_frame(14 + 20), "truncated frame answered");
+	check(!offload_frame(echo_request(eth.mac_address, local_ip, 12, 56, 1, 4)),
+			"echo request with the ICMP header beyond the first 42 bytes answered");
+
+	offload.icmp = false;
+	check(!offload_frame(echo_request(eth.mac_address, local_ip, 0, 56, 1, 4)), "disabled responder answered");
+	offload.icmp = true;
+
+	/* The transmit buffer is held by another sender: the request is left to lwIP */
+	uint8_t other[64] = { 0 };
+	enc28j60_transfer_init(&eth);
+	enc28j60_transfer_write(&eth, other, sizeof(other));
+	check(!offload_frame(echo_request(eth.mac_address, local_ip, 0, 56, 1, 5)), "answered into a held buffer");
+	enc28j60_transfer_send(&eth);
+	check(offload.echo_replies == echo_replies, "replies counted for delivered frames");
+
+	check(offload.arp_replies == 2 && offload.echo_replies == ECHOES + carries, "replies not counted");
+
+	printf("%lu ARP replies, %lu echo replies: %s\n", (unsigned long) offload.arp_replies,
+			(unsigned long) offload.echo_replies, ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
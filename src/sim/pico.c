@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <hardware/clocks.h>
+#include <hardware/dma.h>
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+#include <hardware/timer.h>
+#include <pico/time.h>
+
+#include <pico/enc28j60/pio.h>
+#include <pico/enc28j60/sim.h>
+
+/*
+ * Pico SDK functions used by the driver, for host builds.
+ * SPI transfers and chip select go to the simulated chips, time is the virtual clock of the simulator.
+ */
+
+spi_inst_t enc28j60_sim_spi[2] = {
+	{ .baudrate = 1000000 },
+	{ .baudrate = 1000000 },
+};
+
+uint
+spi_init(spi_inst_t *spi, uint baudrate)
+{
+	return spi_set_baudrate(spi, baudrate);
+}
+
+uint
+spi_set_baudrate(spi_inst_t *spi, uint baudrate)
+{
+	/* The ENC28J60 is specified up to 20 MHz */
+	spi->baudrate = baudrate > 20000000 ? 20000000 : baudrate;
+
+	return spi->baudrate;
+}
+
+int
+spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		enc28j60_sim_spi_transfer(spi, spi->baudrate, src[i]);
+	}
+
+	return (int) len;
+}
+
+int
+spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		dst[i] = enc28j60_sim_spi_transfer(spi, spi->baudrate, repeated_tx_data);
+	}
+
+	return (int) len;
+}
+
+int
+spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		dst[i] = enc28j60_sim_spi_transfer(spi, spi->baudrate, src[i]);
+	}
+
+	return (int) len;
+}
+
+void
+gpio_init(uint gpio)
+{
+	(void) gpio;
+}
+
+void
+gpio_set_dir(uint gpio, bool out)
+{
+	(void) gpio;
+	(void) out;
+}
+
+void
+gpio_set_function(uint gpio, enum gpio_function fn)
+{
+	(void) gpio;
+	(void) fn;
+}
+
+void
+gpio_put(uint gpio, bool value)
+{
+	/* Chip select is active low */
+	enc28j60_sim_select((uint8_t) gpio, !value);
+}
+
+static gpio_irq_callback_t enc28j60_sim_gpio_callback;
+static uint32_t enc28j60_sim_gpio_events[32];
+
+void
+gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled)
+{
+	if (gpio >= 32) {
+		return;
+	}
+
+	if (enabled) {
+		enc28j60_sim_gpio_events[gpio] |= event_mask;
+	} else {
+		enc28j60_sim_gpio_events[gpio] &= ~event_mask;
+	}
+}
+
+void
+gpio_set_irq_enabled_with_callback(uint gpio, uint32_t event_mask, bool enabled, gpio_irq_callback_t callback)
+{
+	gpio_set_irq_enabled(gpio, event_mask, enabled);
+	enc28j60_sim_gpio_callback = callback;
+}
+
+void
+enc28j60_sim_gpio_irq(uint8_t gpio, uint32_t events)
+{
+	if (gpio < 32 && (enc28j60_sim_gpio_events[gpio] & events) && enc28j60_sim_gpio_callback != NULL) {
+		enc28j60_sim_gpio_callback(gpio, enc28j60_sim_gpio_events[gpio] & events);
+	}
+}
+
+uint64_t
+time_us_64(void)
+{
+	return enc28j60_sim_time_ns() / 1000;
+}
+
+absolute_time_t
+get_absolute_time(void)
+{
+	return time_us_64();
+}
+
+void
+sleep_us(uint64_t us)
+{
+	enc28j60_sim_advance(us * 1000);
+}
+
+void
+sleep_ms(uint32_t ms)
+{
+	enc28j60_sim_advance((uint64_t) ms * 1000000);
+}
+
+uint32_t
+clock_get_hz(enum clock_index clk_index)
+{
+	(void) clk_index;
+
+	return 125000000;
+}
+
+void
+enc28j60_pio_command(const struct enc28j60_pio *self, uint8_t instruction, const uint8_t *tx, size_t tx_len,
+		uint8_t *rx, size_t rx_len)
+{
+	(void) self;
+	(void) instruction;
+	(void) tx;
+	(void) tx_len;
+	(void) rx;
+	(void) rx_len;
+
+	fprintf(stderr, "enc28j60_sim: the PIO transport is not simulated, set pio to NULL\n");
+	abort();
+}
+
+void
+enc28j60_pio_commands(const struct enc28j60_pio *self, const uint8_t (*commands)[2], size_t count)
+{
+	(void) self;
+	(void) commands;
+	(void) count;
+
+	fprintf(stderr, "enc28j60_sim: the PIO transport is not simulated, set pio to NULL\n");
+	abort();
+}
+
+int
+dma_claim_unused_channel(bool required)
+{
+	static int channels;
+
+	if (channels == 12) {
+		if (required) {
+			fprintf(stderr, "enc28j60_sim: no free DMA channel\n");
+			abort();
+		}
+		return -1;
+	}
+
+	return channels++;
+}
+
+void
+dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+		const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+	(void) channel;
+	(void) config;
+	(void) write_addr;
+	(void) read_addr;
+	(void) transfer_count;
+	(void) trigger;
+
+	fprintf(stderr, "enc28j60_sim: DMA is not simulated, set pio to NULL\n");
+	abort();
+}
+
+void
+dma_start_channel_mask(uint32_t chan_mask)
+{
+	(void) chan_mask;
+}
+
+bool
+dma_channel_is_busy(uint channel)
+{
+	(void) channel;
+
+	return false;
+}
+
+void
+dma_channel_wait_for_finish_blocking(uint channel)
+{
+	(void) channel;
+}
@@ -0,0 +1,54 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * FreeRTOS options of the host test of ethernetif_rtos (rtos_host), for the POSIX port.
+ * Scheduling is cooperative: the simulated chips and their SPI bus are shared by all tasks, so a task switch in the
+ * middle of an SPI transaction would hand a half selected chip to another task. Tasks only switch when they block.
+ */
+
+#define configUSE_PREEMPTION 0
+#define configUSE_TIME_SLICING 0
+#define configIDLE_SHOULD_YIELD 1
+#define configUSE_IDLE_HOOK 0
+#define configUSE_TICK_HOOK 0
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 8
+#define configMINIMAL_STACK_SIZE 8192  /* Words, the POSIX port runs every task on a thread of this stack */
+#define configMAX_TASK_NAME_LEN 16
+#define configUSE_16_BIT_TICKS 0
+#define configUSE_TASK_NOTIFICATIONS 1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES 2
+#define configUSE_MUTEXES 1
+#define configUSE_RECURSIVE_MUTEXES 1
+#define configUSE_COUNTING_SEMAPHORES 1
+#define configQUEUE_REGISTRY_SIZE 0
+#define configUSE_QUEUE_SETS 0
+#define configUSE_TIMERS 0
+#define configUSE_CO_ROUTINES 0
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
+#define configSUPPORT_STATIC_ALLOCATION 0
+#define configTOTAL_HEAP_SIZE (1024 * 1024)
+#define configUSE_MALLOC_FAILED_HOOK 0
+#define configCHECK_FOR_STACK_OVERFLOW 0
+#define configUSE_TRACE_FACILITY 0
+#define configGENERATE_RUN_TIME_STATS 0
+
+#define INCLUDE_vTaskDelay 1
+#define INCLUDE_vTaskDelete 1
+#define INCLUDE_vTaskSuspend 1
+#define INCLUDE_xTaskGetCurrentTaskHandle 1
+#define INCLUDE_xTaskGetSchedulerState 1
+
+#define configASSERT(x) \
+	do { \
+		if (!(x)) { \
+			fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__, __LINE__, #x); \
+			abort(); \
+		} \
+	} while (0)
+
+#endif
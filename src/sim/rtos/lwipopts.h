@@ -0,0 +1,38 @@
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+/*
+ * lwIP options of the host test of ethernetif_rtos (rtos_host), with NO_SYS 0 on the FreeRTOS POSIX port.
+ * Both interfaces of the simulated link run in this one lwIP instance.
+ */
+
+#define NO_SYS 0
+#define SYS_LIGHTWEIGHT_PROT 1
+#define LWIP_TCPIP_CORE_LOCKING 1
+#define LWIP_NETCONN 0
+#define LWIP_SOCKET 0
+#define MEM_ALIGNMENT 4
+#define MEM_SIZE (32 * 1024)
+#define LWIP_RAW 0
+#define LWIP_DHCP 0
+#define LWIP_ICMP 1
+#define LWIP_UDP 1
+#define LWIP_TCP 0
+#define LWIP_IPV6 0
+#define LWIP_SINGLE_NETIF 0
+#define ETH_PAD_SIZE 0
+
+#define PBUF_POOL_SIZE 16
+#define MEMP_NUM_PBUF 32
+#define MEMP_NUM_TCPIP_MSG_INPKT 16
+
+#define TCPIP_MBOX_SIZE 16
+#define TCPIP_THREAD_STACKSIZE 8192  /* Words, see configMINIMAL_STACK_SIZE */
+#define TCPIP_THREAD_PRIO 6
+
+#define LWIP_STATS 1
+#define LINK_STATS 1
+#define UDP_STATS 1
+#define LWIP_STATS_DISPLAY 0
+
+#endif /* __LWIPOPTS_H__ */
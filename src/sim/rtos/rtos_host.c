@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <task.h>
+
+#include "lwip/netif.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcpip.h"
+#include "lwip/udp.h"
+
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/ethernetif.h>
+#include <pico/enc28j60/ethernetif_rtos.h>
+#include <pico/enc28j60/sim.h>
+
+/*
+ * Host test of ethernetif_rtos on the FreeRTOS POSIX port.
+ * Two simulated ENC28J60 are cabled to each other, each served by its own driver task, with both interfaces in one
+ * lwIP instance running NO_SYS 0. Interface A sends UDP datagrams to interface B. Every payload is a PBUF_REF to a
+ * buffer that is overwritten as soon as udp_sendto returns, so B only sees the sent payload if the driver copied it
+ * before queueing. The INT pins are modelled by an interrupt task raising the GPIO interrupt on every asserting
+ * edge. Exits with status 1 if a datagram is lost or corrupted.
+ */
+
+/* Configuration */
+#define SPI_HZ 20000000
+#define DATAGRAMS 200
+#define DATAGRAM_LEN 1000
+#define UDP_PORT 5003
+#define TIMEOUT_TICKS 5000
+#define NETWORK_MASK IPADDR4_INIT_BYTES(255, 255, 255, 0)
+#define GATEWAY_ADDRESS IPADDR4_INIT_BYTES(0, 0, 0, 0)
+
+struct port {
+	struct enc28j60_sim chip;
+	struct enc28j60 eth;
+	struct ethernetif_rtos rtos;
+	struct netif netif;
+	uint8_t int_pin;
+
+	/* INT pin state seen on the last clock advance, and an asserting edge not raised yet */
+	bool asserted;
+	volatile bool edge;
+};
+
+static struct port ports[2] = {
+	{
+		.eth = { .spi = spi0, .cs_pin = 10, .mac_address = { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x0A } },
+		.int_pin = 20,
+	},
+	{
+		.eth = { .spi = spi0, .cs_pin = 11, .mac_address = { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x0B } },
+		.int_pin = 21,
+	},
+};
+
+static const struct ip4_addr ip_addresses[2] = {
+	IPADDR4_INIT_BYTES(10, 0, 0, 1),
+	IPADDR4_INIT_BYTES(10, 0, 0, 2),
+};
+
+static uint8_t payload[DATAGRAM_LEN];
+static volatile uint32_t received;
+static volatile uint32_t corrupted;
+
+static void
+fill(uint8_t *data, uint32_t sequence)
+{
+	for (size_t i = 0; i < DATAGRAM_LEN; i++) {
+		data[i] = (uint8_t) (sequence * 31 + i);
+	}
+}
+
+static void
+chip_advance(struct enc28j60_sim *sim, uint64_t now_ns, void *context)
+{
+	struct port *port = context;
+	bool asserted = enc28j60_sim_interrupt(sim);
+
+	(void) now_ns;
+
+	if (asserted && !port->asserted) {
+		port->edge = true;
+	}
+	port->asserted = asserted;
+}
+
+/* Stands in for the GPIO interrupt: raises edges recorded by chip_advance, never in the middle of an SPI transfer */
+static void
+interrupt_task(void *argument)
+{
+	(void) argument;
+
+	for (;;) {
+		for (size_t i = 0; i < 2; i++) {
+			/* Registers written by the last SPI byte are only seen on the next clock advance, sample them now */
+			chip_advance(&ports[i].chip, enc28j60_sim_time_ns(), &ports[i]);
+			if (ports[i].edge) {
+				ports[i].edge = false;
+				enc28j60_sim_gpio_irq(ports[i].int_pin, GPIO_IRQ_EDGE_FALL);
+			}
+		}
+		vTaskDelay(1);
+	}
+}
+
+static void
+udp_receive(void *arg, struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+	uint8_t expected[DATAGRAM_LEN];
+	uint8_t data[DATAGRAM_LEN];
+
+	(void) arg;
+	(void) pcb;
+	(void) addr;
+	(void) port;
+
+	fill(expected, received);
+	if (p->tot_len != DATAGRAM_LEN || pbuf_copy_partial(p, data, DATAGRAM_LEN, 0) != DATAGRAM_LEN
+			|| memcmp(data, expected, DATAGRAM_LEN)) {
+		corrupted++;
+	}
+	received++;
+	pbuf_free(p);
+}
+
+static void
+tcpip_ready(void *arg)
+{
+	xSemaphoreGive((SemaphoreHandle_t) arg);
+}
+
+static void
+test_task(void *argument)
+{
+	const struct ip4_addr netmask = NETWORK_MASK;
+	const struct ip4_addr gw = GATEWAY_ADDRESS;
+	SemaphoreHandle_t ready = xSemaphoreCreateBinary();
+	ip_addr_t destination;
+
+	(void) argument;
+
+	tcpip_init(tcpip_ready, ready);
+	xSemaphoreTake(ready, portMAX_DELAY);
+
+	for (size_t i = 0; i < 2; i++) {
+		LOCK_TCPIP_CORE();
+		netif_add(&ports[i].netif, &ip_addresses[i], &netmask, &gw, &ports[i].eth, ethernetif_init, tcpip_input);
+		netif_set_up(&ports[i].netif);
+		netif_set_link_up(&ports[i].netif);
+		UNLOCK_TCPIP_CORE();
+
+		ports[i].rtos.int_pin = ports[i].int_pin;
+		ports[i].rtos.stack_size = configMINIMAL_STACK_SIZE;
+		if (!ethernetif_rtos_start(&ports[i].rtos, &ports[i].netif)) {
+			fprintf(stderr, "ethernetif_rtos_start failed\n");
+			exit(1);
+		}
+	}
+
+	LOCK_TCPIP_CORE();
+	struct udp_pcb *sink = udp_new();
+	udp_bind_netif(sink, &ports[1].netif);
+	udp_bind(sink, IP_ADDR_ANY, UDP_PORT);
+	udp_recv(sink, udp_receive, NULL);
+	struct udp_pcb *source = udp_new();
+	udp_bind_netif(source, &ports[0].netif);
+	UNLOCK_TCPIP_CORE();
+	ip_addr_copy_from_ip4(destination, ip_addresses[1]);
+
+	uint32_t sent = 0;
+	while (sent < DATAGRAMS) {
+		fill(payload, sent);
+
+		LOCK_TCPIP_CORE();
+		struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, DATAGRAM_LEN, PBUF_REF);
+		err_t err = ERR_MEM;
+		if (p != NULL) {
+			p->payload = payload;
+			err = udp_sendto(source, p, &destination, UDP_PORT);
+			pbuf_free(p);
+		}
+		UNLOCK_TCPIP_CORE();
+
+		/* The caller owns the buffer again */
+		memset(payload, 0xEE, sizeof(payload));
+		if (err == ERR_OK) {
+			sent++;
+		}
+		vTaskDelay(1);
+	}
+
+	for (TickType_t waited = 0; received < DATAGRAMS && waited < TIMEOUT_TICKS; waited++) {
+		vTaskDelay(1);
+	}
+
+	printf("sent %lu, received %lu, corrupted %lu\n", (unsigned long) sent, (unsigned long) received,
+			(unsigned long) corrupted);
+	for (size_t i = 0; i < 2; i++) {
+		printf("port %zu: rx frames %lu, rx batches %lu, tx packets %lu, tx dropped %lu\n", i,
+				(unsigned long) ports[i].rtos.rx_frames, (unsigned long) ports[i].rtos.rx_batches,
+				(unsigned long) ports[i].rtos.tx_packets, (unsigned long) ports[i].rtos.tx_dropped);
+	}
+	fflush(stdout);
+
+	exit(received == DATAGRAMS && !corrupted ? 0 : 1);
+}
+
+int
+main(void)
+{
+	spi_init(spi0, SPI_HZ);
+	for (size_t i = 0; i < 2; i++) {
+		ports[i].chip.spi = spi0;
+		ports[i].chip.cs_pin = ports[i].eth.cs_pin;
+		ports[i].chip.peer = &ports[1 - i].chip;
+		ports[i].chip.on_advance = chip_advance;
+		ports[i].chip.context = &ports[i];
+		enc28j60_sim_attach(&ports[i].chip);
+		gpio_init(ports[i].eth.cs_pin);
+		gpio_set_dir(ports[i].eth.cs_pin, GPIO_OUT);
+		gpio_put(ports[i].eth.cs_pin, 1);
+	}
+
+	xTaskCreate(interrupt_task, "int", configMINIMAL_STACK_SIZE, NULL, configMAX_PRIORITIES - 1, NULL);
+	xTaskCreate(test_task, "test", configMINIMAL_STACK_SIZE, NULL, 1, NULL);
+	vTaskStartScheduler();
+
+	return 1;
+}
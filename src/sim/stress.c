@@ -0,0 +1,581 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+#include <hardware/timer.h>
+#include <pico/stdlib.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/sim.h>
+
+/*
+ * Soak and overload stress of the receive path against the simulated ENC28J60.
+ * Frames arrive at a rate relative to the measured drain capacity of the driver, from 10% to 200% by default but
+ * never faster than the 10 Mbit/s wire, while the driver serves them from the INT pin like an interrupt handler
+ * and optionally forwards part of them through the single slot transmit buffer. The mix has odd lengths and frames sized to straddle the end of the receive ring,
+ * followed by back to back bursts up to EPKTCNT saturation. Every frame is checked against what the chip wrote:
+ * its address in the ring, length, sequence number, contents and the ERXRDPT left by enc28j60_receive_ack (errata
+ * issue 14), and any mismatch is reported as a pointer desynchronisation. All times are virtual, see
+ * pico/enc28j60/sim.h.
+ *
+ * Usage: stress [-s spi_hz] [-c cpu_us] [-t forward_percent] [-b rx_buffer_size] [-d duration_ms] [-o csv] [load ...]
+ */
+
+/* Configuration */
+#define CS_PIN 10
+#define MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x92 }
+#define SOURCE_MAC_ADDRESS { 0x62, 0x5E, 0x22, 0x07, 0xDE, 0x01 }
+#define LOADS { 10, 25, 50, 75, 90, 100, 110, 125, 150, 200 }  /* Percent of the drain capacity */
+#define DURATION_MS 500  /* Arrival time per load */
+#define CALIBRATION_MS 500  /* Arrival time at line rate to measure the drain capacity */
+#define STRADDLE_EVERY 8  /* Every nth frame of the mix is sized to straddle the end of the ring */
+#define BURST_FRAMES 300
+#define CLIFF_DROPS 100  /* Drop rate in 0.01% the throughput cliff is reported at */
+#define SAMPLE_US 100  /* Interval of the occupancy samples written to the CSV file */
+#define RECOVERY_TIMEOUT_US 1000000
+
+#define WIRE_NS_PER_BYTE 800
+#define WIRE_OVERHEAD 24  /* Preamble, CRC and inter packet gap */
+#define MIN_LEN 60  /* Frame lengths without CRC */
+#define MAX_LEN 1514
+#define RUNT_LEN 14  /* Shortest frame the simulated chip accepts, only used to saturate EPKTCNT */
+#define HEADER_LEN 20  /* Addresses, EtherType, sequence number and length */
+#define MAX_LOADS 32
+#define EXPECTED 512  /* Frames accepted by the chip and not verified yet */
+
+/* Frame the chip accepted, as the driver has to find it */
+struct expected {
+	uint32_t sequence;
+	uint16_t address;
+	uint16_t len;
+};
+
+/* Arrivals of one phase and what became of them */
+struct traffic {
+	uint64_t next_ns;  /* Arrival time of the next frame, 0 when stopped */
+	uint64_t interval_ns;  /* Mean time between arrivals, 0 for back to back */
+	uint16_t len;  /* Length of every frame, 0 for the mix */
+	uint32_t remaining;  /* Frames left to arrive */
+	uint32_t sequence;
+	uint32_t seed;
+
+	struct expected expected[EXPECTED];
+	size_t head;
+	size_t count;
+
+	/* Counters */
+	uint32_t offered;
+	uint64_t offered_bytes;
+	uint32_t accepted;
+	uint32_t straddled;
+
+	/* Ring occupancy, integrated over time */
+	uint64_t last_ns;
+	uint64_t used_ns;
+	uint16_t max_used;
+	uint64_t next_sample_ns;
+};
+
+/* Results of one phase */
+struct result {
+	const char *name;
+	uint32_t load;  /* Percent of the drain capacity, 0 for bursts */
+	uint32_t offered;
+	uint64_t offered_bytes;
+	uint32_t received;
+	uint64_t received_bytes;
+	uint32_t overflows;
+	uint32_t saturated;
+	uint32_t straddled;
+	uint32_t desyncs;
+	uint32_t rx_errors;
+	uint64_t duration_ns;
+	uint64_t recovery_ns;
+	uint32_t mean_used;
+	uint16_t max_used;
+};
+
+struct options {
+	uint32_t spi_hz;
+	uint32_t cpu_us;
+	uint32_t forward_percent;
+	uint16_t rx_buffer_size;
+	uint32_t duration_ms;
+	FILE *csv;
+};
+
+static struct enc28j60 enc28j60 = {
+	.spi = spi0,
+	.cs_pin = CS_PIN,
+	.mac_address = MAC_ADDRESS,
+};
+static struct enc28j60_sim chip = {
+	.spi = spi0,
+	.cs_pin = CS_PIN,
+};
+
+static struct traffic traffic;
+static struct result *result;
+static struct options options;
+static const char *phase = "";
+static uint32_t forward_credit;
+static uint8_t frame[MAX_LEN];
+static uint8_t received[MAX_LEN];
+
+static uint32_t
+random_next(void)
+{
+	traffic.seed = traffic.seed * 1664525 + 1013904223;
+
+	return traffic.seed >> 8;
+}
+
+/* Bytes a frame takes in the receive ring: header, frame and CRC, rounded up to an even address */
+static uint16_t
+ring_bytes(uint16_t len)
+{
+	uint16_t count = 6 + len + 4;
+
+	return count + (count & 1);
+}
+
+/*
+ * Length of the next frame of the mix: minimal and odd short frames, odd medium frames and full frames. Every
+ * STRADDLE_EVERY frame is sized so its data, or the header of the frame after it, wraps at the end of the ring.
+ */
+static uint16_t
+mix_length(void)
+{
+	uint32_t r = random_next();
+
+	if (traffic.sequence % STRADDLE_EVERY == 0) {
+		uint16_t write = enc28j60_sim_rx_write_pointer(&chip);
+		uint16_t to_end = enc28j60_rx_buffer_size(&enc28j60) - write;
+		int len = (r & 1) ? to_end - 10 + 1 + (int) (r >> 1) % 8 * 2 : to_end - 10 - 2;
+		if (len >= MIN_LEN && len <= MAX_LEN) {
+			return (uint16_t) len;
+		}
+	}
+
+	switch (r % 10) {
+	case 0:
+	case 1:
+		return MIN_LEN;
+	case 2:
+	case 3:
+		return (MIN_LEN + 1 + (r >> 4) % 34 * 2);
+	case 4:
+	case 5:
+	case 6:
+		return (128 + (r >> 4) % 900) | 1;
+	default:
+		return MAX_LEN;
+	}
+}
+
+/* A frame arrives from the wire */
+static bool
+inject(uint16_t len)
+{
+	const uint8_t destination[] = MAC_ADDRESS;
+	const uint8_t source[] = SOURCE_MAC_ADDRESS;
+	uint32_t sequence = traffic.sequence++;
+	uint16_t write = enc28j60_sim_rx_write_pointer(&chip);
+
+	memcpy(frame, destination, 6);
+	memcpy(&frame[6], source, 6);
+	frame[12] = 0x88;  /* Local experimental EtherType */
+	frame[13] = 0xB5;
+	if (len >= HEADER_LEN) {
+		memcpy(&frame[14], &sequence, 4);
+		memcpy(&frame[18], &len, 2);
+	}
+	for (size_t i = HEADER_LEN; i < len; i++) {
+		frame[i] = (uint8_t) (sequence + i);
+	}
+
+	traffic.offered++;
+	traffic.offered_bytes += len;
+	if (!enc28j60_sim_receive(&chip, frame, len)) {
+		return false;
+	}
+
+	traffic.accepted++;
+	if (write + ring_bytes(len) > enc28j60_rx_buffer_size(&enc28j60)) {
+		traffic.straddled++;
+	}
+	if (traffic.count < EXPECTED) {
+		traffic.expected[(traffic.head + traffic.count++) % EXPECTED] = (struct expected) {
+			.sequence = sequence,
+			.address = write,
+			.len = len,
+		};
+	}
+
+	return true;
+}
+
+/* Clock hook of the chip: deliver due frames and integrate the ring occupancy */
+static void
+arrivals(struct enc28j60_sim *sim, uint64_t now_ns, void *context)
+{
+	uint16_t used = enc28j60_sim_rx_used(sim);
+
+	(void) context;
+
+	traffic.used_ns += (uint64_t) used * (now_ns - traffic.last_ns);
+	traffic.last_ns = now_ns;
+	if (used > traffic.max_used) {
+		traffic.max_used = used;
+	}
+
+	if (options.csv != NULL && now_ns >= traffic.next_sample_ns) {
+		fprintf(options.csv, "%s,%llu,%u,%u\n", phase, (unsigned long long) (now_ns / 1000), used,
+				enc28j60_sim_packets(sim));
+		traffic.next_sample_ns = now_ns + SAMPLE_US * 1000;
+	}
+
+	while (traffic.next_ns && traffic.next_ns <= now_ns) {
+		uint16_t len = traffic.len ? traffic.len : mix_length();
+		inject(len);
+
+		if (!--traffic.remaining) {
+			traffic.next_ns = 0;
+		} else if (traffic.interval_ns) {
+			/* At the given interval, jittered by +-50% around the mean for the mix, never faster than the wire */
+			uint64_t wire_ns = (uint64_t) (len + WIRE_OVERHEAD) * WIRE_NS_PER_BYTE;
+			uint64_t interval_ns = traffic.len ? traffic.interval_ns
+					: traffic.interval_ns / 2 + (uint64_t) random_next() % (traffic.interval_ns + 1);
+			traffic.next_ns += interval_ns > wire_ns ? interval_ns : wire_ns;
+		}
+	}
+}
+
+static void
+desync(const char *what, uint16_t address, uint16_t len)
+{
+	result->desyncs++;
+	if (result->desyncs <= 5) {
+		fprintf(stderr, "%s: desync, %s (frame at 0x%04X, %u bytes, next 0x%04X, ERXRDPT 0x%04X)\n", phase, what,
+				address, len, enc28j60.next_packet, enc28j60_sim_rx_read_pointer(&chip));
+	}
+
+	/* Realign with the driver so one error is not counted for every following frame */
+	while (traffic.count && traffic.expected[traffic.head].address != enc28j60.next_packet) {
+		traffic.head = (traffic.head + 1) % EXPECTED;
+		traffic.count--;
+	}
+}
+
+/* Check a frame read by the driver, and the read pointer it left, against what the chip wrote */
+static void
+verify(uint16_t address, uint16_t len)
+{
+	uint16_t rx_size = enc28j60_rx_buffer_size(&enc28j60);
+	uint16_t read_pointer = enc28j60.next_packet ? enc28j60.next_packet - 1 : rx_size - 1;
+
+	if (!traffic.count) {
+		desync("frame that never arrived", address, len);
+		return;
+	}
+
+	struct expected expected = traffic.expected[traffic.head];
+	traffic.head = (traffic.head + 1) % EXPECTED;
+	traffic.count--;
+
+	if (address != expected.address) {
+		desync("frame read at the wrong address", address, len);
+		return;
+	}
+	if (len != expected.len) {
+		desync("wrong length", address, len);
+		return;
+	}
+
+	/* Runts are too short to carry a sequence number */
+	uint32_t sequence = expected.sequence;
+	if (len >= HEADER_LEN) {
+		memcpy(&sequence, &received[14], 4);
+	}
+	bool intact = sequence == expected.sequence;
+	for (size_t i = HEADER_LEN; intact && i < len; i++) {
+		intact = received[i] == (uint8_t) (sequence + i);
+	}
+	if (!intact) {
+		desync("corrupted frame", address, len);
+		return;
+	}
+
+	if (enc28j60_sim_rx_read_pointer(&chip) != read_pointer) {
+		desync("ERXRDPT does not trail the next frame", address, len);
+	}
+}
+
+/* Frame handling of the driver: read, acknowledge, check, then the application */
+static void
+receive_frame(void)
+{
+	uint16_t address = enc28j60.next_packet;
+	uint16_t len = enc28j60_receive_init(&enc28j60);
+
+	if (len && len <= sizeof(received)) {
+		enc28j60_receive_read(&enc28j60, received, len);
+	}
+	enc28j60_receive_ack(&enc28j60);
+
+	result->received++;
+	result->received_bytes += len;
+	verify(address, len);
+
+	if (options.cpu_us) {
+		sleep_us(options.cpu_us);
+	}
+
+	/* Forwarding goes through the single transmit slot, waiting for the previous frame to leave */
+	forward_credit += options.forward_percent;
+	if (forward_credit >= 100 && len <= sizeof(received)) {
+		forward_credit -= 100;
+		memcpy(received, &received[6], 6);
+		enc28j60_transfer_init(&enc28j60);
+		enc28j60_transfer_write(&enc28j60, received, len);
+		enc28j60_transfer_start(&enc28j60);
+	}
+}
+
+/* One pass of the interrupt handler, or a microsecond of idle time if the INT pin is not asserted */
+static void
+service(void)
+{
+	if (!enc28j60_sim_interrupt(&chip)) {
+		sleep_us(1);
+		return;
+	}
+
+	enc28j60_isr_begin(&enc28j60);
+	uint8_t flags = enc28j60_interrupt_flags(&enc28j60);
+
+	if (flags & ENC28J60_RXERIF) {
+		result->rx_errors++;
+		enc28j60_reg_clear(&enc28j60, ENC28J60_REG_ESTAT, ENC28J60_BUFER);
+	}
+
+	if (flags & ENC28J60_PKTIF) {
+		uint8_t pending = enc28j60_reg_read(&enc28j60, ENC28J60_REG_EPKTCNT);
+		while (pending--) {
+			receive_frame();
+		}
+	}
+
+	enc28j60_interrupt_clear(&enc28j60, flags);
+	enc28j60_isr_end(&enc28j60);
+}
+
+static void
+traffic_start(uint64_t interval_ns, uint16_t len, uint32_t frames)
+{
+	uint32_t sequence = traffic.sequence;
+	uint32_t seed = traffic.seed;
+
+	memset(&traffic, 0, sizeof(traffic));
+	traffic.sequence = sequence;
+	traffic.seed = seed;
+	traffic.last_ns = enc28j60_sim_time_ns();
+	traffic.interval_ns = interval_ns;
+	traffic.len = len;
+	traffic.remaining = frames;
+	traffic.next_ns = frames ? enc28j60_sim_time_ns() + 1 : 0;
+}
+
+/* Run a phase: arrivals until they are exhausted or duration is over, then the time to drain the ring */
+static void
+run_phase(struct result *phase_result, uint64_t duration_ns)
+{
+	uint32_t overflows = chip.rx_overflows;
+	uint32_t saturated = chip.rx_saturated;
+	uint64_t start = enc28j60_sim_time_ns();
+
+	result = phase_result;
+	phase = result->name;
+	while (traffic.next_ns && enc28j60_sim_time_ns() - start < duration_ns) {
+		service();
+	}
+	traffic.next_ns = 0;
+
+	uint64_t stop = enc28j60_sim_time_ns();
+	while ((enc28j60_sim_packets(&chip) || enc28j60_sim_interrupt(&chip))
+			&& enc28j60_sim_time_ns() - stop < RECOVERY_TIMEOUT_US * 1000ull) {
+		service();
+	}
+	uint64_t end = enc28j60_sim_time_ns();
+
+	result->offered = traffic.offered;
+	result->offered_bytes = traffic.offered_bytes;
+	result->overflows = chip.rx_overflows - overflows;
+	result->saturated = chip.rx_saturated - saturated;
+	result->straddled = traffic.straddled;
+	result->duration_ns = stop - start;
+	result->recovery_ns = end - stop;
+	result->mean_used = end > start ? (uint32_t) (traffic.used_ns / (end - start)) : 0;
+	result->max_used = traffic.max_used;
+	if (traffic.count) {
+		desync("frames left unread", enc28j60_sim_rx_write_pointer(&chip), 0);
+	}
+}
+
+/*
+ * Drain capacity of the driver for the mix, as the mean time per frame: the mix arrives at line rate for
+ * CALIBRATION_MS while the driver serves the INT pin like in the load phases, then the ring is drained. Includes the
+ * CPU time and forwarding given in the options, so loads are relative to what this setup can sustain. A driver
+ * that drops nothing meanwhile is faster than the wire, and held to the wire rate of the mix.
+ */
+static uint64_t
+calibrate(struct result *calibration)
+{
+	calibration->name = "calibrate";
+	traffic_start(1, 0, UINT32_MAX);
+	run_phase(calibration, CALIBRATION_MS * 1000000ull);
+
+	return (calibration->duration_ns + calibration->recovery_ns) / (calibration->received ? calibration->received : 1);
+}
+
+static void
+report(const struct result *r)
+{
+	uint32_t drops = r->overflows + r->saturated;
+	uint32_t drop_rate = r->offered ? (uint32_t) (drops * 10000ull / r->offered) : 0;
+	double mbps = r->duration_ns ? r->offered_bytes * 8e3 / r->duration_ns : 0;
+	uint16_t rx_size = enc28j60_rx_buffer_size(&enc28j60);
+
+	/* Bursts are back to back, their rate is that of the wire or none at all */
+	if (!r->load) {
+		mbps = 0;
+	}
+	printf("%-9s %7lu %6.2f  %7lu %3lu.%02lu%% %6lu %5lu %4lu%% %4lu%% %9.2f %6lu %6lu\n", r->name,
+			(unsigned long) r->offered, mbps, (unsigned long) r->received,
+			(unsigned long) (drop_rate / 100), (unsigned long) (drop_rate % 100), (unsigned long) r->overflows,
+			(unsigned long) r->saturated, (unsigned long) (r->mean_used * 100 / rx_size),
+			(unsigned long) (r->max_used * 100 / rx_size), r->recovery_ns / 1e6, (unsigned long) r->straddled,
+			(unsigned long) r->desyncs);
+}
+
+int
+main(int argc, char **argv)
+{
+	uint32_t loads[MAX_LOADS] = LOADS;
+	size_t load_count = sizeof((uint32_t[]) LOADS) / sizeof(uint32_t);
+	static struct result results[MAX_LOADS + 2];
+	struct result calibration = { 0 };
+	static char names[MAX_LOADS][sizeof("load %") + 20];  /* Room for the 20 digits of a 64-bit unsigned long */
+	int option;
+
+	options = (struct options) {
+		.spi_hz = 16000000,
+		.duration_ms = DURATION_MS,
+	};
+	while ((option = getopt(argc, argv, "s:c:t:b:d:o:")) != -1) {
+		uint32_t value = strtoul(optarg, NULL, 0);
+		switch (option) {
+		case 's': options.spi_hz = value; break;
+		case 'c': options.cpu_us = value; break;
+		case 't': options.forward_percent = value > 100 ? 100 : value; break;
+		case 'b': options.rx_buffer_size = value & ~1u; break;
+		case 'd': options.duration_ms = value; break;
+		case 'o':
+			options.csv = fopen(optarg, "w");
+			if (options.csv == NULL) {
+				perror(optarg);
+				return 2;
+			}
+			fprintf(options.csv, "phase,time_us,used,packets\n");
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s spi_hz] [-c cpu_us] [-t forward_percent] [-b rx_buffer_size] "
+					"[-d duration_ms] [-o csv] [load ...]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind < argc) {
+		load_count = 0;
+		while (optind < argc && load_count < MAX_LOADS) {
+			uint32_t load = strtoul(argv[optind++], NULL, 0);
+			loads[load_count++] = load ? load : 1;
+		}
+	}
+
+	spi_init(spi0, options.spi_hz);
+	gpio_init(CS_PIN);
+	gpio_set_dir(CS_PIN, GPIO_OUT);
+	gpio_put(CS_PIN, 1);
+	chip.on_advance = arrivals;
+	enc28j60_sim_attach(&chip);
+
+	enc28j60.rx_buffer_size = options.rx_buffer_size;
+	enc28j60_init(&enc28j60);
+	enc28j60_interrupts(&enc28j60, ENC28J60_PKTIE | ENC28J60_RXERIE);
+	traffic.seed = 1;
+
+	uint64_t drain_ns = calibrate(&calibration);
+	printf("SPI %lu Hz, CPU %lu us per frame, forwarding %lu%%, receive buffer %u bytes\n",
+			(unsigned long) options.spi_hz, (unsigned long) options.cpu_us, (unsigned long) options.forward_percent,
+			enc28j60_rx_buffer_size(&enc28j60));
+	printf("Drain capacity %lu frames/s for the mix%s, %lu ms per load\n", (unsigned long) (1000000000ull / drain_ns),
+			calibration.overflows + calibration.saturated ? "" : " (wire rate)", (unsigned long) options.duration_ms);
+	printf("phase     offered Mbit/s     rx   drops   ovfl   sat  ring  peak  recov ms  strad desync\n");
+
+	for (size_t i = 0; i < load_count; i++) {
+		struct result *r = &results[i];
+		snprintf(names[i], sizeof(names[i]), "load %lu%%", (unsigned long) loads[i]);
+		r->name = names[i];
+		r->load = loads[i];
+		traffic_start(drain_ns * 100 / loads[i], 0, UINT32_MAX);
+		run_phase(r, options.duration_ms * 1000000ull);
+		report(r);
+	}
+
+	/* Minimum frames back to back at line rate, then runts all at once to push EPKTCNT to its limit */
+	struct result *burst = &results[load_count];
+	burst->name = "burst";
+	traffic_start(1, MIN_LEN, BURST_FRAMES);
+	run_phase(burst, RECOVERY_TIMEOUT_US * 1000ull);
+	report(burst);
+
+	struct result *saturate = &results[load_count + 1];
+	saturate->name = "saturate";
+	traffic_start(0, RUNT_LEN, BURST_FRAMES);
+	run_phase(saturate, RECOVERY_TIMEOUT_US * 1000ull);
+	report(saturate);
+
+	/* The cliff: the first load dropping more than CLIFF_DROPS, and the best sustained delivery rate */
+	double best = 0;
+	const struct result *cliff = NULL;
+	uint32_t desyncs = calibration.desyncs + burst->desyncs + saturate->desyncs;
+	for (size_t i = 0; i < load_count; i++) {
+		const struct result *r = &results[i];
+		uint32_t drops = r->overflows + r->saturated;
+		uint64_t ns = r->duration_ns + r->recovery_ns;
+		double rate = ns ? r->received_bytes * 8e3 / ns : 0;
+		if (rate > best) {
+			best = rate;
+		}
+		if (cliff == NULL && r->offered && drops * 10000ull / r->offered > CLIFF_DROPS) {
+			cliff = r;
+		}
+		desyncs += r->desyncs;
+	}
+	printf("Peak delivery %.2f Mbit/s, ", best);
+	if (cliff != NULL) {
+		printf("drops exceed %u.%02u%% from %s\n", CLIFF_DROPS / 100, CLIFF_DROPS % 100, cliff->name);
+	} else {
+		printf("drops stay below %u.%02u%%\n", CLIFF_DROPS / 100, CLIFF_DROPS % 100);
+	}
+	printf("%lu pointer desynchronisations\n", (unsigned long) desyncs);
+
+	if (options.csv != NULL) {
+		fclose(options.csv);
+	}
+
+	return desyncs ? 1 : 0;
+}
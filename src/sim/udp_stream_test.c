@@ -0,0 +1,196 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <hardware/gpio.h>
+#include <hardware/spi.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/sim.h>
+#include <pico/enc28j60/sram.h>
+#include <pico/enc28j60/udp_stream.h>
+
+/*
+ * Test of the UDP streaming sender on a simulated ENC28J60.
+ * The same sequence of datagrams is sent with the header template in chip SRAM (rx_buffer_size 6624) and without it,
+ * so the header is restored over SPI (default receive buffer and 6628). Between datagrams other frames are sent
+ * through enc28j60_transfer_*, some still transmitting when the stream sends, so the header has to be restored from
+ * the template or over SPI. Every frame on the wire is checked field by field, the IPv4 header checksum and the UDP
+ * checksum (with the pseudo header) are verified, and the headers of both restore paths are compared byte by byte.
+ * Exits with status 1 on the first mismatch.
+ */
+
+/* Configuration */
+#define SPI_HZ 20000000
+#define DATAGRAMS 200
+#define SOURCE_PORT 5000
+#define DESTINATION_PORT 6000
+
+static const uint8_t destination_mac[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x02 };
+static const uint8_t source_ip[4] = { 10, 0, 0, 1 };
+static const uint8_t destination_ip[4] = { 10, 0, 0, 2 };
+
+static struct enc28j60_sim chip = { .spi = spi0, .cs_pin = 10 };
+
+static uint8_t sent[1518];
+static size_t sent_len;
+static uint8_t headers[DATAGRAMS][ENC28J60_UDP_STREAM_HEADER];  /* Headers sent with the template */
+static uint32_t sequence;
+static bool ok = true;
+
+static void
+transmitted(struct enc28j60_sim *sim, const uint8_t *data, size_t len, void *context)
+{
+	(void) sim;
+	(void) context;
+
+	memcpy(sent, data, len < sizeof(sent) ? len : sizeof(sent));
+	sent_len = len;
+}
+
+static void
+check(bool condition, const char *what)
+{
+	if (!condition) {
+		fprintf(stderr, "datagram %lu: %s\n", (unsigned long) sequence, what);
+		ok = false;
+	}
+}
+
+/* One's complement sum of 16-bit big endian words, folded */
+static uint16_t
+checksum(const uint8_t *data, size_t len, uint32_t sum)
+{
+	for (size_t i = 0; i + 1 < len; i += 2) {
+		sum += data[i] << 8 | data[i + 1];
+	}
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return sum;
+}
+
+static uint16_t
+get16(const uint8_t *data)
+{
+	return data[0] << 8 | data[1];
+}
+
+/* Check the frame on the wire against the datagram that was sent */
+static void
+check_frame(const struct enc28j60 *eth, const uint8_t *payload, size_t len, bool udp_checksum, uint16_t id)
+{
+	check(sent_len == (len + ENC28J60_UDP_STREAM_HEADER < 60 ? 60 : len + ENC28J60_UDP_STREAM_HEADER),
+			"frame length");
+	check(!memcmp(sent, destination_mac, 6) && !memcmp(&sent[6], eth->mac_address, 6), "MAC addresses");
+	check(get16(&sent[12]) == 0x0800, "EtherType");
+
+	const uint8_t *ip = &sent[14];
+	check(ip[0] == 0x45, "IP version and header length");
+	check(get16(&ip[2]) == 28 + len, "IP total length");
+	check(get16(&ip[4]) == id, "IP identification");
+	check(ip[9] == 17, "IP protocol");
+	check(!memcmp(&ip[12], source_ip, 4) && !memcmp(&ip[16], destination_ip, 4), "IP addresses");
+	check(checksum(ip, 20, 0) == 0xFFFF, "IP header checksum");
+
+	const uint8_t *udp = &ip[20];
+	check(get16(&udp[0]) == SOURCE_PORT && get16(&udp[2]) == DESTINATION_PORT, "UDP ports");
+	check(get16(&udp[4]) == 8 + len, "UDP length");
+	if (udp_checksum) {
+		/* Pseudo header: addresses, protocol and UDP length */
+		uint32_t pseudo = checksum(&ip[12], 8, 0) + 17 + get16(&udp[4]);
+		check(get16(&udp[6]) && checksum(udp, 8 + len, pseudo) == 0xFFFF, "UDP checksum");
+	} else {
+		check(!get16(&udp[6]), "UDP checksum not left 0");
+	}
+
+	check(!memcmp(&sent[ENC28J60_UDP_STREAM_HEADER], payload, len), "payload");
+}
+
+/*
+ * Send the sequence of datagrams with a receive buffer size.
+ * \return virtual time taken, in nanoseconds
+ */
+static uint64_t
+run(uint16_t rx_buffer_size, bool template_expected, bool udp_checksum)
+{
+	struct enc28j60 eth = {
+		.spi = spi0,
+		.cs_pin = 10,
+		.mac_address = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 },
+		.rx_buffer_size = rx_buffer_size,
+	};
+	struct enc28j60_udp_stream stream = { .checksum = udp_checksum };
+	static uint8_t payload[ENC28J60_UDP_STREAM_MAX_PAYLOAD];
+	static uint8_t other[100];
+
+	enc28j60_init(&eth);
+	enc28j60_udp_stream_init(&stream, &eth, destination_mac, source_ip, destination_ip, SOURCE_PORT,
+			DESTINATION_PORT);
+	sequence = 0;
+	check((stream.template_address != ENC28J60_SRAM_NONE) == template_expected, "template placement");
+
+	memset(other, 0xEE, sizeof(other));
+	uint64_t start = enc28j60_sim_time_ns();
+	for (uint32_t n = 0; n < DATAGRAMS; n++) {
+		size_t len = 1 + (n * 13) % ENC28J60_UDP_STREAM_MAX_PAYLOAD;
+		for (size_t i = 0; i < len; i++) {
+			payload[i] = (uint8_t) (n * 7 + i);
+		}
+
+		/* Another sender overwrites the header, and at times is still transmitting */
+		if (n % 3 != 2) {
+			enc28j60_transfer_init(&eth);
+			enc28j60_transfer_write(&eth, other, sizeof(other));
+			if (n % 3) {
+				enc28j60_transfer_start(&eth);
+			} else {
+				enc28j60_transfer_send(&eth);
+			}
+		}
+
+		sequence = n;
+		uint16_t id = stream.id;
+		enc28j60_udp_stream_send(&stream, payload, len);
+		check_frame(&eth, payload, len, udp_checksum, id);
+		check(stream.id == (uint16_t) (id + 1), "identification not advanced");
+
+		/* Both restore paths produce the same header */
+		if (template_expected) {
+			memcpy(headers[n], sent, ENC28J60_UDP_STREAM_HEADER);
+		} else if (udp_checksum) {
+			check(!memcmp(headers[n], sent, ENC28J60_UDP_STREAM_HEADER), "header differs from the template path");
+		}
+	}
+	check(stream.sent == DATAGRAMS, "datagrams not counted");
+
+	return enc28j60_sim_time_ns() - start;
+}
+
+int
+main(void)
+{
+	spi_init(spi0, SPI_HZ);
+	chip.on_transmit = transmitted;
+	enc28j60_sim_attach(&chip);
+	gpio_init(chip.cs_pin);
+	gpio_set_dir(chip.cs_pin, GPIO_OUT);
+	gpio_put(chip.cs_pin, 1);
+
+	uint64_t template_ns = run(6624, true, true);
+	uint64_t spi_ns = run(0, false, true);
+	run(6628, false, true);
+	run(6624, true, false);
+
+	/* The template restore clocks fewer SPI bytes, so the same sequence takes less time */
+	check(template_ns < spi_ns, "template restore not faster than the SPI restore");
+
+	printf("%d datagrams, template %.3f ms, SPI restore %.3f ms: %s\n", DATAGRAMS, template_ns / 1e6, spi_ns / 1e6,
+			ok ? "ok" : "FAILED");
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include <string.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/sram.h>
+
+void
+enc28j60_sram_init(struct enc28j60_sram *sram, struct enc28j60 *eth, uint16_t start, uint16_t end)
+{
+	sram->eth = eth;
+	sram->allocated = 0;
+	sram->count = 0;
+	if (end > start) {
+		sram->blocks[0] = (struct enc28j60_sram_block) { .start = start, .len = end - start, .used = false };
+		sram->count = 1;
+	}
+}
+
+uint16_t
+enc28j60_sram_alloc(struct enc28j60_sram *sram, uint16_t len)
+{
+	if (!len) {
+		return ENC28J60_SRAM_NONE;
+	}
+
+	for (uint8_t i = 0; i < sram->count; i++) {
+		struct enc28j60_sram_block *block = &sram->blocks[i];
+		if (block->used || block->len < len) {
+			continue;
+		}
+
+		/* Split off the rest unless the table is full, then hand out the whole block */
+		if (block->len > len && sram->count < ENC28J60_SRAM_BLOCKS) {
+			memmove(&sram->blocks[i + 2], &sram->blocks[i + 1], (sram->count - i - 1) * sizeof(*block));
+			sram->blocks[i + 1] = (struct enc28j60_sram_block) {
+				.start = block->start + len,
+				.len = block->len - len,
+				.used = false,
+			};
+			block->len = len;
+			sram->count++;
+		}
+
+		block->used = true;
+		sram->allocated += block->len;
+		return block->start;
+	}
+
+	return ENC28J60_SRAM_NONE;
+}
+
+void
+enc28j60_sram_free(struct enc28j60_sram *sram, uint16_t address)
+{
+	uint8_t i = 0;
+	while (i < sram->count && sram->blocks[i].start != address) {
+		i++;
+	}
+	if (i == sram->count || !sram->blocks[i].used) {
+		return;
+	}
+
+	sram->blocks[i].used = false;
+	sram->allocated -= sram->blocks[i].len;
+
+	/* Merge with the free neighbours */
+	if (i + 1 < sram->count && !sram->blocks[i + 1].used) {
+		sram->blocks[i].len += sram->blocks[i + 1].len;
+		memmove(&sram->blocks[i + 1], &sram->blocks[i + 2], (sram->count - i - 2) * sizeof(sram->blocks[0]));
+		sram->count--;
+	}
+	if (i > 0 && !sram->blocks[i - 1].used) {
+		sram->blocks[i - 1].len += sram->blocks[i].len;
+		memmove(&sram->blocks[i], &sram->blocks[i + 1], (sram->count - i - 1) * sizeof(sram->blocks[0]));
+		sram->count--;
+	}
+}
+
+void
+enc28j60_sram_write(struct enc28j60_sram *sram, uint16_t address, const uint8_t *data, size_t len)
+{
+	enc28j60_transaction_begin(sram->eth);
+	enc28j60_reg_write(sram->eth, ENC28J60_REG_EWRPT, address);
+	enc28j60_write(sram->eth, ENC28J60_WBM | ENC28J60_BM_ARG, data, len);
+	enc28j60_transaction_end(sram->eth);
+}
+
+void
+enc28j60_sram_read(struct enc28j60_sram *sram, uint16_t address, uint8_t *data, size_t len)
+{
+	enc28j60_transaction_begin(sram->eth);
+	enc28j60_reg_write(sram->eth, ENC28J60_REG_ERDPT, address);
+	enc28j60_read(sram->eth, ENC28J60_RBM | ENC28J60_BM_ARG, data, len);
+	enc28j60_transaction_end(sram->eth);
+}
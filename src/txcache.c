@@ -0,0 +1,132 @@
+#include <string.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/txcache.h>
+
+static void
+enc28j60_txcache_evict(struct enc28j60_txcache *cache, struct enc28j60_txcache_entry *entry)
+{
+	enc28j60_sram_free(cache->sram, entry->address);
+	entry->address = ENC28J60_SRAM_NONE;
+}
+
+/* \return the oldest used entry, NULL if the cache is empty */
+static struct enc28j60_txcache_entry *
+enc28j60_txcache_oldest(struct enc28j60_txcache *cache)
+{
+	struct enc28j60_txcache_entry *oldest = NULL;
+
+	for (size_t i = 0; i < ENC28J60_TXCACHE_ENTRIES; i++) {
+		struct enc28j60_txcache_entry *entry = &cache->entries[i];
+		if (entry->address != ENC28J60_SRAM_NONE && (oldest == NULL || entry->stamp - oldest->stamp > UINT32_MAX / 2)) {
+			oldest = entry;
+		}
+	}
+
+	return oldest;
+}
+
+void
+enc28j60_txcache_init(struct enc28j60_txcache *cache, struct enc28j60_sram *sram)
+{
+	cache->sram = sram;
+	cache->hits = 0;
+	cache->stores = 0;
+	cache->releases = 0;
+	cache->clock = 0;
+	for (size_t i = 0; i < ENC28J60_TXCACHE_ENTRIES; i++) {
+		cache->entries[i].address = ENC28J60_SRAM_NONE;
+	}
+}
+
+uint16_t
+enc28j60_txcache_lookup(struct enc28j60_txcache *cache, const uint8_t *key, uint16_t len)
+{
+	for (size_t i = 0; i < ENC28J60_TXCACHE_ENTRIES; i++) {
+		const struct enc28j60_txcache_entry *entry = &cache->entries[i];
+		if (entry->address != ENC28J60_SRAM_NONE && entry->len == len
+				&& !memcmp(entry->key, key, ENC28J60_TXCACHE_KEY)) {
+			cache->hits++;
+			return entry->address;
+		}
+	}
+
+	return ENC28J60_SRAM_NONE;
+}
+
+void
+enc28j60_txcache_store(struct enc28j60_txcache *cache, const uint8_t *key, uint16_t source, uint16_t len)
+{
+	struct enc28j60_txcache_entry *entry = NULL;
+
+	for (size_t i = 0; i < ENC28J60_TXCACHE_ENTRIES && entry == NULL; i++) {
+		if (cache->entries[i].address == ENC28J60_SRAM_NONE) {
+			entry = &cache->entries[i];
+		}
+	}
+	if (entry == NULL) {
+		entry = enc28j60_txcache_oldest(cache);
+		enc28j60_txcache_evict(cache, entry);
+	}
+
+	uint16_t address = enc28j60_sram_alloc(cache->sram, len);
+	while (address == ENC28J60_SRAM_NONE) {
+		struct enc28j60_txcache_entry *oldest = enc28j60_txcache_oldest(cache);
+		if (oldest == NULL) {
+			return;  /* Larger than the whole region */
+		}
+		enc28j60_txcache_evict(cache, oldest);
+		address = enc28j60_sram_alloc(cache->sram, len);
+	}
+
+	enc28j60_dma_copy(cache->sram->eth, address, source, len);
+
+	memcpy(entry->key, key, ENC28J60_TXCACHE_KEY);
+	entry->len = len;
+	entry->address = address;
+	entry->stamp = cache->clock++;
+	cache->stores++;
+}
+
+void
+enc28j60_txcache_ack(struct enc28j60_txcache *cache, const uint8_t *connection, uint32_t ack)
+{
+	for (size_t i = 0; i < ENC28J60_TXCACHE_ENTRIES; i++) {
+		struct enc28j60_txcache_entry *entry = &cache->entries[i];
+		if (entry->address == ENC28J60_SRAM_NONE || memcmp(entry->key, connection, ENC28J60_TXCACHE_CONNECTION)) {
+			continue;
+		}
+
+		/* Sequence number in network byte order, compared modulo 2^32 */
+		const uint8_t *seq = &entry->key[ENC28J60_TXCACHE_CONNECTION];
+		uint32_t end = ((uint32_t) seq[0] << 24 | seq[1] << 16 | seq[2] << 8 | seq[3]) + entry->len;
+		if ((int32_t) (ack - end) >= 0) {
+			enc28j60_txcache_evict(cache, entry);
+			cache->releases++;
+		}
+	}
+}
+
+void
+enc28j60_txcache_invalidate(struct enc28j60_txcache *cache, const uint8_t *connection)
+{
+	for (size_t i = 0; i < ENC28J60_TXCACHE_ENTRIES; i++) {
+		struct enc28j60_txcache_entry *entry = &cache->entries[i];
+		if (entry->address != ENC28J60_SRAM_NONE && !memcmp(entry->key, connection, ENC28J60_TXCACHE_CONNECTION)) {
+			enc28j60_txcache_evict(cache, entry);
+			cache->releases++;
+		}
+	}
+}
+
+void
+enc28j60_txcache_flush(struct enc28j60_txcache *cache)
+{
+	for (size_t i = 0; i < ENC28J60_TXCACHE_ENTRIES; i++) {
+		struct enc28j60_txcache_entry *entry = &cache->entries[i];
+		if (entry->address != ENC28J60_SRAM_NONE) {
+			enc28j60_txcache_evict(cache, entry);
+			cache->releases++;
+		}
+	}
+}
@@ -0,0 +1,144 @@
+#include <string.h>
+
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/sram.h>
+#include <pico/enc28j60/udp_stream.h>
+
+static uint32_t
+enc28j60_udp_stream_sum(uint32_t sum, const uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i + 1 < len; i += 2) {
+		sum += data[i] << 8 | data[i + 1];
+	}
+	if (len & 1) {
+		sum += data[len - 1] << 8;
+	}
+
+	return sum;
+}
+
+static uint16_t
+enc28j60_udp_stream_fold(uint32_t sum)
+{
+	while (sum >> 16) {
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+
+	return (uint16_t) ~sum;
+}
+
+void
+enc28j60_udp_stream_init(struct enc28j60_udp_stream *stream, struct enc28j60 *eth,
+		const uint8_t *destination_mac, const uint8_t *source_ip, const uint8_t *destination_ip, uint16_t source_port,
+		uint16_t destination_port)
+{
+	uint8_t *header = stream->header;
+
+	memset(header, 0, ENC28J60_UDP_STREAM_HEADER);
+
+	/* Ethernet */
+	memcpy(&header[0], destination_mac, 6);
+	memcpy(&header[6], eth->mac_address, 6);
+	header[12] = 0x08;
+	header[13] = 0x00;
+
+	/* IPv4, total length, identification and checksum patched per datagram */
+	header[14] = 0x45;
+	header[20] = 0x40;  /* Don't fragment */
+	header[22] = 64;  /* TTL */
+	header[23] = 17;  /* UDP */
+	memcpy(&header[26], source_ip, 4);
+	memcpy(&header[30], destination_ip, 4);
+
+	/* UDP, length and checksum patched per datagram */
+	header[34] = source_port >> 8;
+	header[35] = source_port & 0xFF;
+	header[36] = destination_port >> 8;
+	header[37] = destination_port & 0xFF;
+
+	stream->eth = eth;
+	stream->sent = 0;
+	stream->id = 0;
+	stream->ip_sum = enc28j60_udp_stream_sum(0, &header[14], 20);
+	stream->udp_sum = enc28j60_udp_stream_sum(17, &header[26], 12);
+	stream->generation = eth->tx_generation - 1;  /* Restore the header before the first datagram */
+
+	if (enc28j60_rx_buffer_size(eth) + ENC28J60_TX_SPACE > ENC28J60_UDP_STREAM_TEMPLATE) {
+		stream->template_address = ENC28J60_SRAM_NONE;
+		return;
+	}
+
+	stream->template_address = ENC28J60_UDP_STREAM_TEMPLATE;
+	enc28j60_transaction_begin(eth);
+	enc28j60_reg_write(eth, ENC28J60_REG_EWRPT, stream->template_address);
+	enc28j60_write(eth, ENC28J60_WBM | ENC28J60_BM_ARG, header, ENC28J60_UDP_STREAM_HEADER);
+	enc28j60_transaction_end(eth);
+}
+
+void
+enc28j60_udp_stream_send(struct enc28j60_udp_stream *stream, const uint8_t *payload, size_t len)
+{
+	struct enc28j60 *eth = stream->eth;
+	uint16_t tx_start = enc28j60_rx_buffer_size(eth);
+	uint16_t header = tx_start + 1;
+	uint16_t total_length = 20 + 8 + len;
+	uint16_t udp_length = 8 + len;
+	uint16_t id = stream->id++;
+	uint8_t ip_patch[10];
+	uint8_t udp_patch[4];
+
+	/* Total length, identification, flags, TTL, protocol and header checksum */
+	uint16_t ip_checksum = enc28j60_udp_stream_fold(stream->ip_sum + total_length + id);
+	ip_patch[0] = total_length >> 8;
+	ip_patch[1] = total_length & 0xFF;
+	ip_patch[2] = id >> 8;
+	ip_patch[3] = id & 0xFF;
+	memcpy(&ip_patch[4], &stream->header[20], 4);
+	ip_patch[8] = ip_checksum >> 8;
+	ip_patch[9] = ip_checksum & 0xFF;
+
+	/* UDP length and checksum */
+	uint16_t udp_checksum = 0;
+	if (stream->checksum) {
+		uint32_t sum = enc28j60_udp_stream_sum(stream->udp_sum + 2 * udp_length, payload, len);
+		udp_checksum = enc28j60_udp_stream_fold(sum);
+		if (!udp_checksum) {
+			udp_checksum = 0xFFFF;
+		}
+	}
+	udp_patch[0] = udp_length >> 8;
+	udp_patch[1] = udp_length & 0xFF;
+	udp_patch[2] = udp_checksum >> 8;
+	udp_patch[3] = udp_checksum & 0xFF;
+
+	/* Rewrites the transmit buffer registers, so a previous frame must have left */
+	enc28j60_transfer_claim(eth);
+	enc28j60_transaction_begin(eth);
+	if (stream->generation != eth->tx_generation) {
+		/* The transmit buffer was used by another sender, restore control byte and header */
+		uint8_t control = 0;
+		enc28j60_reg_write(eth, ENC28J60_REG_EWRPT, tx_start);
+		enc28j60_write(eth, ENC28J60_WBM | ENC28J60_BM_ARG, &control, 1);
+
+		if (stream->template_address != ENC28J60_SRAM_NONE) {
+			enc28j60_dma_copy(eth, header, stream->template_address, ENC28J60_UDP_STREAM_HEADER);
+		} else {
+			/* No room for a template, the write pointer is right after the control byte */
+			enc28j60_write(eth, ENC28J60_WBM | ENC28J60_BM_ARG, stream->header, ENC28J60_UDP_STREAM_HEADER);
+		}
+
+		stream->generation = ++eth->tx_generation;
+	}
+	enc28j60_reg_write(eth, ENC28J60_REG_ETXST, tx_start);
+	enc28j60_reg_write(eth, ENC28J60_REG_EWRPT, header + 16);
+	enc28j60_write(eth, ENC28J60_WBM | ENC28J60_BM_ARG, ip_patch, sizeof(ip_patch));
+	enc28j60_reg_write(eth, ENC28J60_REG_EWRPT, header + 38);
+	enc28j60_write(eth, ENC28J60_WBM | ENC28J60_BM_ARG, udp_patch, sizeof(udp_patch));
+	enc28j60_reg_write(eth, ENC28J60_REG_ETXND, header + ENC28J60_UDP_STREAM_HEADER - 1);
+	enc28j60_transaction_end(eth);
+
+	/* Appends after ETXND, in chunks if preempt_chunk is set */
+	enc28j60_transfer_write(eth, payload, len);
+	enc28j60_transfer_send(eth);
+	stream->sent++;
+}
@@ -0,0 +1,249 @@
+#include "lwip/etharp.h"
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/snmp.h"
+#include "lwip/stats.h"
+
+#include <hardware/timer.h>
+
+#include <pico/enc28j60/capture.h>
+#include <pico/enc28j60/enc28j60.h>
+#include <pico/enc28j60/ethernetif.h>
+#include <pico/enc28j60/vlan.h>
+
+#define IFNAME0 'v'
+#define IFNAME1 'l'
+
+#define VLAN_TPID 0x8100
+#define VLAN_TAG 4
+#define VLAN_HEADER (2 * ETH_HWADDR_LEN + VLAN_TAG)
+
+static struct ethernetif_vlan_port *
+vlan_port(struct ethernetif_vlan *vlan, const struct netif *netif, u16_t vid)
+{
+	for (u8_t i = 0; i < vlan->port_count; i++) {
+		struct ethernetif_vlan_port *port = &vlan->ports[i];
+		if (netif != NULL ? port->netif == netif : port->vid == vid) {
+			return port;
+		}
+	}
+
+	return NULL;
+}
+
+err_t
+ethernetif_vlan_add(struct ethernetif_vlan *vlan, struct netif *netif, u16_t vid)
+{
+	if (vlan->port_count == ETHERNETIF_VLAN_PORTS) {
+		return ERR_MEM;
+	}
+
+	struct ethernetif_vlan_port *port = &vlan->ports[vlan->port_count++];
+	port->vid = vid & 0x0FFF;
+	port->netif = netif;
+	port->rx = 0;
+	port->tx = 0;
+
+	return ERR_OK;
+}
+
+/**
+ * Record a frame as it is on the wire in the capture of the instance, if there is one.
+ * The filter of the capture sees the MAC addresses and the tag only.
+ *
+ * @param header MAC addresses and tag, or the first VLAN_HEADER bytes of an untagged frame
+ * @param p the frame, its bytes from offset on follow header on the wire
+ * @param flags ENC28J60_CAPTURE_INBOUND or ENC28J60_CAPTURE_OUTBOUND
+ */
+static void
+vlan_capture(struct enc28j60 *eth, const u8_t *header, struct pbuf *p, u16_t offset, u32_t flags)
+{
+	struct pbuf *q;
+
+	if (eth->capture == NULL || !enc28j60_capture_begin(eth->capture, header, VLAN_HEADER,
+			VLAN_HEADER + p->tot_len - offset, time_us_64(), flags)) {
+		return;
+	}
+
+	enc28j60_capture_append(eth->capture, header, VLAN_HEADER);
+	for (q = p; q != NULL; q = q->next) {
+		if (offset >= q->len) {
+			offset -= q->len;
+			continue;
+		}
+		enc28j60_capture_append(eth->capture, (const u8_t *)q->payload + offset, q->len - offset);
+		offset = 0;
+	}
+	enc28j60_capture_commit(eth->capture);
+}
+
+/**
+ * linkoutput of VLAN interfaces: write the MAC addresses, the tag and the
+ * rest of the packet to the transmit buffer.
+ */
+static err_t
+vlan_output(struct netif *netif, struct pbuf *p)
+{
+	struct enc28j60 *eth = netif->state;
+	struct ethernetif_vlan_port *port = vlan_port(eth->vlan, netif, 0);
+	u8_t header[VLAN_HEADER];
+	struct pbuf *q;
+	u16_t offset = ETH_PAD_SIZE + 2 * ETH_HWADDR_LEN;
+
+	if (pbuf_copy_partial(p, header, 2 * ETH_HWADDR_LEN, ETH_PAD_SIZE) != 2 * ETH_HWADDR_LEN) {
+		return ERR_ARG;
+	}
+	header[12] = VLAN_TPID >> 8;
+	header[13] = VLAN_TPID & 0xFF;
+	header[14] = port->vid >> 8;
+	header[15] = port->vid & 0xFF;
+
+	enc28j60_transfer_init(eth);
+	enc28j60_transfer_write(eth, header, VLAN_HEADER);
+	for (q = p; q != NULL; q = q->next) {
+		if (offset >= q->len) {
+			offset -= q->len;
+			continue;
+		}
+		enc28j60_transfer_write(eth, (const u8_t *)q->payload + offset, q->len - offset);
+		offset = 0;
+	}
+	enc28j60_transfer_send(eth);
+
+	vlan_capture(eth, header, p, ETH_PAD_SIZE + 2 * ETH_HWADDR_LEN, ENC28J60_CAPTURE_OUTBOUND);
+
+	port->tx++;
+	MIB2_STATS_NETIF_ADD(netif, ifoutoctets, p->tot_len + VLAN_TAG);
+	if (header[0] & 1) {
+		MIB2_STATS_NETIF_INC(netif, ifoutnucastpkts);
+	} else {
+		MIB2_STATS_NETIF_INC(netif, ifoutucastpkts);
+	}
+	LINK_STATS_INC(link.xmit);
+
+	return ERR_OK;
+}
+
+err_t
+ethernetif_vlan_init(struct netif *netif)
+{
+	struct enc28j60 *eth = netif->state;
+
+	LWIP_ASSERT("netif != NULL", (netif != NULL));
+	LWIP_ASSERT("VLAN registered", (eth->vlan != NULL && vlan_port(eth->vlan, netif, 0) != NULL));
+
+	MIB2_INIT_NETIF(netif, snmp_ifType_l2vlan, 0);
+
+	netif->name[0] = IFNAME0;
+	netif->name[1] = IFNAME1;
+	netif->output = etharp_output;
+	netif->linkoutput = vlan_output;
+
+	netif->hwaddr_len = ETHARP_HWADDR_LEN;
+	MEMCPY(netif->hwaddr, eth->mac_address, ETHARP_HWADDR_LEN);
+	netif->mtu = 1500;
+	netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_LINK_UP;
+
+	return ERR_OK;
+}
+
+/**
+ * Allocate a pbuf for the frame being received and fill it with the bytes
+ * already read, then with the rest of the frame from the receive buffer.
+ * The frame is acknowledged afterwards.
+ *
+ * @param header the VLAN_HEADER bytes already read, header_len of them go to the pbuf
+ * @param len length of the pbuf
+ */
+static struct pbuf *
+vlan_read(struct netif *netif, struct enc28j60 *eth, const u8_t *header, u16_t header_len, u16_t len)
+{
+	struct pbuf *p, *q;
+	u16_t offset = header_len;
+
+	LWIP_UNUSED_ARG(netif);  /* Only counted with MIB2 statistics */
+
+	p = pbuf_alloc(PBUF_RAW, len + ETH_PAD_SIZE, PBUF_POOL);
+	if (p == NULL) {
+		enc28j60_receive_ack(eth);
+		LINK_STATS_INC(link.memerr);
+		LINK_STATS_INC(link.drop);
+		MIB2_STATS_NETIF_INC(netif, ifindiscards);
+		return NULL;
+	}
+
+	#if ETH_PAD_SIZE
+	pbuf_remove_header(p, ETH_PAD_SIZE); /* drop the padding word */
+	#endif
+
+	pbuf_take(p, header, header_len);
+	for (q = p; q != NULL; q = q->next) {
+		if (offset >= q->len) {
+			offset -= q->len;
+			continue;
+		}
+		enc28j60_receive_read(eth, (u8_t *)q->payload + offset, q->len - offset);
+		offset = 0;
+	}
+
+	enc28j60_receive_ack(eth);
+	vlan_capture(eth, header, p, header_len, ENC28J60_CAPTURE_INBOUND);
+
+	MIB2_STATS_NETIF_ADD(netif, ifinoctets, p->tot_len);
+	if (header[0] & 1) {
+		MIB2_STATS_NETIF_INC(netif, ifinnucastpkts);
+	} else {
+		MIB2_STATS_NETIF_INC(netif, ifinucastpkts);
+	}
+
+	#if ETH_PAD_SIZE
+	pbuf_add_header(p, ETH_PAD_SIZE); /* reclaim the padding word */
+	#endif
+
+	LINK_STATS_INC(link.recv);
+
+	return p;
+}
+
+struct pbuf *
+ethernetif_vlan_input(struct netif *netif, struct netif **destination)
+{
+	struct enc28j60 *eth = netif->state;
+	u8_t header[VLAN_HEADER];
+
+	u16_t len = enc28j60_receive_init(eth);
+	if (len < VLAN_HEADER + 2) {
+		enc28j60_receive_ack(eth);
+		return NULL;
+	}
+	enc28j60_receive_read(eth, header, VLAN_HEADER);
+
+	u16_t vid = (header[14] << 8 | header[15]) & 0x0FFF;
+	if ((header[12] << 8 | header[13]) != VLAN_TPID) {
+		/* Untagged */
+		*destination = netif;
+		return vlan_read(netif, eth, header, VLAN_HEADER, len);
+	}
+
+	if (vid == 0) {
+		/* Priority tagged */
+		*destination = netif;
+		return vlan_read(netif, eth, header, 2 * ETH_HWADDR_LEN, len - VLAN_TAG);
+	}
+
+	struct ethernetif_vlan_port *port = eth->vlan != NULL ? vlan_port(eth->vlan, NULL, vid) : NULL;
+	if (port == NULL) {
+		/* The payload is never read */
+		enc28j60_receive_ack(eth);
+		if (eth->vlan != NULL) {
+			eth->vlan->unknown++;
+		}
+		LINK_STATS_INC(link.drop);
+		MIB2_STATS_NETIF_INC(netif, ifinunknownprotos);
+		return NULL;
+	}
+
+	port->rx++;
+	*destination = port->netif;
+	return vlan_read(port->netif, eth, header, 2 * ETH_HWADDR_LEN, len - VLAN_TAG);
+}